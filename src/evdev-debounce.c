@@ -577,7 +577,7 @@ fallback_init_debounce(struct fallback_dispatch *dispatch)
 		 "%s debounce short",
 		 evdev_device_get_sysname(device));
 	libinput_timer_init(&dispatch->debounce.timer_short,
-			    evdev_libinput_context(device),
+			    &device->base,
 			    timer_name,
 			    debounce_timeout_short,
 			    device);
@@ -587,7 +587,7 @@ fallback_init_debounce(struct fallback_dispatch *dispatch)
 		 "%s debounce",
 		 evdev_device_get_sysname(device));
 	libinput_timer_init(&dispatch->debounce.timer,
-			    evdev_libinput_context(device),
+			    &device->base,
 			    timer_name,
 			    debounce_timeout,
 			    device);
@@ -228,10 +228,10 @@ fallback_flush_wheels(struct fallback_dispatch *dispatch,
 
 	if (dispatch->wheel.y != 0) {
 		wheel_degrees.y = -1 * dispatch->wheel.y *
-					device->scroll.wheel_click_angle.y;
+					evdev_wheel_click_angle(device).y;
 		discrete.y = -1 * dispatch->wheel.y;
 
-		source = device->scroll.is_tilt.vertical ?
+		source = evdev_wheel_is_tilt(device).vertical ?
 				LIBINPUT_POINTER_AXIS_SOURCE_WHEEL_TILT:
 				LIBINPUT_POINTER_AXIS_SOURCE_WHEEL;
 
@@ -247,10 +247,10 @@ fallback_flush_wheels(struct fallback_dispatch *dispatch,
 
 	if (dispatch->wheel.x != 0) {
 		wheel_degrees.x = dispatch->wheel.x *
-					device->scroll.wheel_click_angle.x;
+					evdev_wheel_click_angle(device).x;
 		discrete.x = dispatch->wheel.x;
 
-		source = device->scroll.is_tilt.horizontal ?
+		source = evdev_wheel_is_tilt(device).horizontal ?
 				LIBINPUT_POINTER_AXIS_SOURCE_WHEEL_TILT:
 				LIBINPUT_POINTER_AXIS_SOURCE_WHEEL;
 
@@ -1215,6 +1215,24 @@ fallback_keyboard_pair_tablet_mode(struct evdev_device *keyboard,
 		fallback_suspend(dispatch, keyboard);
 }
 
+static uint32_t
+fallback_interface_pair_interests(struct evdev_device *device)
+{
+	uint32_t interests = 0;
+
+	/* see fallback_lid_pair_keyboard() */
+	if (device->tags & EVDEV_TAG_LID_SWITCH)
+		interests |= AS_MASK(EVDEV_PAIR_KEYBOARD);
+
+	/* see fallback_keyboard_pair_tablet_mode() */
+	if ((device->tags &
+	     (EVDEV_TAG_TRACKPOINT|EVDEV_TAG_INTERNAL_KEYBOARD)) &&
+	    !(device->model_flags & EVDEV_MODEL_TABLET_MODE_NO_SUSPEND))
+		interests |= AS_MASK(EVDEV_PAIR_TABLET_MODE_SWITCH);
+
+	return interests;
+}
+
 static void
 fallback_interface_device_added(struct evdev_device *device,
 				struct evdev_device *added_device)
@@ -1255,9 +1273,11 @@ fallback_interface_device_removed(struct evdev_device *device,
 
 struct evdev_dispatch_interface fallback_interface = {
 	.process = fallback_interface_process,
+	.process_frame = NULL,
 	.suspend = fallback_interface_suspend,
 	.remove = fallback_interface_remove,
 	.destroy = fallback_interface_destroy,
+	.pair_interests = fallback_interface_pair_interests,
 	.device_added = fallback_interface_device_added,
 	.device_removed = fallback_interface_device_removed,
 	.device_suspended = fallback_interface_device_removed, /* treat as remove */
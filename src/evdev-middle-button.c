@@ -708,7 +708,7 @@ evdev_init_middlebutton(struct evdev_device *device,
 		 "%s middlebutton",
 		 evdev_device_get_sysname(device));
 	libinput_timer_init(&device->middlebutton.timer,
-			    evdev_libinput_context(device),
+			    &device->base,
 			    timer_name,
 			    evdev_middlebutton_handle_timeout,
 			    device);
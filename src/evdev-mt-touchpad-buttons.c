@@ -887,7 +887,7 @@ tp_init_buttons(struct tp_dispatch *tp,
 			 i);
 		t->button.state = BUTTON_STATE_NONE;
 		libinput_timer_init(&t->button.timer,
-				    tp_libinput_context(tp),
+				    &tp->device->base,
 				    timer_name,
 				    tp_button_handle_timeout, t);
 	}
@@ -318,7 +318,7 @@ tp_edge_scroll_init(struct tp_dispatch *tp, struct evdev_device *device)
 			 i);
 		t->scroll.direction = -1;
 		libinput_timer_init(&t->scroll.timer,
-				    tp_libinput_context(tp),
+				    &tp->device->base,
 				    timer_name,
 				    tp_edge_scroll_handle_timeout, t);
 	}
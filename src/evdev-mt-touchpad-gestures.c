@@ -735,7 +735,7 @@ tp_init_gesture(struct tp_dispatch *tp)
 		 "%s gestures",
 		 evdev_device_get_sysname(tp->device));
 	libinput_timer_init(&tp->gesture.finger_count_switch_timer,
-			    tp_libinput_context(tp),
+			    &tp->device->base,
 			    timer_name,
 			    tp_gesture_finger_count_switch_timeout, tp);
 }
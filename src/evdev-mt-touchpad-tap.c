@@ -1343,7 +1343,7 @@ tp_init_tap(struct tp_dispatch *tp)
 		 "%s tap",
 		 evdev_device_get_sysname(tp->device));
 	libinput_timer_init(&tp->tap.timer,
-			    tp_libinput_context(tp),
+			    &tp->device->base,
 			    timer_name,
 			    tp_tap_handle_timeout, tp);
 }
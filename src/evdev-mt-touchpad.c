@@ -30,11 +30,15 @@
 
 #include "quirks.h"
 #include "evdev-mt-touchpad.h"
+#include "tracepoints.h"
 
 #define DEFAULT_TRACKPOINT_ACTIVITY_TIMEOUT ms2us(300)
 #define DEFAULT_TRACKPOINT_EVENT_TIMEOUT ms2us(40)
 #define DEFAULT_KEYBOARD_ACTIVITY_TIMEOUT_1 ms2us(200)
 #define DEFAULT_KEYBOARD_ACTIVITY_TIMEOUT_2 ms2us(500)
+/* The activity timeouts are long enough that firing them a few ms late is
+ * not noticeable, let them coalesce with other timers */
+#define DEFAULT_ACTIVITY_TIMER_SLACK ms2us(10)
 #define THUMB_MOVE_TIMEOUT ms2us(300)
 #define FAKE_FINGER_OVERFLOW (1 << 7)
 #define THUMB_IGNORE_SPEED_THRESHOLD 20 /* mm/s */
@@ -447,13 +451,14 @@ tp_get_delta(struct tp_touch *t)
 	return delta;
 }
 
-static void
-tp_process_absolute(struct tp_dispatch *tp,
-		    const struct input_event *e,
-		    uint64_t time)
+/* Decode one ABS_MT_* event other than ABS_MT_SLOT into the given touch.
+ * Returns the touchpad events to queue for this frame. */
+static inline enum touchpad_event
+tp_process_absolute_touch(struct tp_dispatch *tp,
+			  struct tp_touch *t,
+			  const struct input_event *e,
+			  uint64_t time)
 {
-	struct tp_touch *t = tp_current_touch(tp);
-
 	switch(e->code) {
 	case ABS_MT_POSITION_X:
 		evdev_device_check_abs_axis_range(tp->device,
@@ -462,8 +467,7 @@ tp_process_absolute(struct tp_dispatch *tp,
 		t->point.x = e->value;
 		t->time = time;
 		t->dirty = true;
-		tp->queued |= TOUCHPAD_EVENT_MOTION;
-		break;
+		return TOUCHPAD_EVENT_MOTION;
 	case ABS_MT_POSITION_Y:
 		evdev_device_check_abs_axis_range(tp->device,
 						  e->code,
@@ -471,11 +475,7 @@ tp_process_absolute(struct tp_dispatch *tp,
 		t->point.y = e->value;
 		t->time = time;
 		t->dirty = true;
-		tp->queued |= TOUCHPAD_EVENT_MOTION;
-		break;
-	case ABS_MT_SLOT:
-		tp->slot = e->value;
-		break;
+		return TOUCHPAD_EVENT_MOTION;
 	case ABS_MT_TRACKING_ID:
 		if (e->value != -1)
 			tp_new_touch(tp, t, time);
@@ -486,25 +486,39 @@ tp_process_absolute(struct tp_dispatch *tp,
 		t->pressure = e->value;
 		t->time = time;
 		t->dirty = true;
-		tp->queued |= TOUCHPAD_EVENT_OTHERAXIS;
-		break;
+		return TOUCHPAD_EVENT_OTHERAXIS;
 	case ABS_MT_TOOL_TYPE:
 		t->is_tool_palm = e->value == MT_TOOL_PALM;
 		t->time = time;
 		t->dirty = true;
-		tp->queued |= TOUCHPAD_EVENT_OTHERAXIS;
-		break;
+		return TOUCHPAD_EVENT_OTHERAXIS;
 	case ABS_MT_TOUCH_MAJOR:
 		t->major = e->value;
 		t->dirty = true;
-		tp->queued |= TOUCHPAD_EVENT_OTHERAXIS;
-		break;
+		return TOUCHPAD_EVENT_OTHERAXIS;
 	case ABS_MT_TOUCH_MINOR:
 		t->minor = e->value;
 		t->dirty = true;
-		tp->queued |= TOUCHPAD_EVENT_OTHERAXIS;
-		break;
+		return TOUCHPAD_EVENT_OTHERAXIS;
+	}
+
+	return TOUCHPAD_EVENT_NONE;
+}
+
+static void
+tp_process_absolute(struct tp_dispatch *tp,
+		    const struct input_event *e,
+		    uint64_t time)
+{
+	if (e->code == ABS_MT_SLOT) {
+		tp->slot = e->value;
+		return;
 	}
+
+	tp->queued |= tp_process_absolute_touch(tp,
+						tp_current_touch(tp),
+						e,
+						time);
 }
 
 static void
@@ -1697,10 +1711,15 @@ static void
 tp_handle_state(struct tp_dispatch *tp,
 		uint64_t time)
 {
+	trace_point1(tp_pre_process_state, time);
 	tp_pre_process_state(tp, time);
+	trace_point1(tp_process_state, time);
 	tp_process_state(tp, time);
+	trace_point1(tp_post_events, time);
 	tp_post_events(tp, time);
+	trace_point1(tp_post_process_state, time);
 	tp_post_process_state(tp, time);
+	trace_point1(tp_handle_state_done, time);
 
 	tp_clickpad_middlebutton_apply_config(tp->device);
 }
@@ -1754,6 +1773,55 @@ tp_interface_process(struct evdev_dispatch *dispatch,
 	}
 }
 
+static void
+tp_interface_process_frame(struct evdev_dispatch *dispatch,
+			   struct evdev_device *device,
+			   struct input_event *events,
+			   size_t count,
+			   uint64_t time)
+{
+	struct tp_dispatch *tp = tp_dispatch(dispatch);
+	struct tp_touch *t = tp_current_touch(tp);
+	enum touchpad_event queued = TOUCHPAD_EVENT_NONE;
+
+	/* Decode the whole frame into the touch state in one pass. The
+	 * current touch is only looked up again when the slot changes and
+	 * the queued events are collected locally, tp_handle_state() does
+	 * the real work once at the SYN_REPORT. */
+	for (size_t i = 0; i < count; i++) {
+		struct input_event *e = &events[i];
+
+		switch (e->type) {
+		case EV_ABS:
+			if (!tp->has_mt) {
+				tp_process_absolute_st(tp, e, time);
+			} else if (e->code == ABS_MT_SLOT) {
+				tp->slot = e->value;
+				t = tp_current_touch(tp);
+			} else {
+				queued |= tp_process_absolute_touch(tp,
+								    t,
+								    e,
+								    time);
+			}
+			break;
+		case EV_KEY:
+			tp_process_key(tp, e, time);
+			break;
+		case EV_SYN:
+			tp->queued |= queued;
+			queued = TOUCHPAD_EVENT_NONE;
+			tp_handle_state(tp, time);
+#if 0
+			tp_debug_touch_state(tp, device);
+#endif
+			break;
+		}
+	}
+
+	tp->queued |= queued;
+}
+
 static void
 tp_remove_sendevents(struct tp_dispatch *tp)
 {
@@ -2302,6 +2370,16 @@ tp_pair_tablet_mode_switch(struct evdev_device *touchpad,
 	}
 }
 
+static uint32_t
+tp_interface_pair_interests(struct evdev_device *device)
+{
+	return AS_MASK(EVDEV_PAIR_KEYBOARD) |
+	       AS_MASK(EVDEV_PAIR_TRACKPOINT) |
+	       AS_MASK(EVDEV_PAIR_LID_SWITCH) |
+	       AS_MASK(EVDEV_PAIR_TABLET_MODE_SWITCH) |
+	       AS_MASK(EVDEV_PAIR_EXTERNAL_MOUSE);
+}
+
 static void
 tp_interface_device_added(struct evdev_device *device,
 			  struct evdev_device *added_device)
@@ -2363,18 +2441,9 @@ tp_interface_device_removed(struct evdev_device *device,
 
 	if (tp->sendevents.current_mode ==
 		    LIBINPUT_CONFIG_SEND_EVENTS_DISABLED_ON_EXTERNAL_MOUSE) {
-		struct libinput_device *dev;
-		bool found = false;
-
-		list_for_each(dev, &device->base.seat->devices_list, link) {
-			struct evdev_device *d = evdev_device(dev);
-			if (d != removed_device &&
-			    (d->tags & EVDEV_TAG_EXTERNAL_MOUSE)) {
-				found = true;
-				break;
-			}
-		}
-		if (!found)
+		if (!evdev_seat_has_peer(device->base.seat,
+					 EVDEV_PAIR_EXTERNAL_MOUSE,
+					 removed_device))
 			tp_resume(tp, device, SUSPEND_EXTERNAL_MOUSE);
 	}
 }
@@ -2496,9 +2565,11 @@ tp_interface_toggle_touch(struct evdev_dispatch *dispatch,
 
 static struct evdev_dispatch_interface tp_interface = {
 	.process = tp_interface_process,
+	.process_frame = tp_interface_process_frame,
 	.suspend = tp_interface_suspend,
 	.remove = tp_interface_remove,
 	.destroy = tp_interface_destroy,
+	.pair_interests = tp_interface_pair_interests,
 	.device_added = tp_interface_device_added,
 	.device_removed = tp_interface_device_removed,
 	.device_suspended = tp_interface_device_removed, /* treat as remove */
@@ -2997,7 +3068,7 @@ tp_init_palmdetect_arbitration(struct tp_dispatch *tp,
 		  "%s arbitration",
 		  evdev_device_get_sysname(device));
 	libinput_timer_init(&tp->arbitration.arbitration_timer,
-			    tp_libinput_context(tp),
+			    &tp->device->base,
 			    timer_name,
 			    tp_arbitration_timeout, tp);
 	tp->arbitration.in_arbitration = false;
@@ -3044,18 +3115,22 @@ tp_init_sendevents(struct tp_dispatch *tp,
 		  "%s trackpoint",
 		  evdev_device_get_sysname(device));
 	libinput_timer_init(&tp->palm.trackpoint_timer,
-			    tp_libinput_context(tp),
+			    &tp->device->base,
 			    timer_name,
 			    tp_trackpoint_timeout, tp);
+	libinput_timer_set_slack(&tp->palm.trackpoint_timer,
+				 DEFAULT_ACTIVITY_TIMER_SLACK);
 
 	snprintf(timer_name,
 		 sizeof(timer_name),
 		 "%s keyboard",
 		 evdev_device_get_sysname(device));
 	libinput_timer_init(&tp->dwt.keyboard_timer,
-			    tp_libinput_context(tp),
+			    &tp->device->base,
 			    timer_name,
 			    tp_keyboard_timeout, tp);
+	libinput_timer_set_slack(&tp->dwt.keyboard_timer,
+				 DEFAULT_ACTIVITY_TIMER_SLACK);
 }
 
 static void
@@ -3373,15 +3448,10 @@ static void
 tp_suspend_conditional(struct tp_dispatch *tp,
 		       struct evdev_device *device)
 {
-	struct libinput_device *dev;
-
-	list_for_each(dev, &device->base.seat->devices_list, link) {
-		struct evdev_device *d = evdev_device(dev);
-		if (d->tags & EVDEV_TAG_EXTERNAL_MOUSE) {
-			tp_suspend(tp, device, SUSPEND_EXTERNAL_MOUSE);
-			break;
-		}
-	}
+	if (evdev_seat_has_peer(device->base.seat,
+				EVDEV_PAIR_EXTERNAL_MOUSE,
+				NULL))
+		tp_suspend(tp, device, SUSPEND_EXTERNAL_MOUSE);
 }
 
 static enum libinput_config_status
@@ -489,16 +489,14 @@ static int
 pad_init_leds_from_libwacom(struct pad_dispatch *pad,
 			    struct evdev_device *device)
 {
+	struct libinput *libinput = evdev_libinput_context(device);
 	WacomDeviceDatabase *db = NULL;
 	WacomDevice *wacom = NULL;
 	int rc = 1;
 
-	db = libwacom_database_new();
-	if (!db) {
-		evdev_log_info(device,
-			       "Failed to initialize libwacom context.\n");
+	db = libinput_libwacom_ref(libinput);
+	if (!db)
 		goto out;
-	}
 
 	wacom = libwacom_new_from_path(db,
 				       udev_device_get_devnode(device->udev_device),
@@ -521,7 +519,7 @@ out:
 	if (wacom)
 		libwacom_destroy(wacom);
 	if (db)
-		libwacom_database_destroy(db);
+		libinput_libwacom_unref(libinput);
 
 	if (rc != 0)
 		pad_destroy_leds(pad);
@@ -556,25 +554,34 @@ int
 pad_init_leds(struct pad_dispatch *pad,
 	      struct evdev_device *device)
 {
-	int rc = 1;
-
 	list_init(&pad->modes.mode_group_list);
+	pad->modes.initialized = false;
 
 	if (pad->nbuttons > 32) {
 		evdev_log_bug_libinput(pad->device,
 				       "Too many pad buttons for modes %d\n",
 				       pad->nbuttons);
-		return rc;
+		return 1;
 	}
 
+	return 0;
+}
+
+void
+pad_init_mode_groups(struct pad_dispatch *pad)
+{
+	int rc = 1;
+
+	assert(!pad->modes.initialized);
+	pad->modes.initialized = true;
+
 	/* If libwacom fails, we init one fallback group anyway */
 #if HAVE_LIBWACOM
-	rc = pad_init_leds_from_libwacom(pad, device);
+	rc = pad_init_leds_from_libwacom(pad, pad->device);
 #endif
-	if (rc != 0)
-		rc = pad_init_fallback_group(pad);
-
-	return rc;
+	if (rc != 0 && pad_init_fallback_group(pad) != 0)
+		evdev_log_bug_libinput(pad->device,
+				       "Failed to create a mode group\n");
 }
 
 void
@@ -610,12 +617,14 @@ evdev_device_tablet_pad_get_num_mode_groups(struct evdev_device *device)
 {
 	struct pad_dispatch *pad = (struct pad_dispatch*)device->dispatch;
 	struct libinput_tablet_pad_mode_group *group;
+	struct list *groups;
 	int num_groups = 0;
 
 	if (!(device->seat_caps & EVDEV_DEVICE_TABLET_PAD))
 		return -1;
 
-	list_for_each(group, &pad->modes.mode_group_list, link)
+	groups = pad_mode_groups(pad);
+	list_for_each(group, groups, link)
 		num_groups++;
 
 	return num_groups;
@@ -219,8 +219,9 @@ pad_ring_get_mode_group(struct pad_dispatch *pad,
 			unsigned int ring)
 {
 	struct libinput_tablet_pad_mode_group *group;
+	struct list *groups = pad_mode_groups(pad);
 
-	list_for_each(group, &pad->modes.mode_group_list, link) {
+	list_for_each(group, groups, link) {
 		if (libinput_tablet_pad_mode_group_has_ring(group, ring))
 			return group;
 	}
@@ -235,8 +236,9 @@ pad_strip_get_mode_group(struct pad_dispatch *pad,
 			unsigned int strip)
 {
 	struct libinput_tablet_pad_mode_group *group;
+	struct list *groups = pad_mode_groups(pad);
 
-	list_for_each(group, &pad->modes.mode_group_list, link) {
+	list_for_each(group, groups, link) {
 		if (libinput_tablet_pad_mode_group_has_strip(group, strip))
 			return group;
 	}
@@ -339,8 +341,9 @@ pad_button_get_mode_group(struct pad_dispatch *pad,
 			  unsigned int button)
 {
 	struct libinput_tablet_pad_mode_group *group;
+	struct list *groups = pad_mode_groups(pad);
 
-	list_for_each(group, &pad->modes.mode_group_list, link) {
+	list_for_each(group, groups, link) {
 		if (libinput_tablet_pad_mode_group_has_button(group, button))
 			return group;
 	}
@@ -509,9 +512,11 @@ pad_destroy(struct evdev_dispatch *dispatch)
 
 static struct evdev_dispatch_interface pad_interface = {
 	.process = pad_process,
+	.process_frame = NULL,
 	.suspend = pad_suspend,
 	.remove = NULL,
 	.destroy = pad_destroy,
+	.pair_interests = NULL,
 	.device_added = NULL,
 	.device_removed = NULL,
 	.device_suspended = NULL,
@@ -527,17 +532,15 @@ pad_init_buttons_from_libwacom(struct pad_dispatch *pad,
 {
 	bool rc = false;
 #if HAVE_LIBWACOM_GET_BUTTON_EVDEV_CODE
+	struct libinput *libinput = evdev_libinput_context(device);
 	WacomDeviceDatabase *db = NULL;
 	WacomDevice *tablet = NULL;
 	int num_buttons;
 	int map = 0;
 
-	db = libwacom_database_new();
-	if (!db) {
-		evdev_log_info(device,
-			       "Failed to initialize libwacom context.\n");
+	db = libinput_libwacom_ref(libinput);
+	if (!db)
 		goto out;
-	}
 
 	tablet = libwacom_new_from_usbid(db,
 					 evdev_device_get_id_vendor(device),
@@ -564,7 +567,7 @@ out:
 	if (tablet)
 		libwacom_destroy(tablet);
 	if (db)
-		libwacom_database_destroy(db);
+		libinput_libwacom_unref(libinput);
 #endif
 	return rc;
 }
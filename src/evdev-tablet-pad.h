@@ -66,6 +66,7 @@ struct pad_dispatch {
 	} sendevents;
 
 	struct {
+		bool initialized;
 		struct list mode_group_list;
 	} modes;
 };
@@ -87,9 +88,24 @@ pad_libinput_context(const struct pad_dispatch *pad)
 int
 pad_init_leds(struct pad_dispatch *pad, struct evdev_device *device);
 void
+pad_init_mode_groups(struct pad_dispatch *pad);
+void
 pad_destroy_leds(struct pad_dispatch *pad);
 void
 pad_button_update_mode(struct libinput_tablet_pad_mode_group *g,
 		       unsigned int pressed_button,
 		       enum libinput_button_state state);
+
+/* The mode groups are set up on first use, not when the device is added:
+ * the libwacom lookup and the LED discovery in sysfs are expensive and
+ * not needed until the caller asks for the groups or the pad sends
+ * events. */
+static inline struct list *
+pad_mode_groups(struct pad_dispatch *pad)
+{
+	if (!pad->modes.initialized)
+		pad_init_mode_groups(pad);
+
+	return &pad->modes.mode_group_list;
+}
 #endif
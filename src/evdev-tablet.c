@@ -23,6 +23,7 @@
 #include "config.h"
 #include "libinput-version.h"
 #include "evdev-tablet.h"
+#include "tracepoints.h"
 
 #include <assert.h>
 #include <stdbool.h>
@@ -390,7 +391,7 @@ normalize_wheel(struct tablet_dispatch *tablet,
 {
 	struct evdev_device *device = tablet->device;
 
-	return value * device->scroll.wheel_click_angle.x;
+	return value * evdev_wheel_click_angle(device).x;
 }
 
 static inline void
@@ -841,19 +842,18 @@ tool_set_bits_from_libwacom(const struct tablet_dispatch *tablet,
 	int rc = 1;
 
 #if HAVE_LIBWACOM
+	struct libinput *libinput = tablet_libinput_context(tablet);
 	WacomDeviceDatabase *db;
 	const WacomStylus *s = NULL;
 	int code;
 	WacomStylusType type;
 	WacomAxisTypeFlags axes;
 
-	db = libwacom_database_new();
-	if (!db) {
-		evdev_log_info(tablet->device,
-			       "Failed to initialize libwacom context.\n");
+	db = libinput_libwacom_ref(libinput);
+	if (!db)
 		goto out;
-	}
-	s = libwacom_stylus_get_for_id(db, tool->tool_id);
+
+	s = libinput_libwacom_get_stylus(libinput, tool->tool_id);
 	if (!s)
 		goto out;
 
@@ -901,7 +901,7 @@ tool_set_bits_from_libwacom(const struct tablet_dispatch *tablet,
 	rc = 0;
 out:
 	if (db)
-		libwacom_database_destroy(db);
+		libinput_libwacom_unref(libinput);
 #endif
 	return rc;
 }
@@ -985,6 +985,30 @@ axis_range_percentage(const struct input_absinfo *a, double percent)
 	return (a->maximum - a->minimum) * percent/100.0 + a->minimum;
 }
 
+static void
+tool_init_pressure(const struct tablet_dispatch *tablet,
+		   struct libinput_tablet_tool *tool)
+{
+	const struct input_absinfo *pressure;
+
+	tool->pressure_threshold.lower = 0;
+	tool->pressure_threshold.upper = 1;
+
+	pressure = libevdev_get_abs_info(tablet->device->evdev, ABS_PRESSURE);
+	if (!pressure)
+		return;
+
+	/* 5 and 1% of the pressure range */
+	tool->pressure_threshold.upper = axis_range_percentage(pressure, 5);
+	tool->pressure_threshold.lower = axis_range_percentage(pressure, 1);
+
+	/* see detect_pressure_offset() */
+	if (tool->has_pressure_offset)
+		tool->pressure_threshold.lower = pressure->minimum;
+	else
+		tool->pressure_offset = pressure->minimum;
+}
+
 static struct libinput_tablet_tool *
 tablet_get_tool(struct tablet_dispatch *tablet,
 		enum libinput_tablet_tool_type type,
@@ -993,16 +1017,16 @@ tablet_get_tool(struct tablet_dispatch *tablet,
 {
 	struct libinput *libinput = tablet_libinput_context(tablet);
 	struct libinput_tablet_tool *tool = NULL, *t;
-	struct list *tool_list;
 
 	if (serial) {
-		tool_list = &libinput->tool_list;
 		/* Check if we already have the tool in our list of tools */
-		list_for_each(t, tool_list, link) {
-			if (type == t->type && serial == t->serial) {
-				tool = t;
-				break;
-			}
+		tool = libinput_tool_table_find(libinput, type, serial);
+
+		/* Loaded from the tool cache, the capabilities are known
+		 * but the thresholds depend on the tablet */
+		if (tool && !tool->initialized) {
+			tool_init_pressure(tablet, tool);
+			tool->initialized = true;
 		}
 	}
 
@@ -1012,31 +1036,23 @@ tablet_get_tool(struct tablet_dispatch *tablet,
 	 * https://bugs.freedesktop.org/show_bug.cgi?id=97526
 	 */
 	if (!tool) {
-		tool_list = &tablet->tool_list;
 		/* We can't guarantee that tools without serial numbers are
 		 * unique, so we keep them local to the tablet that they come
 		 * into proximity of instead of storing them in the global tool
 		 * list
 		 * Same as above, but don't bother checking the serial number
 		 */
-		list_for_each(t, tool_list, link) {
+		list_for_each(t, &tablet->tool_list, link) {
 			if (type == t->type) {
 				tool = t;
 				break;
 			}
 		}
-
-		/* Didn't find the tool but we have a serial. Switch
-		 * tool_list back so we create in the correct list */
-		if (!tool && serial)
-			tool_list = &libinput->tool_list;
 	}
 
 	/* If we didn't already have the new_tool in our list of tools,
 	 * add it */
 	if (!tool) {
-		const struct input_absinfo *pressure;
-
 		tool = zalloc(sizeof *tool);
 
 		*tool = (struct libinput_tablet_tool) {
@@ -1044,28 +1060,21 @@ tablet_get_tool(struct tablet_dispatch *tablet,
 			.serial = serial,
 			.tool_id = tool_id,
 			.refcount = 1,
+			.initialized = true,
 		};
 
 		tool->pressure_offset = 0;
 		tool->has_pressure_offset = false;
-		tool->pressure_threshold.lower = 0;
-		tool->pressure_threshold.upper = 1;
-
-		pressure = libevdev_get_abs_info(tablet->device->evdev,
-						 ABS_PRESSURE);
-		if (pressure) {
-			tool->pressure_offset = pressure->minimum;
-
-			/* 5 and 1% of the pressure range */
-			tool->pressure_threshold.upper =
-				axis_range_percentage(pressure, 5);
-			tool->pressure_threshold.lower =
-				axis_range_percentage(pressure, 1);
-		}
+		tool_init_pressure(tablet, tool);
 
 		tool_set_bits(tablet, tool);
 
-		list_insert(tool_list, &tool->link);
+		/* Didn't find the tool but we have a serial, it goes into
+		 * the context's tool table */
+		if (serial)
+			libinput_tool_table_insert(libinput, tool);
+		else
+			list_insert(&tablet->tool_list, &tool->link);
 	}
 
 	return tool;
@@ -1559,6 +1568,8 @@ tablet_flush(struct tablet_dispatch *tablet,
 {
 	struct libinput_tablet_tool *tool;
 
+	trace_point2(tablet_flush, evdev_device_get_sysname(device), time);
+
 	if (tablet->current_tool_type == LIBINPUT_TOOL_NONE)
 		return;
 
@@ -1646,6 +1657,16 @@ tablet_reset_state(struct tablet_dispatch *tablet)
 	       sizeof(tablet->button_state));
 }
 
+static inline void
+tablet_handle_frame(struct tablet_dispatch *tablet,
+		    struct evdev_device *device,
+		    uint64_t time)
+{
+	tablet_flush(tablet, device, time);
+	tablet_toggle_touch_device(tablet, device, time);
+	tablet_reset_state(tablet);
+}
+
 static inline void
 tablet_proximity_out_quirk_set_timer(struct tablet_dispatch *tablet,
 				     uint64_t time)
@@ -1791,9 +1812,7 @@ tablet_process(struct evdev_dispatch *dispatch,
 		tablet_process_misc(tablet, device, e, time);
 		break;
 	case EV_SYN:
-		tablet_flush(tablet, device, time);
-		tablet_toggle_touch_device(tablet, device, time);
-		tablet_reset_state(tablet);
+		tablet_handle_frame(tablet, device, time);
 		break;
 	default:
 		evdev_log_error(device,
@@ -1836,6 +1855,12 @@ tablet_destroy(struct evdev_dispatch *dispatch)
 	free(tablet);
 }
 
+static uint32_t
+tablet_pair_interests(struct evdev_device *device)
+{
+	return AS_MASK(EVDEV_PAIR_TOUCH);
+}
+
 static void
 tablet_device_added(struct evdev_device *device,
 		    struct evdev_device *added_device)
@@ -1909,9 +1934,11 @@ tablet_check_initial_proximity(struct evdev_device *device,
 
 static struct evdev_dispatch_interface tablet_interface = {
 	.process = tablet_process,
+	.process_frame = NULL,
 	.suspend = tablet_suspend,
 	.remove = NULL,
 	.destroy = tablet_destroy,
+	.pair_interests = tablet_pair_interests,
 	.device_added = tablet_device_added,
 	.device_removed = tablet_device_removed,
 	.device_suspended = NULL,
@@ -2094,7 +2121,7 @@ tablet_init(struct tablet_dispatch *tablet,
 		tablet->quirks.need_to_force_prox_out = true;
 
 	libinput_timer_init(&tablet->quirks.prox_out_timer,
-			    tablet_libinput_context(tablet),
+			    &tablet->device->base,
 			    "proxout",
 			    tablet_proximity_out_quirk_timer_func,
 			    tablet);
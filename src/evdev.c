@@ -27,6 +27,7 @@
 #include "config.h"
 
 #include <errno.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
@@ -38,12 +39,15 @@
 #include <assert.h>
 #include <time.h>
 #include <math.h>
+#include <pthread.h>
+#include <signal.h>
 
 #include "libinput.h"
 #include "evdev.h"
 #include "filter.h"
 #include "libinput-private.h"
 #include "quirks.h"
+#include "tracepoints.h"
 
 #if HAVE_LIBWACOM
 #include <libwacom/libwacom.h>
@@ -688,7 +692,7 @@ evdev_init_button_scroll(struct evdev_device *device,
 		 "%s btnscroll",
 		 evdev_device_get_sysname(device));
 	libinput_timer_init(&device->scroll.timer,
-			    evdev_libinput_context(device),
+			    &device->base,
 			    timer_name,
 			    evdev_button_scroll_timeout, device);
 	device->scroll.config.get_methods = evdev_scroll_get_methods;
@@ -858,20 +862,121 @@ evdev_print_event(struct evdev_device *device,
 	}
 }
 
+static inline uint64_t
+evdev_now_nsec(void)
+{
+	struct timespec ts = { 0, 0 };
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
 static inline void
-evdev_process_event(struct evdev_device *device, struct input_event *e)
+evdev_process_frame(struct evdev_device *device)
 {
+	struct libinput *libinput = evdev_libinput_context(device);
 	struct evdev_dispatch *dispatch = device->dispatch;
-	uint64_t time = tv2us(&e->time);
+	struct input_event *events = device->frame.events;
+	size_t count = device->frame.count;
+	uint64_t time, start = 0;
+	bool timed;
+
+	if (count == 0)
+		return;
+
+	/* The kernel stamps all events within a frame with the same time,
+	 * so one timer flush per frame is enough. */
+	time = tv2us(&events[count - 1].time);
+	libinput_timer_flush(libinput, time);
+
+	trace_point3(frame, evdev_device_get_sysname(device), count, time);
 
 #if 0
-	evdev_print_event(device, e);
+	for (size_t i = 0; i < count; i++)
+		evdev_print_event(device, &events[i]);
 #endif
-	libinput_timer_flush(evdev_libinput_context(device), time);
 
-	libinput_timer_flush(evdev_libinput_context(device), time);
+	/* The processing time is only measured with latency tracing
+	 * enabled, it costs two clock lookups per frame. Events posted
+	 * until the end of the frame are attributed to it. */
+	timed = libinput->latency_tracing;
+	if (timed) {
+		start = evdev_now_nsec();
+		device->base.latency.in_frame = true;
+		device->base.latency.frame_time = time;
+		device->base.latency.read_time = ns2us(start);
+	}
+
+	if (dispatch->interface->process_frame) {
+		dispatch->interface->process_frame(dispatch,
+						   device,
+						   events,
+						   count,
+						   time);
+	} else {
+		for (size_t i = 0; i < count; i++)
+			dispatch->interface->process(dispatch,
+						     device,
+						     &events[i],
+						     tv2us(&events[i].time));
+	}
+
+	if (timed) {
+		device->base.latency.in_frame = false;
+		device->base.stats.process_nsec += evdev_now_nsec() - start;
+	}
+	device->base.stats.frames++;
+	device->frame.count = 0;
+}
+
+static inline bool
+evdev_frame_grow(struct evdev_device *device)
+{
+	size_t size = min(device->frame.size * 2, EVDEV_FRAME_MAX_EVENTS);
+	struct input_event *events;
+
+	if (size <= device->frame.size)
+		return false;
+
+	events = realloc(device->frame.events, size * sizeof(*events));
+	if (!events)
+		return false;
+
+	device->frame.events = events;
+	device->frame.size = size;
+
+	return true;
+}
+
+static inline void
+evdev_frame_append(struct evdev_device *device,
+		   const struct input_event *e)
+{
+	/* One slot is always kept free for the SYN_REPORT. If the buffer
+	 * cannot grow any further, terminate the frame early like we do
+	 * for SYN_DROPPED, a device that never sends a SYN_REPORT must
+	 * not make us buffer forever. */
+	if (device->frame.count + 1 >= device->frame.size &&
+	    !evdev_frame_grow(device) &&
+	    !libevdev_event_is_code(e, EV_SYN, SYN_REPORT)) {
+		struct input_event syn = {
+			.time = e->time,
+			.type = EV_SYN,
+			.code = SYN_REPORT,
+			.value = 0,
+		};
+
+		evdev_log_info_ratelimit(device,
+					 &device->frame_overflow_limit,
+					 "frame exceeds %zd events without SYN_REPORT, processing it early\n",
+					 device->frame.size);
 
-	dispatch->interface->process(dispatch, device, e, time);
+		device->frame.events[device->frame.count++] = syn;
+		evdev_process_frame(device);
+	}
+
+	device->frame.events[device->frame.count++] = *e;
 }
 
 static inline void
@@ -879,17 +984,43 @@ evdev_device_dispatch_one(struct evdev_device *device,
 			  struct input_event *ev)
 {
 	if (!device->mtdev) {
-		evdev_process_event(device, ev);
+		evdev_frame_append(device, ev);
 	} else {
 		mtdev_put_event(device->mtdev, ev);
 		if (libevdev_event_is_code(ev, EV_SYN, SYN_REPORT)) {
 			while (!mtdev_empty(device->mtdev)) {
 				struct input_event e;
 				mtdev_get_event(device->mtdev, &e);
-				evdev_process_event(device, &e);
+				evdev_frame_append(device, &e);
 			}
 		}
 	}
+
+	if (libevdev_event_is_code(ev, EV_SYN, SYN_REPORT))
+		evdev_process_frame(device);
+}
+
+/**
+ * Process events as if they were read from the kernel device, bypassing
+ * the fd. The libevdev state is updated to match. Used by the benchmarks
+ * to measure event processing without kernel round trips.
+ */
+void
+evdev_device_inject_events(struct evdev_device *device,
+			   const struct input_event *events,
+			   size_t nevents)
+{
+	for (size_t i = 0; i < nevents; i++) {
+		struct input_event ev = events[i];
+
+		if (ev.type != EV_SYN)
+			libevdev_set_event_value(device->evdev,
+						 ev.type,
+						 ev.code,
+						 ev.value);
+		device->base.stats.input_events++;
+		evdev_device_dispatch_one(device, &ev);
+	}
 }
 
 static int
@@ -903,6 +1034,7 @@ evdev_sync_device(struct evdev_device *device)
 					 LIBEVDEV_READ_FLAG_SYNC, &ev);
 		if (rc < 0)
 			break;
+		device->base.stats.input_events++;
 		evdev_device_dispatch_one(device, &ev);
 	} while (rc == LIBEVDEV_READ_STATUS_SYNC);
 
@@ -915,15 +1047,22 @@ evdev_device_dispatch(void *data)
 	struct evdev_device *device = data;
 	struct libinput *libinput = evdev_libinput_context(device);
 	struct input_event ev;
+	unsigned int nevents = 0;
+	bool within_budget = true;
 	int rc;
 
 	/* If the compositor is repainting, this function is called only once
 	 * per frame and we have to process all the events available on the
-	 * fd, otherwise there will be input lag. */
+	 * fd, otherwise there will be input lag. The exception is a caller
+	 * that set a dispatch budget, we stop after a frame once that is
+	 * exhausted and libinput_dispatch() calls us again later. */
+	trace_point1(dispatch_start, evdev_device_get_sysname(device));
+
 	do {
 		rc = libevdev_next_event(device->evdev,
 					 LIBEVDEV_READ_FLAG_NORMAL, &ev);
 		if (rc == LIBEVDEV_READ_STATUS_SYNC) {
+			device->base.stats.syn_dropped++;
 			evdev_log_info_ratelimit(device,
 						 &device->syn_drop_limit,
 						 "SYN_DROPPED event - some input events have been lost.\n");
@@ -938,11 +1077,23 @@ evdev_device_dispatch(void *data)
 			if (rc == 0)
 				rc = LIBEVDEV_READ_STATUS_SUCCESS;
 		} else if (rc == LIBEVDEV_READ_STATUS_SUCCESS) {
+			device->base.stats.input_events++;
 			evdev_device_dispatch_one(device, &ev);
+
+			nevents++;
+			if (libevdev_event_is_code(&ev, EV_SYN, SYN_REPORT)) {
+				within_budget = libinput_dispatch_budget_consume(
+								libinput,
+								nevents);
+				nevents = 0;
+			}
 		}
-	} while (rc == LIBEVDEV_READ_STATUS_SUCCESS);
+	} while (rc == LIBEVDEV_READ_STATUS_SUCCESS && within_budget);
 
-	if (rc != -EAGAIN && rc != -EINTR) {
+	trace_point2(dispatch_done, evdev_device_get_sysname(device), rc);
+
+	if (rc != LIBEVDEV_READ_STATUS_SUCCESS &&
+	    rc != -EAGAIN && rc != -EINTR) {
 		libinput_remove_source(libinput, device->source);
 		device->source = NULL;
 	}
@@ -1177,6 +1328,15 @@ evdev_read_wheel_tilt_props(struct evdev_device *device)
 	return flags;
 }
 
+void
+evdev_read_wheel_props(struct evdev_device *device)
+{
+	device->scroll.wheel_click_angle =
+		evdev_read_wheel_click_props(device);
+	device->scroll.is_tilt = evdev_read_wheel_tilt_props(device);
+	device->scroll.have_wheel_props = true;
+}
+
 static inline int
 evdev_get_trackpoint_range(struct evdev_device *device)
 {
@@ -1811,35 +1971,221 @@ evdev_configure_device(struct evdev_device *device)
 	return fallback_dispatch_create(&device->base);
 }
 
+static uint32_t
+evdev_device_pair_classes(struct evdev_device *device)
+{
+	uint32_t classes = 0;
+
+	if (device->tags & EVDEV_TAG_KEYBOARD)
+		classes |= AS_MASK(EVDEV_PAIR_KEYBOARD);
+	if (device->tags & EVDEV_TAG_TRACKPOINT)
+		classes |= AS_MASK(EVDEV_PAIR_TRACKPOINT);
+	if (device->tags & EVDEV_TAG_LID_SWITCH)
+		classes |= AS_MASK(EVDEV_PAIR_LID_SWITCH);
+	if (device->tags & EVDEV_TAG_TABLET_MODE_SWITCH)
+		classes |= AS_MASK(EVDEV_PAIR_TABLET_MODE_SWITCH);
+	if (device->tags & EVDEV_TAG_EXTERNAL_MOUSE)
+		classes |= AS_MASK(EVDEV_PAIR_EXTERNAL_MOUSE);
+	if (evdev_device_has_capability(device, LIBINPUT_DEVICE_CAP_TOUCH) ||
+	    (evdev_device_has_capability(device, LIBINPUT_DEVICE_CAP_POINTER) &&
+	     (device->tags & EVDEV_TAG_EXTERNAL_TOUCHPAD)))
+		classes |= AS_MASK(EVDEV_PAIR_TOUCH);
+
+	return classes;
+}
+
+static struct evdev_pairing *
+evdev_seat_get_pairing(struct libinput_seat *seat)
+{
+	struct evdev_pairing *pairing = seat->pairing;
+
+	if (pairing)
+		return pairing;
+
+	pairing = zalloc(sizeof *pairing);
+	for (int c = 0; c < EVDEV_PAIR_NCLASSES; c++) {
+		list_init(&pairing->members[c]);
+		list_init(&pairing->listeners[c]);
+	}
+	seat->pairing = pairing;
+
+	return pairing;
+}
+
 static void
-evdev_notify_added_device(struct evdev_device *device)
+evdev_pairing_register(struct evdev_device *device)
 {
-	struct libinput_device *dev;
+	struct evdev_pairing *pairing =
+		evdev_seat_get_pairing(device->base.seat);
+
+	for (int c = 0; c < EVDEV_PAIR_NCLASSES; c++) {
+		device->pairing.members[c].device = device;
+		device->pairing.listeners[c].device = device;
 
-	list_for_each(dev, &device->base.seat->devices_list, link) {
-		struct evdev_device *d = evdev_device(dev);
-		if (dev == &device->base)
+		if (device->pairing.classes & AS_MASK(c))
+			list_append(&pairing->members[c],
+				    &device->pairing.members[c].link);
+		if (device->pairing.interests & AS_MASK(c))
+			list_append(&pairing->listeners[c],
+				    &device->pairing.listeners[c].link);
+	}
+}
+
+static void
+evdev_pairing_unregister(struct evdev_device *device)
+{
+	for (int c = 0; c < EVDEV_PAIR_NCLASSES; c++) {
+		if (device->pairing.classes & AS_MASK(c))
+			list_remove(&device->pairing.members[c].link);
+		if (device->pairing.interests & AS_MASK(c))
+			list_remove(&device->pairing.listeners[c].link);
+	}
+
+	device->pairing.classes = 0;
+	device->pairing.interests = 0;
+}
+
+enum evdev_pair_notification {
+	PAIR_ADDED,
+	PAIR_REMOVED,
+	PAIR_SUSPENDED,
+	PAIR_RESUMED,
+};
+
+/**
+ * Notify all devices interested in any of the classes of the given
+ * device. Each device is notified once only, even when it's interested
+ * in more than one class of the device.
+ */
+static void
+evdev_pairing_notify_listeners(struct evdev_device *device,
+			       enum evdev_pair_notification which)
+{
+	struct evdev_pairing *pairing = device->base.seat->pairing;
+	uint32_t classes = device->pairing.classes;
+	struct evdev_pair_link *l;
+
+	if (!pairing)
+		return;
+
+	for (int c = 0; c < EVDEV_PAIR_NCLASSES; c++) {
+		if ((classes & AS_MASK(c)) == 0)
 			continue;
 
-		/* Notify existing device d about addition of device */
-		if (d->dispatch->interface->device_added)
-			d->dispatch->interface->device_added(d, device);
+		list_for_each(l, &pairing->listeners[c], link) {
+			struct evdev_device *d = l->device;
+			struct evdev_dispatch_interface *interface =
+				d->dispatch->interface;
+
+			if (d == device)
+				continue;
+
+			/* already notified for an earlier class */
+			if (d->pairing.interests & classes & (AS_MASK(c) - 1))
+				continue;
+
+			switch (which) {
+			case PAIR_ADDED:
+				if (interface->device_added)
+					interface->device_added(d, device);
+				break;
+			case PAIR_REMOVED:
+				if (interface->device_removed)
+					interface->device_removed(d, device);
+				break;
+			case PAIR_SUSPENDED:
+				if (interface->device_suspended)
+					interface->device_suspended(d, device);
+				break;
+			case PAIR_RESUMED:
+				if (interface->device_resumed)
+					interface->device_resumed(d, device);
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * Notify a new device about all existing devices in the classes it is
+ * interested in.
+ */
+static void
+evdev_pairing_notify_new_device(struct evdev_device *device)
+{
+	struct evdev_pairing *pairing = device->base.seat->pairing;
+	struct evdev_dispatch_interface *interface = device->dispatch->interface;
+	uint32_t interests = device->pairing.interests;
+	struct evdev_pair_link *l;
+
+	if (!pairing)
+		return;
+
+	for (int c = 0; c < EVDEV_PAIR_NCLASSES; c++) {
+		if ((interests & AS_MASK(c)) == 0)
+			continue;
 
-		/* Notify new device about existing device d */
-		if (device->dispatch->interface->device_added)
-			device->dispatch->interface->device_added(device, d);
+		list_for_each(l, &pairing->members[c], link) {
+			struct evdev_device *d = l->device;
 
-		/* Notify new device if existing device d is suspended */
-		if (d->is_suspended &&
-		    device->dispatch->interface->device_suspended)
-			device->dispatch->interface->device_suspended(device, d);
+			if (d == device)
+				continue;
+
+			/* already notified for an earlier class */
+			if (d->pairing.classes & interests & (AS_MASK(c) - 1))
+				continue;
+
+			if (interface->device_added)
+				interface->device_added(device, d);
+
+			if (d->is_suspended && interface->device_suspended)
+				interface->device_suspended(device, d);
+		}
+	}
+}
+
+bool
+evdev_seat_has_peer(struct libinput_seat *seat,
+		    enum evdev_pair_class class,
+		    struct evdev_device *except)
+{
+	struct evdev_pair_link *l;
+
+	if (!seat->pairing)
+		return false;
+
+	list_for_each(l, &seat->pairing->members[class], link) {
+		if (l->device != except)
+			return true;
 	}
 
+	return false;
+}
+
+static void
+evdev_notify_added_device(struct evdev_device *device)
+{
+	struct evdev_dispatch_interface *interface = device->dispatch->interface;
+
+	/* Tags and capabilities are final by now, so the device's place in
+	 * the pairing registry never changes */
+	device->pairing.classes = evdev_device_pair_classes(device);
+	if (interface->pair_interests)
+		device->pairing.interests = interface->pair_interests(device);
+
+	/* Notify existing devices about addition of device */
+	evdev_pairing_notify_listeners(device, PAIR_ADDED);
+
+	/* Notify new device about existing devices and whether they are
+	 * suspended */
+	evdev_pairing_notify_new_device(device);
+
+	evdev_pairing_register(device);
+
 	notify_added_device(&device->base);
 
-	if (device->dispatch->interface->post_added)
-		device->dispatch->interface->post_added(device,
-							device->dispatch);
+	if (interface->post_added)
+		interface->post_added(device, device->dispatch);
 }
 
 static bool
@@ -2025,43 +2371,120 @@ udev_device_should_be_ignored(struct udev_device *udev_device)
 	return value && !streq(value, "0");
 }
 
-struct evdev_device *
-evdev_device_create(struct libinput_seat *seat,
-		    struct udev_device *udev_device)
+/* Use non-blocking mode so that we can loop on read on
+ * evdev_device_data() until all events on the fd are
+ * read.  mtdev_get() also expects this. */
+#define EVDEV_OPEN_FLAGS (O_RDWR | O_NONBLOCK | O_CLOEXEC)
+
+/**
+ * Check whether the probe's device can be created at all.
+ */
+static bool
+evdev_device_probe_check(struct evdev_device_probe *probe)
 {
-	struct libinput *libinput = seat->libinput;
-	struct evdev_device *device = NULL;
-	int rc;
-	int fd;
-	int unhandled_device = 0;
+	struct libinput *libinput = probe->seat->libinput;
+	struct udev_device *udev_device = probe->udev_device;
 	const char *devnode = udev_device_get_devnode(udev_device);
 	const char *sysname = udev_device_get_sysname(udev_device);
 
+	probe->fd = -1;
+	probe->evdev = NULL;
+	probe->device = NULL;
+	probe->cancelled = false;
+
 	if (!devnode) {
 		log_info(libinput, "%s: no device node associated\n", sysname);
-		return NULL;
+		return false;
 	}
 
 	if (udev_device_should_be_ignored(udev_device)) {
 		log_debug(libinput, "%s: device is ignored\n", sysname);
-		return NULL;
+		return false;
 	}
 
-	/* Use non-blocking mode so that we can loop on read on
-	 * evdev_device_data() until all events on the fd are
-	 * read.  mtdev_get() also expects this. */
-	fd = open_restricted(libinput, devnode,
-			     O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	return true;
+}
+
+/**
+ * Take the fd (or negative errno) from open_restricted() for the probe.
+ *
+ * @return false if the device can't be created
+ */
+static bool
+evdev_device_probe_opened(struct evdev_device_probe *probe, int fd)
+{
+	struct libinput *libinput = probe->seat->libinput;
+	struct udev_device *udev_device = probe->udev_device;
+
 	if (fd < 0) {
 		log_info(libinput,
 			 "%s: opening input device '%s' failed (%s).\n",
-			 sysname,
-			 devnode,
+			 udev_device_get_sysname(udev_device),
+			 udev_device_get_devnode(udev_device),
 			 strerror(-fd));
-		return NULL;
+		return false;
+	}
+
+	if (!evdev_device_have_same_syspath(udev_device, fd)) {
+		close_restricted(libinput, fd);
+		return false;
 	}
 
-	if (!evdev_device_have_same_syspath(udev_device, fd))
+	probe->fd = fd;
+
+	return true;
+}
+
+/**
+ * The first step of creating a device, called from the caller's thread:
+ * open the device node.
+ *
+ * @return false if the device can't be created
+ */
+static bool
+evdev_device_probe_open(struct evdev_device_probe *probe)
+{
+	struct libinput *libinput = probe->seat->libinput;
+	int fd;
+
+	if (!evdev_device_probe_check(probe))
+		return false;
+
+	fd = open_restricted(libinput,
+			     udev_device_get_devnode(probe->udev_device),
+			     EVDEV_OPEN_FLAGS);
+
+	return evdev_device_probe_opened(probe, fd);
+}
+
+/**
+ * The second step of creating a device: the ioctls to set up the
+ * libevdev context. This only touches the fd and may be called from any
+ * thread.
+ */
+static void
+evdev_device_probe_read(struct evdev_device_probe *probe)
+{
+	evdev_drain_fd(probe->fd);
+
+	probe->rc = libevdev_new_from_fd(probe->fd, &probe->evdev);
+}
+
+/**
+ * The last step of creating a device, called from the caller's thread:
+ * configure the device and add it to the seat.
+ */
+static struct evdev_device *
+evdev_device_probe_finish(struct evdev_device_probe *probe)
+{
+	struct libinput_seat *seat = probe->seat;
+	struct libinput *libinput = seat->libinput;
+	struct udev_device *udev_device = probe->udev_device;
+	struct evdev_device *device = NULL;
+	int fd = probe->fd;
+	int unhandled_device = 0;
+
+	if (probe->rc != 0)
 		goto err;
 
 	device = zalloc(sizeof *device);
@@ -2069,11 +2492,8 @@ evdev_device_create(struct libinput_seat *seat,
 	libinput_device_init(&device->base, seat);
 	libinput_seat_ref(seat);
 
-	evdev_drain_fd(fd);
-
-	rc = libevdev_new_from_fd(fd, &device->evdev);
-	if (rc != 0)
-		goto err;
+	device->evdev = probe->evdev;
+	probe->evdev = NULL;
 
 	libevdev_set_clock_id(device->evdev, CLOCK_MONOTONIC);
 	libevdev_set_device_log_function(device->evdev,
@@ -2090,14 +2510,16 @@ evdev_device_create(struct libinput_seat *seat,
 	device->scroll.threshold = 5.0; /* Default may be overridden */
 	device->scroll.direction_lock_threshold = 5.0; /* Default may be overridden */
 	device->scroll.direction = 0;
-	device->scroll.wheel_click_angle =
-		evdev_read_wheel_click_props(device);
-	device->scroll.is_tilt = evdev_read_wheel_tilt_props(device);
 	device->model_flags = evdev_read_model_flags(device);
 	device->dpi = DEFAULT_MOUSE_DPI;
 
 	/* at most 5 SYN_DROPPED log-messages per 30s */
 	ratelimit_init(&device->syn_drop_limit, s2us(30), 5);
+	/* at most 5 frame overflow log-messages per 30s */
+	ratelimit_init(&device->frame_overflow_limit, s2us(30), 5);
+	device->frame.size = EVDEV_FRAME_MIN_EVENTS;
+	device->frame.events = zalloc(device->frame.size *
+				      sizeof(*device->frame.events));
 	/* at most 5 log-messages per 5s */
 	ratelimit_init(&device->nonpointer_rel_limit, s2us(5), 5);
 
@@ -2133,10 +2555,192 @@ err:
 		close_restricted(libinput, fd);
 	if (device)
 		evdev_device_destroy(device);
+	else if (probe->evdev)
+		libevdev_free(probe->evdev);
+	probe->evdev = NULL;
 
 	return unhandled_device ? EVDEV_UNHANDLED_DEVICE :  NULL;
 }
 
+/* More threads than that only contend on the same kernel locks */
+#define EVDEV_PROBE_MAX_THREADS 8
+
+struct evdev_probe_pool {
+	struct evdev_device_probe *probes;
+	size_t nprobes;
+	size_t next; /* next probe to read, atomic */
+};
+
+static void *
+evdev_probe_pool_worker(void *data)
+{
+	struct evdev_probe_pool *pool = data;
+	size_t idx;
+
+	while ((idx = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED)) <
+	       pool->nprobes) {
+		struct evdev_device_probe *probe = &pool->probes[idx];
+
+		if (probe->fd >= 0)
+			evdev_device_probe_read(probe);
+	}
+
+	return NULL;
+}
+
+/**
+ * Run evdev_device_probe_read() for all probes, on as many threads as
+ * make sense. The caller's thread takes part, so this works even if we
+ * can't create any threads.
+ */
+static void
+evdev_probe_pool_run(struct evdev_device_probe *probes, size_t nprobes)
+{
+	struct evdev_probe_pool pool = {
+		.probes = probes,
+		.nprobes = nprobes,
+		.next = 0,
+	};
+	pthread_t threads[EVDEV_PROBE_MAX_THREADS];
+	size_t nthreads = 0;
+	long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t maxthreads;
+	sigset_t all, old;
+
+	maxthreads = min(nprobes, EVDEV_PROBE_MAX_THREADS);
+	if (ncpus > 0)
+		maxthreads = min(maxthreads, (size_t)ncpus);
+
+	/* The threads inherit the signal mask, the caller's signals
+	 * must only ever be delivered to the caller's threads */
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+
+	/* the caller's thread is worker number one */
+	for (size_t i = 1; i < maxthreads; i++) {
+		if (pthread_create(&threads[nthreads],
+				   NULL,
+				   evdev_probe_pool_worker,
+				   &pool) != 0)
+			break;
+		nthreads++;
+	}
+
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	evdev_probe_pool_worker(&pool);
+
+	for (size_t i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+}
+
+/**
+ * Create the devices for all probes. The caller must fill in the seat
+ * and the udev device for each probe, on return probe->device is set to
+ * what evdev_device_create() would return for that udev device.
+ *
+ * The slow part of creating a device is the ioctls to query the device,
+ * these run in parallel. Everything else, including the calls to
+ * open_restricted() and the device added events, happens in the caller's
+ * thread, in the order of the probes.
+ */
+void
+evdev_device_create_all(struct evdev_device_probe *probes, size_t nprobes)
+{
+	size_t nopened = 0;
+
+	for (size_t i = 0; i < nprobes; i++) {
+		if (evdev_device_probe_open(&probes[i]))
+			nopened++;
+	}
+
+	if (nopened > 1) {
+		evdev_probe_pool_run(probes, nprobes);
+	} else {
+		for (size_t i = 0; i < nprobes; i++) {
+			if (probes[i].fd >= 0)
+				evdev_device_probe_read(&probes[i]);
+		}
+	}
+
+	for (size_t i = 0; i < nprobes; i++) {
+		if (probes[i].fd >= 0)
+			probes[i].device = evdev_device_probe_finish(&probes[i]);
+	}
+}
+
+static void
+evdev_device_create_async_opened(struct libinput *libinput,
+				 int fd,
+				 void *data)
+{
+	struct evdev_device_probe *probe = data;
+
+	if (fd == -ECANCELED) {
+		probe->cancelled = true;
+	} else if (evdev_device_probe_opened(probe, fd)) {
+		evdev_device_probe_read(probe);
+		probe->device = evdev_device_probe_finish(probe);
+	}
+
+	probe->done(probe, probe->done_data);
+}
+
+/**
+ * Create the device for the probe, opening the device node with the
+ * caller's asynchronous open function if there is one. done is called
+ * once the probe's device is set, either before this function returns
+ * or from a later libinput_dispatch(). If the open was cancelled by
+ * evdev_device_create_async_cancel() or libinput_open_cancel_all(),
+ * probe->cancelled is set.
+ */
+void
+evdev_device_create_async(struct evdev_device_probe *probe,
+			  evdev_device_probe_done_func done,
+			  void *data)
+{
+	struct libinput *libinput = probe->seat->libinput;
+
+	probe->done = done;
+	probe->done_data = data;
+
+	if (!evdev_device_probe_check(probe)) {
+		done(probe, data);
+		return;
+	}
+
+	open_restricted_async(libinput,
+			      udev_device_get_devnode(probe->udev_device),
+			      EVDEV_OPEN_FLAGS,
+			      evdev_device_create_async_opened,
+			      probe);
+}
+
+/**
+ * Cancel the open of a probe passed to evdev_device_create_async(),
+ * done is called before this function returns. Does nothing if the
+ * probe's done was called already.
+ */
+void
+evdev_device_create_async_cancel(struct evdev_device_probe *probe)
+{
+	libinput_open_cancel(probe->seat->libinput, probe);
+}
+
+struct evdev_device *
+evdev_device_create(struct libinput_seat *seat,
+		    struct udev_device *udev_device)
+{
+	struct evdev_device_probe probe = {
+		.seat = seat,
+		.udev_device = udev_device,
+	};
+
+	evdev_device_create_all(&probe, 1);
+
+	return probe.device;
+}
+
 const char *
 evdev_device_get_output(struct evdev_device *device)
 {
@@ -2528,19 +3132,10 @@ evdev_stop_scroll(struct evdev_device *device,
 void
 evdev_notify_suspended_device(struct evdev_device *device)
 {
-	struct libinput_device *it;
-
 	if (device->is_suspended)
 		return;
 
-	list_for_each(it, &device->base.seat->devices_list, link) {
-		struct evdev_device *d = evdev_device(it);
-		if (it == &device->base)
-			continue;
-
-		if (d->dispatch->interface->device_suspended)
-			d->dispatch->interface->device_suspended(d, device);
-	}
+	evdev_pairing_notify_listeners(device, PAIR_SUSPENDED);
 
 	device->is_suspended = true;
 }
@@ -2548,19 +3143,10 @@ evdev_notify_suspended_device(struct evdev_device *device)
 void
 evdev_notify_resumed_device(struct evdev_device *device)
 {
-	struct libinput_device *it;
-
 	if (!device->is_suspended)
 		return;
 
-	list_for_each(it, &device->base.seat->devices_list, link) {
-		struct evdev_device *d = evdev_device(it);
-		if (it == &device->base)
-			continue;
-
-		if (d->dispatch->interface->device_resumed)
-			d->dispatch->interface->device_resumed(d, device);
-	}
+	evdev_pairing_notify_listeners(device, PAIR_RESUMED);
 
 	device->is_suspended = false;
 }
@@ -2586,20 +3172,92 @@ evdev_device_suspend(struct evdev_device *device)
 		device->mtdev = NULL;
 	}
 
+	/* a partial frame is meaningless once we resync on resume */
+	device->frame.count = 0;
+
 	if (device->fd != -1) {
+		/* With a dispatch budget, we may have stopped with events
+		 * that libevdev read but we haven't seen yet. libevdev's
+		 * state doesn't include them, only a resync gets rid of
+		 * them. */
+		if (libevdev_has_event_pending(device->evdev) > 0)
+			device->resync_on_resume = true;
+
 		close_restricted(libinput, device->fd);
 		device->fd = -1;
 	}
 }
 
+/* libevdev's view of a device that only sends relative motion and keys
+ * cannot go stale while the fd is closed, unless a key was down at the
+ * time of the suspend. In that case libevdev would swallow the next press
+ * of that key, so only those devices and anything with absolute axes or
+ * switches need the full resync on resume. So does a device suspended
+ * with events still queued in libevdev, see evdev_device_suspend(). */
+static bool
+evdev_device_needs_resync(struct evdev_device *device)
+{
+	struct libevdev *evdev = device->evdev;
+
+	if (device->resync_on_resume)
+		return true;
+
+	if (libevdev_has_event_type(evdev, EV_ABS) ||
+	    libevdev_has_event_type(evdev, EV_SW))
+		return true;
+
+	if (!libevdev_has_event_type(evdev, EV_KEY))
+		return false;
+
+	for (unsigned int code = 0; code <= KEY_MAX; code++) {
+		if (libevdev_has_event_code(evdev, EV_KEY, code) &&
+		    libevdev_get_event_value(evdev, EV_KEY, code))
+			return true;
+	}
+
+	return false;
+}
+
+static void
+evdev_device_resync(struct evdev_device *device)
+{
+	struct input_event ev;
+	enum libevdev_read_status status;
+
+	/* re-sync libevdev's view of the device, but discard the actual
+	   events. Our device is in a neutral state already */
+	libevdev_next_event(device->evdev,
+			    LIBEVDEV_READ_FLAG_FORCE_SYNC,
+			    &ev);
+	do {
+		status = libevdev_next_event(device->evdev,
+					     LIBEVDEV_READ_FLAG_SYNC,
+					     &ev);
+	} while (status == LIBEVDEV_READ_STATUS_SYNC);
+}
+
+static void
+evdev_device_resume_failed(struct evdev_device *device)
+{
+	struct libinput *libinput = evdev_libinput_context(device);
+
+	if (device->mtdev) {
+		mtdev_close_delete(device->mtdev);
+		device->mtdev = NULL;
+	}
+
+	close_restricted(libinput, device->fd);
+	device->fd = -1;
+}
+
 int
 evdev_device_resume(struct evdev_device *device)
 {
 	struct libinput *libinput = evdev_libinput_context(device);
 	int fd;
 	const char *devnode;
-	struct input_event ev;
-	enum libevdev_read_status status;
+	uint64_t start, elapsed;
+	bool resync;
 
 	if (device->fd != -1)
 		return 0;
@@ -2611,11 +3269,16 @@ evdev_device_resume(struct evdev_device *device)
 	if (!devnode)
 		return -ENODEV;
 
-	fd = open_restricted(libinput, devnode,
-			     O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	start = evdev_now_nsec();
+
+	fd = open_restricted(libinput, devnode, EVDEV_OPEN_FLAGS);
 
-	if (fd < 0)
-		return -errno;
+	if (fd < 0) {
+		evdev_log_debug(device,
+				"failed to reopen device on resume (%s)\n",
+				strerror(-fd));
+		return fd;
+	}
 
 	if (!evdev_device_have_same_syspath(device->udev_device, fd)) {
 		close_restricted(libinput, fd);
@@ -2628,31 +3291,35 @@ evdev_device_resume(struct evdev_device *device)
 
 	if (evdev_need_mtdev(device)) {
 		device->mtdev = mtdev_new_open(device->fd);
-		if (!device->mtdev)
+		if (!device->mtdev) {
+			evdev_device_resume_failed(device);
 			return -ENODEV;
+		}
 	}
 
 	libevdev_change_fd(device->evdev, fd);
 	libevdev_set_clock_id(device->evdev, CLOCK_MONOTONIC);
 
-	/* re-sync libevdev's view of the device, but discard the actual
-	   events. Our device is in a neutral state already */
-	libevdev_next_event(device->evdev,
-			    LIBEVDEV_READ_FLAG_FORCE_SYNC,
-			    &ev);
-	do {
-		status = libevdev_next_event(device->evdev,
-					     LIBEVDEV_READ_FLAG_SYNC,
-					     &ev);
-	} while (status == LIBEVDEV_READ_STATUS_SYNC);
+	resync = evdev_device_needs_resync(device);
+	if (resync)
+		evdev_device_resync(device);
+	device->resync_on_resume = false;
 
 	device->source =
 		libinput_add_fd(libinput, fd, evdev_device_dispatch, device);
 	if (!device->source) {
-		mtdev_close_delete(device->mtdev);
+		evdev_device_resume_failed(device);
 		return -ENOMEM;
 	}
 
+	elapsed = evdev_now_nsec() - start;
+	device->base.stats.resumes++;
+	device->base.stats.resume_nsec += elapsed;
+	evdev_log_debug(device,
+			"resumed in %" PRIu64 "us%s\n",
+			ns2us(elapsed),
+			resync ? "" : " (no resync needed)");
+
 	evdev_notify_resumed_device(device);
 
 	return 0;
@@ -2661,18 +3328,10 @@ evdev_device_resume(struct evdev_device *device)
 void
 evdev_device_remove(struct evdev_device *device)
 {
-	struct libinput_device *dev;
-
 	evdev_log_info(device, "device removed\n");
 
-	list_for_each(dev, &device->base.seat->devices_list, link) {
-		struct evdev_device *d = evdev_device(dev);
-		if (dev == &device->base)
-			continue;
-
-		if (d->dispatch->interface->device_removed)
-			d->dispatch->interface->device_removed(d, device);
-	}
+	evdev_pairing_notify_listeners(device, PAIR_REMOVED);
+	evdev_pairing_unregister(device);
 
 	evdev_device_suspend(device);
 
@@ -2708,25 +3367,150 @@ evdev_device_destroy(struct evdev_device *device)
 	libinput_seat_unref(device->base.seat);
 	libevdev_free(device->evdev);
 	udev_device_unref(device->udev_device);
+	free(device->frame.events);
 	free(device);
 }
 
+#if HAVE_LIBWACOM
+/**
+ * Loading the libwacom database parses all of its data files, so we only
+ * do that once per context, the first time a device needs it. The
+ * database then stays around until libinput_unref().
+ */
+#define LIBWACOM_STYLUS_CACHE_SIZE 32 /* must be a power of 2 */
+
+/**
+ * A stylus lookup by tool id, including the ones libwacom doesn't know
+ * about. The stylus is owned by the database.
+ */
+struct libwacom_stylus_entry {
+	bool valid;
+	int tool_id;
+	const WacomStylus *stylus; /* NULL if unknown */
+};
+
+struct libinput_libwacom {
+	WacomDeviceDatabase *db;
+	size_t refcount;
+
+	/* Direct-mapped, a collision replaces the older lookup. A tool id
+	 * that isn't cached is looked up in the database again, so a
+	 * stream of bogus tool ids cannot grow this. */
+	struct libwacom_stylus_entry styli[LIBWACOM_STYLUS_CACHE_SIZE];
+};
+
+/**
+ * Return the context's libwacom database, loading it if need be. Each
+ * successful call must be paired with libinput_libwacom_unref().
+ *
+ * @return the database or NULL on error
+ */
+WacomDeviceDatabase *
+libinput_libwacom_ref(struct libinput *libinput)
+{
+	struct libinput_libwacom *libwacom = libinput->libwacom;
+
+	if (!libwacom) {
+		WacomDeviceDatabase *db;
+
+		db = libwacom_database_new();
+		if (!db) {
+			log_info(libinput,
+				 "Failed to initialize libwacom context.\n");
+			return NULL;
+		}
+
+		libwacom = zalloc(sizeof *libwacom);
+		libwacom->db = db;
+		libinput->libwacom = libwacom;
+		libinput->libwacom_stats.databases_loaded++;
+	}
+
+	libwacom->refcount++;
+
+	return libwacom->db;
+}
+
+void
+libinput_libwacom_unref(struct libinput *libinput)
+{
+	struct libinput_libwacom *libwacom = libinput->libwacom;
+
+	assert(libwacom);
+	assert(libwacom->refcount > 0);
+
+	/* We keep the database until libinput_unref(), a tablet
+	 * reconnecting shouldn't have to reload it */
+	libwacom->refcount--;
+}
+
+/**
+ * Look up the stylus for the given tool id. The caller must hold a
+ * reference to the database.
+ *
+ * @return the stylus or NULL if libwacom doesn't know about it
+ */
+const WacomStylus *
+libinput_libwacom_get_stylus(struct libinput *libinput, int tool_id)
+{
+	struct libinput_libwacom *libwacom = libinput->libwacom;
+	struct libwacom_stylus_entry *entry;
+	uint32_t hash;
+
+	assert(libwacom && libwacom->refcount > 0);
+
+	/* Tool ids of the same family differ in a few bits only, so mix
+	 * them up a bit */
+	hash = (uint32_t)tool_id * 2654435761U;
+	entry = &libwacom->styli[hash >> 16 &
+				 (LIBWACOM_STYLUS_CACHE_SIZE - 1)];
+
+	if (entry->valid && entry->tool_id == tool_id) {
+		libinput->libwacom_stats.stylus_hits++;
+		return entry->stylus;
+	}
+
+	libinput->libwacom_stats.stylus_misses++;
+	entry->valid = true;
+	entry->tool_id = tool_id;
+	entry->stylus = libwacom_stylus_get_for_id(libwacom->db, tool_id);
+
+	return entry->stylus;
+}
+#endif
+
+void
+libinput_libwacom_destroy(struct libinput *libinput)
+{
+#if HAVE_LIBWACOM
+	struct libinput_libwacom *libwacom = libinput->libwacom;
+
+	if (!libwacom)
+		return;
+
+	/* All devices are gone by now */
+	assert(libwacom->refcount == 0);
+
+	libwacom_database_destroy(libwacom->db);
+	free(libwacom);
+	libinput->libwacom = NULL;
+#endif
+}
+
 bool
 evdev_tablet_has_left_handed(struct evdev_device *device)
 {
 	bool has_left_handed = false;
 #if HAVE_LIBWACOM
+	struct libinput *libinput = evdev_libinput_context(device);
 	WacomDeviceDatabase *db;
 	WacomDevice *d = NULL;
 	WacomError *error;
 	const char *devnode;
 
-	db = libwacom_database_new();
-	if (!db) {
-		evdev_log_info(device,
-			       "failed to initialize libwacom context.\n");
+	db = libinput_libwacom_ref(libinput);
+	if (!db)
 		goto out;
-	}
 
 	error = libwacom_error_new();
 	devnode = udev_device_get_devnode(device->udev_device);
@@ -2753,7 +3537,7 @@ evdev_tablet_has_left_handed(struct evdev_device *device)
 		libwacom_error_free(&error);
 	if (d)
 		libwacom_destroy(d);
-	libwacom_database_destroy(db);
+	libinput_libwacom_unref(libinput);
 
 out:
 #endif
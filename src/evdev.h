@@ -37,9 +37,18 @@
 #include "timer.h"
 #include "filter.h"
 
+#if HAVE_LIBWACOM
+#include <libwacom/libwacom.h>
+#endif
+
 /* The fake resolution value for abs devices without resolution */
 #define EVDEV_FAKE_RESOLUTION 1
 
+/* Size limits of the per-device frame buffer. No real device sends
+ * anywhere near the maximum between two SYN_REPORTs */
+#define EVDEV_FRAME_MIN_EVENTS 64
+#define EVDEV_FRAME_MAX_EVENTS 4096
+
 enum evdev_event_type {
 	EVDEV_NONE,
 	EVDEV_ABSOLUTE_TOUCH_DOWN = (1 << 0),
@@ -75,6 +84,34 @@ enum evdev_device_tags {
 	EVDEV_TAG_TABLET_TOUCHPAD = (1 << 9),
 };
 
+/* Classes of devices that other devices pair with. Each device is in
+ * zero or more classes, based on its tags and capabilities, and each
+ * dispatch declares the classes of peers it wants to hear about, see
+ * evdev_dispatch_interface::pair_interests */
+enum evdev_pair_class {
+	EVDEV_PAIR_KEYBOARD,
+	EVDEV_PAIR_TRACKPOINT,
+	EVDEV_PAIR_LID_SWITCH,
+	EVDEV_PAIR_TABLET_MODE_SWITCH,
+	EVDEV_PAIR_EXTERNAL_MOUSE,
+	EVDEV_PAIR_TOUCH, /* touch screens and external touchpads */
+
+	EVDEV_PAIR_NCLASSES,
+};
+
+struct evdev_pair_link {
+	struct list link;
+	struct evdev_device *device;
+};
+
+/* The per-seat pairing registry. members[c] is the list of devices in
+ * class c, listeners[c] the list of devices interested in class c, both
+ * in the order the devices were added */
+struct evdev_pairing {
+	struct list members[EVDEV_PAIR_NCLASSES];
+	struct list listeners[EVDEV_PAIR_NCLASSES];
+};
+
 enum evdev_middlebutton_state {
 	MIDDLEBUTTON_IDLE,
 	MIDDLEBUTTON_LEFT_DOWN,
@@ -188,13 +225,34 @@ struct evdev_device {
 	enum evdev_device_tags tags;
 	bool is_mt;
 	bool is_suspended;
+	/* libevdev had events queued when the fd was closed */
+	bool resync_on_resume;
+
+	struct {
+		uint32_t classes; /* mask of enum evdev_pair_class */
+		uint32_t interests; /* mask of enum evdev_pair_class */
+		struct evdev_pair_link members[EVDEV_PAIR_NCLASSES];
+		struct evdev_pair_link listeners[EVDEV_PAIR_NCLASSES];
+	} pairing;
+
 	int dpi; /* HW resolution */
 	int trackpoint_range; /* trackpoint max delta */
 	struct ratelimit syn_drop_limit; /* ratelimit for SYN_DROPPED logging */
+	struct ratelimit frame_overflow_limit; /* ratelimit for oversized frame logging */
 	struct ratelimit nonpointer_rel_limit; /* ratelimit for REL_* events from non-pointer devices */
 	uint32_t model_flags;
 	struct mtdev *mtdev;
 
+	/* Events of the current SYN_REPORT frame, buffered until the
+	 * SYN_REPORT arrives and then processed as one batch. The buffer
+	 * starts at EVDEV_FRAME_MIN_EVENTS and grows up to
+	 * EVDEV_FRAME_MAX_EVENTS */
+	struct {
+		struct input_event *events;
+		size_t count;
+		size_t size;
+	} frame;
+
 	struct {
 		const struct input_absinfo *absinfo_x, *absinfo_y;
 		bool is_fake_resolution;
@@ -237,10 +295,15 @@ struct evdev_device {
 		 * used at runtime to enable/disable the feature */
 		bool natural_scrolling_enabled;
 
-		/* angle per REL_WHEEL click in degrees */
+		/* angle per REL_WHEEL click in degrees, use
+		 * evdev_wheel_click_angle() */
 		struct wheel_angle wheel_click_angle;
 
+		/* use evdev_wheel_is_tilt() */
 		struct wheel_tilt_flags is_tilt;
+
+		/* the wheel properties are read on the first wheel event */
+		bool have_wheel_props;
 	} scroll;
 
 	struct {
@@ -293,6 +356,15 @@ struct evdev_dispatch_interface {
 			struct input_event *event,
 			uint64_t time);
 
+	/* Process a complete SYN_REPORT frame, the last event is the
+	 * SYN_REPORT and time is its timestamp. Optional, if NULL each
+	 * event is passed to process() instead */
+	void (*process_frame)(struct evdev_dispatch *dispatch,
+			      struct evdev_device *device,
+			      struct input_event *events,
+			      size_t count,
+			      uint64_t time);
+
 	/* Device is being suspended */
 	void (*suspend)(struct evdev_dispatch *dispatch,
 			struct evdev_device *device);
@@ -303,6 +375,13 @@ struct evdev_dispatch_interface {
 	/* Destroy an event dispatch handler and free all its resources. */
 	void (*destroy)(struct evdev_dispatch *dispatch);
 
+	/* Return the mask of enum evdev_pair_class of peer devices this
+	 * device pairs with. device_added, device_removed,
+	 * device_suspended and device_resumed are only called for peers
+	 * in those classes. Optional, if NULL the device is never
+	 * notified about other devices */
+	uint32_t (*pair_interests)(struct evdev_device *device);
+
 	/* A new device was added */
 	void (*device_added)(struct evdev_device *device,
 			     struct evdev_device *added_device);
@@ -362,10 +441,78 @@ evdev_verify_dispatch_type(struct evdev_dispatch *dispatch,
 		abort();
 }
 
+struct evdev_device_probe;
+
+typedef void (*evdev_device_probe_done_func)(struct evdev_device_probe *probe,
+					     void *data);
+
+/**
+ * One device to create with evdev_device_create_all() or
+ * evdev_device_create_async().
+ */
+struct evdev_device_probe {
+	/* filled in by the caller */
+	struct libinput_seat *seat;
+	struct udev_device *udev_device;
+
+	/* the result, see evdev_device_create() */
+	struct evdev_device *device;
+	bool cancelled;
+
+	/* private */
+	int fd;
+	struct libevdev *evdev;
+	int rc;
+	evdev_device_probe_done_func done;
+	void *done_data;
+};
+
+bool
+evdev_seat_has_peer(struct libinput_seat *seat,
+		    enum evdev_pair_class class,
+		    struct evdev_device *except);
+
+void
+evdev_device_create_all(struct evdev_device_probe *probes, size_t nprobes);
+
+void
+evdev_device_create_async(struct evdev_device_probe *probe,
+			  evdev_device_probe_done_func done,
+			  void *data);
+
+void
+evdev_device_create_async_cancel(struct evdev_device_probe *probe);
+
+void
+evdev_read_wheel_props(struct evdev_device *device);
+
+static inline struct wheel_angle
+evdev_wheel_click_angle(struct evdev_device *device)
+{
+	if (!device->scroll.have_wheel_props)
+		evdev_read_wheel_props(device);
+
+	return device->scroll.wheel_click_angle;
+}
+
+static inline struct wheel_tilt_flags
+evdev_wheel_is_tilt(struct evdev_device *device)
+{
+	if (!device->scroll.have_wheel_props)
+		evdev_read_wheel_props(device);
+
+	return device->scroll.is_tilt;
+}
+
 struct evdev_device *
 evdev_device_create(struct libinput_seat *seat,
 		    struct udev_device *device);
 
+void
+evdev_device_inject_events(struct evdev_device *device,
+			   const struct input_event *events,
+			   size_t nevents);
+
 void
 evdev_transform_absolute(struct evdev_device *device,
 			 struct device_coords *point);
@@ -605,6 +752,20 @@ evdev_init_left_handed(struct evdev_device *device,
 bool
 evdev_tablet_has_left_handed(struct evdev_device *device);
 
+#if HAVE_LIBWACOM
+WacomDeviceDatabase *
+libinput_libwacom_ref(struct libinput *libinput);
+
+void
+libinput_libwacom_unref(struct libinput *libinput);
+
+const WacomStylus *
+libinput_libwacom_get_stylus(struct libinput *libinput, int tool_id);
+#endif
+
+void
+libinput_libwacom_destroy(struct libinput *libinput);
+
 static inline uint32_t
 evdev_to_left_handed(struct evdev_device *device,
 		     uint32_t button)
@@ -198,6 +198,26 @@ accelerator_destroy(struct motion_filter *filter)
 	free(accel);
 }
 
+static void
+accelerator_update_table(struct pointer_accelerator_low_dpi *accel)
+{
+	/* see pointer_accel_profile_linear_low_dpi() for the scaling */
+	double dpi_factor = accel->dpi/(double)DEFAULT_MOUSE_DPI;
+	double max_accel = accel->accel/dpi_factor;
+	/* units/us, from here on the profile is capped */
+	double max_velocity = accel->threshold * dpi_factor;
+
+	if (max_accel > 1.0)
+		max_velocity += v_ms2us((max_accel - 1)/accel->incline);
+
+	/* Below ~350dpi the threshold can be lower than 0.07 units/ms,
+	 * then the profile jumps there */
+	accel_profile_table_build(&accel->base,
+				  accel->profile,
+				  max_velocity,
+				  v_ms2us(0.07));
+}
+
 static bool
 accelerator_set_speed(struct motion_filter *filter,
 		      double speed_adjustment)
@@ -223,6 +243,8 @@ accelerator_set_speed(struct motion_filter *filter,
 	accel_filter->incline = DEFAULT_INCLINE + speed_adjustment * 0.75;
 
 	filter->speed_adjustment = speed_adjustment;
+	accelerator_update_table(accel_filter);
+
 	return true;
 }
 
@@ -264,6 +286,7 @@ create_pointer_accelerator_filter_linear_low_dpi(int dpi)
 
 	filter->base.interface = &accelerator_interface_low_dpi;
 	filter->profile = pointer_accel_profile_linear_low_dpi;
+	accelerator_update_table(filter);
 
 	return &filter->base;
 }
@@ -196,6 +196,24 @@ accelerator_destroy(struct motion_filter *filter)
 	free(accel);
 }
 
+static void
+accelerator_update_table(struct pointer_accelerator *accel)
+{
+	/* units/us at 1000dpi, from here on the profile is capped */
+	double max_velocity = accel->threshold;
+	double knot = v_ms2us(0.07);
+	double dpi_factor = accel->dpi/(double)DEFAULT_MOUSE_DPI;
+
+	if (accel->accel > 1.0)
+		max_velocity += v_ms2us((accel->accel - 1)/accel->incline);
+
+	/* the profile normalizes its input to 1000dpi */
+	accel_profile_table_build(&accel->base,
+				  accel->profile,
+				  max_velocity * dpi_factor,
+				  knot * dpi_factor);
+}
+
 static bool
 accelerator_set_speed(struct motion_filter *filter,
 		      double speed_adjustment)
@@ -221,6 +239,8 @@ accelerator_set_speed(struct motion_filter *filter,
 	accel_filter->incline = DEFAULT_INCLINE + speed_adjustment * 0.75;
 
 	filter->speed_adjustment = speed_adjustment;
+	accelerator_update_table(accel_filter);
+
 	return true;
 }
 
@@ -338,6 +358,7 @@ create_pointer_accelerator_filter_linear(int dpi)
 
 	filter->base.interface = &accelerator_interface;
 	filter->profile = pointer_accel_profile_linear;
+	accelerator_update_table(filter);
 
 	return &filter->base;
 }
@@ -46,13 +46,32 @@ struct motion_filter_interface {
 			  double speed_adjustment);
 };
 
+/* A velocity→factor lookup table sampled from an acceleration profile.
+ * Covers [0, max_velocity], the profile must be constant above that. */
+struct accel_profile_table {
+	double *factors;	/* unitless, nsamples entries */
+	size_t nsamples;
+	double max_velocity;	/* units/us */
+	double step_inv;	/* samples per units/us */
+	/* The profile may jump at the knot, the factor just below it ends
+	 * the interval before the knot sample. 0 if there is no knot. */
+	size_t knot;
+	double below_knot;	/* unitless */
+};
+
 struct motion_filter {
 	double speed_adjustment; /* normalized [-1, 1] */
 	struct motion_filter_interface *interface;
+
+	/* empty for filters that don't use a lookup table */
+	struct accel_profile_table table;
 };
 
 struct pointer_tracker {
-	struct device_float_coords delta; /* delta to most recent event */
+	/* sum of all deltas up to this event since the start of the cycle
+	 * through the trackers it was written in, the delta to the most
+	 * recent event is the difference to the most recent tracker's sum */
+	struct device_float_coords sum;
 	uint64_t time;  /* us */
 	uint32_t dir;
 };
@@ -67,6 +86,9 @@ struct pointer_trackers {
 	struct pointer_tracker *trackers;
 	size_t ntrackers;
 	unsigned int cur_tracker;
+	/* sum at the end of the previous cycle, to be subtracted from the
+	 * sums of the trackers written in that cycle */
+	struct device_float_coords base;
 
 	struct pointer_delta_smoothener *smoothener;
 };
@@ -88,6 +110,46 @@ trackers_by_offset(struct pointer_trackers *trackers, unsigned int offset);
 double
 trackers_velocity(struct pointer_trackers *trackers, uint64_t time);
 
+void
+accel_profile_table_build(struct motion_filter *filter,
+			  accel_profile_func_t profile,
+			  double max_velocity,
+			  double knot);
+
+void
+accel_profile_table_free(struct motion_filter *filter);
+
+/**
+ * Look up the acceleration factor for the given velocity, linearly
+ * interpolated between the two neighbouring samples of the table.
+ *
+ * @param table A table filled by accel_profile_table_build()
+ * @param velocity Velocity in device-units per µs
+ *
+ * @return A unitless acceleration factor
+ */
+static inline double
+accel_profile_table_lookup(const struct accel_profile_table *table,
+			   double velocity)
+{
+	double pos;
+	size_t idx;
+
+	pos = max(velocity, 0.0) * table->step_inv;
+	if (pos >= table->nsamples - 1)
+		return table->factors[table->nsamples - 1];
+
+	idx = (size_t)pos;
+	pos -= idx;
+
+	if (idx + 1 == table->knot)
+		return table->factors[idx] +
+			pos * (table->below_knot - table->factors[idx]);
+
+	return table->factors[idx] +
+		pos * (table->factors[idx + 1] - table->factors[idx]);
+}
+
 double
 calculate_acceleration_simpsons(struct motion_filter *filter,
 				accel_profile_func_t profile,
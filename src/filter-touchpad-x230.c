@@ -35,6 +35,7 @@
 #include "filter.h"
 #include "libinput-util.h"
 #include "filter-private.h"
+#include "tracepoints.h"
 
 /* Trackpoint acceleration for the Lenovo x230. DO NOT TOUCH.
  * This code is only invoked on the X230 and is quite flimsy,
@@ -126,6 +127,10 @@ calculate_acceleration(struct pointer_accelerator_x230 *accel,
 
 	factor = factor / 6.0;
 
+	trace_point2(filter_accel,
+		     (uint64_t)(velocity * 1000000),
+		     (uint64_t)(factor * 1000));
+
 	return factor; /* unitless factor */
 }
 
@@ -224,20 +229,8 @@ accelerator_restart_x230(struct motion_filter *filter,
 {
 	struct pointer_accelerator_x230 *accel =
 		(struct pointer_accelerator_x230 *) filter;
-	unsigned int offset;
-	struct pointer_tracker *tracker;
-
-	for (offset = 1; offset < accel->trackers.ntrackers; offset++) {
-		tracker = trackers_by_offset(&accel->trackers, offset);
-		tracker->time = 0;
-		tracker->dir = 0;
-		tracker->delta.x = 0;
-		tracker->delta.y = 0;
-	}
-
-	tracker = trackers_by_offset(&accel->trackers, 0);
-	tracker->time = time;
-	tracker->dir = UNDEFINED_DIRECTION;
+
+	trackers_reset(&accel->trackers, time);
 }
 
 static void
@@ -166,6 +166,24 @@ speed_factor(double s)
 							   2.377168));
 }
 
+/* mm/s → units/µs */
+static inline double
+mmps_to_upus(double mmps, int dpi)
+{
+	return mmps * (dpi/25.4) / 1e6;
+}
+
+static void
+touchpad_accelerator_update_table(struct touchpad_accelerator *accel)
+{
+	/* The profile is capped at four times the threshold (in mm/s) and
+	   its first incline reaches the baseline at 6mm/s */
+	accel_profile_table_build(&accel->base,
+				  accel->profile,
+				  mmps_to_upus(accel->threshold * 4.0, accel->dpi),
+				  mmps_to_upus(6.0, accel->dpi));
+}
+
 static bool
 touchpad_accelerator_set_speed(struct motion_filter *filter,
 		      double speed_adjustment)
@@ -177,6 +195,7 @@ touchpad_accelerator_set_speed(struct motion_filter *filter,
 
 	filter->speed_adjustment = speed_adjustment;
 	accel_filter->speed_factor = speed_factor(speed_adjustment);
+	touchpad_accelerator_update_table(accel_filter);
 
 	return true;
 }
@@ -333,6 +352,7 @@ create_pointer_accelerator_filter_touchpad(int dpi,
 
 	filter->base.interface = &accelerator_interface_touchpad;
 	filter->profile = touchpad_accel_profile_linear;
+	touchpad_accelerator_update_table(filter);
 
 	smoothener = zalloc(sizeof(*smoothener));
 	smoothener->threshold = event_delta_smooth_threshold,
@@ -35,9 +35,15 @@
 #include "filter.h"
 #include "libinput-util.h"
 #include "filter-private.h"
+#include "tracepoints.h"
 
 #define MOTION_TIMEOUT		ms2us(1000)
 
+/* Number of samples in an acceleration profile lookup table. With the
+ * current profiles this keeps the interpolation error at the kinks below
+ * 1% of the factor, see the accel_profile_table test */
+#define ACCEL_PROFILE_TABLE_SAMPLES 1024
+
 struct normalized_coords
 filter_dispatch(struct motion_filter *filter,
 		const struct device_float_coords *unaccelerated,
@@ -68,6 +74,7 @@ filter_destroy(struct motion_filter *filter)
 	if (!filter || !filter->interface->destroy)
 		return;
 
+	accel_profile_table_free(filter);
 	filter->interface->destroy(filter);
 }
 
@@ -99,6 +106,8 @@ trackers_init(struct pointer_trackers *trackers)
 				    sizeof(*trackers->trackers));
 	trackers->ntrackers = ntrackers;
 	trackers->cur_tracker = 0;
+	trackers->base.x = 0.0;
+	trackers->base.y = 0.0;
 	trackers->smoothener = NULL;
 }
 
@@ -115,14 +124,16 @@ trackers_reset(struct pointer_trackers *trackers,
 {
 	unsigned int offset;
 	struct pointer_tracker *tracker;
+	struct device_float_coords sum = trackers_by_offset(trackers, 0)->sum;
 
 	for (offset = 1; offset < trackers->ntrackers; offset++) {
 		tracker = trackers_by_offset(trackers, offset);
 		tracker->time = 0;
 		tracker->dir = 0;
-		tracker->delta.x = 0;
-		tracker->delta.y = 0;
+		tracker->sum = sum;
 	}
+	trackers->base.x = 0.0;
+	trackers->base.y = 0.0;
 
 	tracker = trackers_by_offset(trackers, 0);
 	tracker->time = time;
@@ -134,21 +145,28 @@ trackers_feed(struct pointer_trackers *trackers,
 	      const struct device_float_coords *delta,
 	      uint64_t time)
 {
-	unsigned int i, current;
+	unsigned int current;
 	struct pointer_tracker *ts = trackers->trackers;
+	struct device_float_coords sum = ts[trackers->cur_tracker].sum;
 
 	assert(trackers->ntrackers);
 
-	for (i = 0; i < trackers->ntrackers; i++) {
-		ts[i].delta.x += delta->x;
-		ts[i].delta.y += delta->y;
+	current = (trackers->cur_tracker + 1) % trackers->ntrackers;
+
+	/* Start the sums from zero on every cycle through the trackers so
+	 * they stay in the range of the deltas and don't lose precision.
+	 * The trackers left over from the previous cycle are rebased when
+	 * they're read, see tracker_sum() */
+	if (current == 0) {
+		trackers->base = sum;
+		sum.x = 0.0;
+		sum.y = 0.0;
 	}
 
-	current = (trackers->cur_tracker + 1) % trackers->ntrackers;
 	trackers->cur_tracker = current;
 
-	ts[current].delta.x = 0.0;
-	ts[current].delta.y = 0.0;
+	ts[current].sum.x = sum.x + delta->x;
+	ts[current].sum.y = sum.y + delta->y;
 	ts[current].time = time;
 	ts[current].dir = device_float_get_direction(*delta);
 }
@@ -162,23 +180,46 @@ trackers_by_offset(struct pointer_trackers *trackers, unsigned int offset)
 	return &trackers->trackers[index];
 }
 
+/**
+ * @return The tracker's sum relative to the start of the current cycle
+ * through the trackers
+ */
+static inline struct device_float_coords
+tracker_sum(struct pointer_trackers *trackers,
+	    struct pointer_tracker *tracker)
+{
+	struct device_float_coords sum = tracker->sum;
+
+	/* written in the previous cycle */
+	if (tracker > &trackers->trackers[trackers->cur_tracker]) {
+		sum.x -= trackers->base.x;
+		sum.y -= trackers->base.y;
+	}
+
+	return sum;
+}
+
 static double
-calculate_trackers_velocity(struct pointer_tracker *tracker,
-			   uint64_t time,
-			   struct pointer_delta_smoothener *smoothener)
+calculate_trackers_velocity(struct pointer_trackers *trackers,
+			   struct pointer_tracker *tracker,
+			   uint64_t time)
 {
+	struct pointer_delta_smoothener *smoothener = trackers->smoothener;
+	const struct device_float_coords *sum =
+		&trackers_by_offset(trackers, 0)->sum;
+	struct device_float_coords start = tracker_sum(trackers, tracker);
 	uint64_t tdelta = time - tracker->time + 1;
 
 	if (smoothener && tdelta < smoothener->threshold)
 		tdelta = smoothener->value;
 
-	return hypot(tracker->delta.x, tracker->delta.y) /
+	return hypot(sum->x - start.x, sum->y - start.y) /
 	       (double)tdelta; /* units/us */
 }
 
 static double
-trackers_velocity_after_timeout(struct pointer_tracker *tracker,
-				 struct pointer_delta_smoothener *smoothener)
+trackers_velocity_after_timeout(struct pointer_trackers *trackers,
+				struct pointer_tracker *tracker)
 {
 	/* First movement after timeout needs special handling.
 	 *
@@ -191,9 +232,9 @@ trackers_velocity_after_timeout(struct pointer_tracker *tracker,
 	 * for really slow movements but provides much more useful initial
 	 * movement in normal use-cases (pause, move, pause, move)
 	 */
-	return calculate_trackers_velocity(tracker,
-					  tracker->time + MOTION_TIMEOUT,
-					  smoothener);
+	return calculate_trackers_velocity(trackers,
+					  tracker,
+					  tracker->time + MOTION_TIMEOUT);
 }
 
 /**
@@ -229,14 +270,14 @@ trackers_velocity(struct pointer_trackers *trackers, uint64_t time)
 		if (time - tracker->time > MOTION_TIMEOUT) {
 			if (offset == 1)
 				result = trackers_velocity_after_timeout(
-							  tracker,
-							  trackers->smoothener);
+							  trackers,
+							  tracker);
 			break;
 		}
 
-		velocity = calculate_trackers_velocity(tracker,
-						      time,
-						      trackers->smoothener);
+		velocity = calculate_trackers_velocity(trackers,
+						      tracker,
+						      time);
 
 		/* Stop if direction changed */
 		dir &= tracker->dir;
@@ -266,10 +307,91 @@ trackers_velocity(struct pointer_trackers *trackers, uint64_t time)
 	return result; /* units/us */
 }
 
+/**
+ * Sample the given profile into the filter's lookup table. Call this
+ * whenever a parameter of the profile changes, e.g. on speed changes.
+ *
+ * Linear interpolation is exact on the linear parts of a profile, the
+ * error is in the intervals containing a kink. The knot is the velocity
+ * of the sharpest kink, the samples are spaced so it falls onto one.
+ * The profile may also jump at the knot, the interval before the knot
+ * ends with the factor just below it.
+ *
+ * @param filter The acceleration filter
+ * @param profile The profile to sample, called without data and time
+ * @param max_velocity Velocity in device-units per µs from which on the
+ * profile returns a constant factor
+ * @param knot Velocity in device-units per µs to sample exactly, or 0
+ */
+void
+accel_profile_table_build(struct motion_filter *filter,
+			  accel_profile_func_t profile,
+			  double max_velocity,
+			  double knot)
+{
+	struct accel_profile_table *table = &filter->table;
+	double step;
+	size_t i;
+
+	assert(max_velocity > 0.0);
+
+	if (!table->factors) {
+		table->nsamples = ACCEL_PROFILE_TABLE_SAMPLES;
+		table->factors = zalloc(table->nsamples *
+					sizeof(*table->factors));
+	}
+
+	step = max_velocity/(table->nsamples - 1);
+
+	/* round the step up so we still cover max_velocity */
+	if (knot >= step && knot < max_velocity)
+		step = knot/floor(knot/step);
+
+	table->max_velocity = step * (table->nsamples - 1);
+	table->step_inv = 1.0/step;
+
+	for (i = 0; i < table->nsamples; i++)
+		table->factors[i] = profile(filter, NULL, i * step, 0);
+
+	table->knot = 0;
+	if (knot >= step && knot < max_velocity) {
+		table->knot = (size_t)round(knot/step);
+		table->factors[table->knot] = profile(filter, NULL, knot, 0);
+		table->below_knot = profile(filter,
+					    NULL,
+					    nextafter(knot, 0.0),
+					    0);
+	}
+}
+
+void
+accel_profile_table_free(struct motion_filter *filter)
+{
+	free(filter->table.factors);
+	filter->table.factors = NULL;
+	filter->table.nsamples = 0;
+}
+
+static inline double
+profile_factor(struct motion_filter *filter,
+	       accel_profile_func_t profile,
+	       void *data,
+	       double velocity,
+	       uint64_t time)
+{
+	if (filter->table.factors)
+		return accel_profile_table_lookup(&filter->table, velocity);
+
+	return profile(filter, data, velocity, time);
+}
+
 /**
  * Calculate the acceleration factor for our current velocity, averaging
  * between our current and the most recent velocity to smoothen out changes.
  *
+ * If the filter has a lookup table, the factors are taken from the table
+ * and the profile is not called.
+ *
  * @param accel The acceleration filter
  * @param data Caller-specific data
  * @param velocity Velocity in device-units per µs
@@ -290,13 +412,17 @@ calculate_acceleration_simpsons(struct motion_filter *filter,
 
 	/* Use Simpson's rule to calculate the avarage acceleration between
 	 * the previous motion and the most recent. */
-	factor = profile(filter, data, velocity, time);
-	factor += profile(filter, data, last_velocity, time);
-	factor += 4.0 * profile(filter, data,
-				(last_velocity + velocity) / 2,
-				time);
+	factor = profile_factor(filter, profile, data, velocity, time);
+	factor += profile_factor(filter, profile, data, last_velocity, time);
+	factor += 4.0 * profile_factor(filter, profile, data,
+				       (last_velocity + velocity) / 2,
+				       time);
 
 	factor = factor / 6.0;
 
+	trace_point2(filter_accel,
+		     (uint64_t)(velocity * 1000000),
+		     (uint64_t)(factor * 1000));
+
 	return factor; /* unitless factor */
 }
@@ -108,6 +108,80 @@ struct libinput_interface_backend {
 				  const char *seat_name);
 };
 
+/* Event structs are recycled through a per-context free list, one pool per
+ * struct type. All event types backed by the same struct share a pool.
+ */
+enum event_pool_type {
+	EVENT_POOL_DEVICE_NOTIFY,
+	EVENT_POOL_KEYBOARD,
+	EVENT_POOL_POINTER,
+	EVENT_POOL_TOUCH,
+	EVENT_POOL_TABLET_TOOL,
+	EVENT_POOL_TABLET_PAD,
+	EVENT_POOL_GESTURE,
+	EVENT_POOL_SWITCH,
+
+	EVENT_POOL_COUNT,
+};
+
+struct event_pool_entry {
+	struct event_pool_entry *next;
+};
+
+struct event_pool {
+	size_t size;
+	struct event_pool_entry *free_list;
+	unsigned int ncached;
+	unsigned int nlive;
+
+	uint64_t allocated; /* events allocated with malloc */
+	uint64_t recycled;  /* events taken from the free list */
+	unsigned int peak;  /* max events live at the same time */
+};
+
+/* Dense index for event types in struct libinput_device_stats, event
+ * types are grouped by hundreds with at most 10 types per group */
+#define DEVICE_STATS_EVENT_TYPES 100
+
+static inline bool
+event_type_stats_index(enum libinput_event_type type, size_t *index)
+{
+	size_t group = type / 100,
+	       offset = type % 100;
+
+	if (type == LIBINPUT_EVENT_NONE || offset >= 10 ||
+	    group * 10 + offset >= DEVICE_STATS_EVENT_TYPES)
+		return false;
+
+	*index = group * 10 + offset;
+	return true;
+}
+
+/* Runtime statistics, see libinput_device_get_counter() */
+struct libinput_device_stats {
+	uint64_t input_events;
+	uint64_t frames;
+	uint64_t syn_dropped;
+	uint64_t process_nsec;
+	uint64_t timers_fired;
+	uint64_t events_posted;
+	uint64_t resumes;
+	uint64_t resume_nsec;
+	uint64_t events_by_type[DEVICE_STATS_EVENT_TYPES];
+};
+
+/* Latency histograms, see libinput_device_get_latency_histogram().
+ * Bucket 0 counts latencies below 1us, bucket n counts latencies in
+ * [2^(n-1), 2^n) us, the last bucket is open-ended. */
+#define LATENCY_HISTOGRAM_BUCKETS 24
+#define LATENCY_STAGES LIBINPUT_LATENCY_STAGE_QUEUE
+
+struct libinput_latency_histogram {
+	uint64_t buckets[LATENCY_STAGES][LATENCY_HISTOGRAM_BUCKETS];
+};
+
+#define LIBINPUT_TOOL_TABLE_SIZE 64 /* must be a power of 2 */
+
 struct libinput {
 	int epoll_fd;
 	struct list source_destroy_list;
@@ -115,10 +189,14 @@ struct libinput {
 	struct list seat_list;
 
 	struct {
-		struct list list;
+		/* min-heap of armed timers, earliest expiry first */
+		struct libinput_timer **heap;
+		size_t heap_len;
+		size_t heap_size;
 		struct libinput_source *source;
 		int fd;
-		uint64_t next_expiry;
+		uint64_t fd_expiry; /* expiry the timerfd is programmed for */
+		uint64_t settime_count;
 	} timer;
 
 	struct libinput_event **events;
@@ -127,7 +205,52 @@ struct libinput {
 	size_t events_in;
 	size_t events_out;
 
-	struct list tool_list;
+	struct {
+		struct event_pool pools[EVENT_POOL_COUNT];
+		unsigned int limit; /* max cached events per pool */
+	} event_pool;
+
+	struct {
+		/* budgets, 0 is unlimited */
+		uint64_t source_events;
+		uint64_t call_events;
+		uint64_t call_usec;
+		bool budgeted; /* any of the above is set */
+
+		/* round-robin queue of sources with data left over */
+		struct list queue;
+		/* state of the current libinput_dispatch() call */
+		struct libinput_source *current;
+		uint64_t events;
+		uint64_t source_events_left;
+		uint64_t deadline;
+		bool exhausted;
+	} dispatch;
+
+	struct {
+		bool enabled;
+		uint64_t count; /* number of events merged into another */
+	} coalesce;
+
+	struct {
+		unsigned int limit; /* max queued events, 0 is unlimited */
+		unsigned int watermark; /* 0 is disabled */
+		libinput_event_queue_watermark_handler watermark_handler;
+		bool watermark_reached;
+		/* queued events at the head known not to be droppable */
+		size_t undroppable;
+		uint64_t peak;
+		uint64_t dropped;
+	} event_queue;
+
+	bool latency_tracing;
+
+	/* statistics of devices no longer in the device list */
+	struct libinput_device_stats removed_device_stats;
+
+	/* Tools with a serial number, hashed by type and serial. See
+	 * libinput_tool_table_find() */
+	struct list tool_table[LIBINPUT_TOOL_TABLE_SIZE];
 
 	const struct libinput_interface *interface;
 	const struct libinput_interface_backend *interface_backend;
@@ -143,6 +266,22 @@ struct libinput {
 
 	bool quirks_initialized;
 	struct quirks_context *quirks;
+
+	/* created on demand, see libinput_libwacom_ref() */
+	struct libinput_libwacom *libwacom;
+	struct {
+		unsigned int databases_loaded;
+		unsigned int stylus_hits;
+		unsigned int stylus_misses;
+	} libwacom_stats;
+
+	/* see libinput_set_open_async() */
+	struct {
+		libinput_open_async_func func;
+		struct libinput_open_queue *queue;
+		struct libinput_source *source;
+		struct list pending; /* struct libinput_open_request */
+	} open_async;
 };
 
 typedef void (*libinput_seat_destroy_func) (struct libinput_seat *seat);
@@ -161,6 +300,8 @@ struct libinput_seat {
 	uint32_t slot_map;
 
 	uint32_t button_count[KEY_CNT];
+
+	struct evdev_pairing *pairing;
 };
 
 struct libinput_device_config_tap {
@@ -314,6 +455,16 @@ struct libinput_device {
 	void *user_data;
 	int refcount;
 	struct libinput_device_config config;
+	struct libinput_device_stats stats;
+
+	struct {
+		/* allocated on the first traced event of each type */
+		struct libinput_latency_histogram *histograms[DEVICE_STATS_EVENT_TYPES];
+		/* set while the backend processes a kernel event frame */
+		bool in_frame;
+		uint64_t frame_time; /* kernel timestamp of the frame in us */
+		uint64_t read_time; /* time processing of the frame started */
+	} latency;
 };
 
 enum libinput_tablet_tool_axis {
@@ -356,6 +507,10 @@ struct libinput_tablet_tool {
 	struct threshold pressure_threshold;
 	int pressure_offset; /* in device coordinates */
 	bool has_pressure_offset;
+
+	/* false for a tool loaded from a tool cache that no tablet has
+	 * seen yet, see libinput_load_tablet_tool_cache() */
+	bool initialized;
 };
 
 struct libinput_tablet_pad_mode_group {
@@ -380,6 +535,7 @@ struct libinput_tablet_pad_mode_group {
 struct libinput_event {
 	enum libinput_event_type type;
 	struct libinput_device *device;
+	uint64_t posted_time; /* latency tracing only, otherwise 0 */
 };
 
 struct libinput_event_listener {
@@ -433,6 +589,15 @@ libinput_init(struct libinput *libinput,
 void
 libinput_init_quirks(struct libinput *libinput);
 
+struct libinput_tablet_tool *
+libinput_tool_table_find(struct libinput *libinput,
+			 enum libinput_tablet_tool_type type,
+			 uint32_t serial);
+
+void
+libinput_tool_table_insert(struct libinput *libinput,
+			   struct libinput_tablet_tool *tool);
+
 struct libinput_source *
 libinput_add_fd(struct libinput *libinput,
 		int fd,
@@ -443,6 +608,10 @@ void
 libinput_remove_source(struct libinput *libinput,
 		       struct libinput_source *source);
 
+bool
+libinput_dispatch_budget_consume(struct libinput *libinput,
+				 unsigned int nevents);
+
 int
 open_restricted(struct libinput *libinput,
 		const char *path, int flags);
@@ -450,6 +619,32 @@ open_restricted(struct libinput *libinput,
 void
 close_restricted(struct libinput *libinput, int fd);
 
+/* fd is the opened fd or a negative errno, -ECANCELED if the request
+ * was cancelled with libinput_open_cancel() or libinput_open_cancel_all() */
+typedef void (*libinput_open_done_func)(struct libinput *libinput,
+					int fd,
+					void *data);
+
+static inline bool
+libinput_open_is_async(struct libinput *libinput)
+{
+	return libinput->open_async.func != NULL;
+}
+
+void
+open_restricted_async(struct libinput *libinput,
+		      const char *path,
+		      int flags,
+		      libinput_open_done_func done,
+		      void *data);
+
+/* Cancel the pending requests with the given done data */
+void
+libinput_open_cancel(struct libinput *libinput, void *data);
+
+void
+libinput_open_cancel_all(struct libinput *libinput);
+
 bool
 ignore_litest_test_suite_device(struct udev_device *device);
 
@@ -25,12 +25,15 @@
 #include "config.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
 #include <assert.h>
 
@@ -39,6 +42,7 @@
 #include "evdev.h"
 #include "timer.h"
 #include "quirks.h"
+#include "tracepoints.h"
 
 #define require_event_type(li_, type_, retval_, ...)	\
 	if (type_ == LIBINPUT_EVENT_NONE) abort(); \
@@ -75,6 +79,11 @@ ASSERT_INT_SIZE(enum libinput_config_click_method);
 ASSERT_INT_SIZE(enum libinput_config_middle_emulation_state);
 ASSERT_INT_SIZE(enum libinput_config_scroll_method);
 ASSERT_INT_SIZE(enum libinput_config_dwt_state);
+ASSERT_INT_SIZE(enum libinput_event_pool_counter);
+ASSERT_INT_SIZE(enum libinput_counter);
+ASSERT_INT_SIZE(enum libinput_dispatch_budget);
+ASSERT_INT_SIZE(enum libinput_device_counter);
+ASSERT_INT_SIZE(enum libinput_latency_stage);
 
 static inline bool
 check_event_type(struct libinput *libinput,
@@ -152,6 +161,8 @@ struct libinput_source {
 	void *user_data;
 	int fd;
 	struct list link;
+	struct list queue_link; /* libinput->dispatch.queue */
+	bool queued;
 };
 
 struct libinput_event_device_notify {
@@ -1624,6 +1635,256 @@ libinput_tablet_tool_unref(struct libinput_tablet_tool *tool)
 	return NULL;
 }
 
+static inline struct list *
+tool_table_bucket(struct libinput *libinput,
+		  enum libinput_tablet_tool_type type,
+		  uint32_t serial)
+{
+	uint32_t hash;
+
+	/* Serial numbers are often sequential, so mix them up a bit */
+	hash = (serial ^ ((uint32_t)type << 24)) * 2654435761U;
+
+	return &libinput->tool_table[hash >> 16 &
+				     (LIBINPUT_TOOL_TABLE_SIZE - 1)];
+}
+
+/**
+ * Look up a tool with a serial number in the context.
+ *
+ * @return the tool or NULL if it hasn't been seen yet
+ */
+struct libinput_tablet_tool *
+libinput_tool_table_find(struct libinput *libinput,
+			 enum libinput_tablet_tool_type type,
+			 uint32_t serial)
+{
+	struct libinput_tablet_tool *tool;
+
+	list_for_each(tool, tool_table_bucket(libinput, type, serial), link) {
+		if (tool->type == type && tool->serial == serial)
+			return tool;
+	}
+
+	return NULL;
+}
+
+void
+libinput_tool_table_insert(struct libinput *libinput,
+			   struct libinput_tablet_tool *tool)
+{
+	assert(tool->serial != 0);
+
+	list_insert(tool_table_bucket(libinput, tool->type, tool->serial),
+		    &tool->link);
+}
+
+#define TOOL_CACHE_HEADER "libinput-tablet-tool-cache 1\n"
+
+static void
+tool_cache_write_tool(FILE *fp, const struct libinput_tablet_tool *tool)
+{
+	uint32_t axes = 0;
+	const char *sep = "";
+
+	for (int axis = 0; axis <= LIBINPUT_TABLET_TOOL_AXIS_MAX; axis++) {
+		if (bit_is_set(tool->axis_caps, axis))
+			axes |= 1 << axis;
+	}
+
+	fprintf(fp, "%d %#x %#x %#x ",
+		tool->type,
+		tool->serial,
+		tool->tool_id,
+		axes);
+
+	if (tool->has_pressure_offset)
+		fprintf(fp, "%d ", tool->pressure_offset);
+	else
+		fprintf(fp, "- ");
+
+	for (int code = 0; code <= KEY_MAX; code++) {
+		if (!bit_is_set(tool->buttons, code))
+			continue;
+
+		fprintf(fp, "%s%#x", sep, code);
+		sep = ",";
+	}
+	fprintf(fp, "%s\n", *sep ? "" : "-");
+}
+
+LIBINPUT_EXPORT int
+libinput_save_tablet_tool_cache(struct libinput *libinput,
+				const char *path)
+{
+	struct libinput_tablet_tool *tool;
+	struct list *bucket;
+	char *tmppath;
+	FILE *fp;
+	int fd;
+	int rc = 0;
+
+	/* Write to a temporary file first, a crash must not leave a
+	 * truncated cache behind */
+	xasprintf(&tmppath, "%s.XXXXXX", path);
+	fd = mkostemp(tmppath, O_CLOEXEC);
+	if (fd < 0) {
+		rc = -errno;
+		free(tmppath);
+		return rc;
+	}
+
+	fp = fdopen(fd, "w");
+	if (!fp) {
+		rc = -errno;
+		close(fd);
+		goto out;
+	}
+
+	fputs(TOOL_CACHE_HEADER, fp);
+	ARRAY_FOR_EACH(libinput->tool_table, bucket) {
+		list_for_each(tool, bucket, link)
+			tool_cache_write_tool(fp, tool);
+	}
+
+	if (fflush(fp) != 0 || fsync(fd) != 0)
+		rc = -errno;
+	if (fclose(fp) != 0 && rc == 0)
+		rc = -errno;
+	if (rc == 0 && rename(tmppath, path) != 0)
+		rc = -errno;
+
+out:
+	if (rc != 0)
+		unlink(tmppath);
+	free(tmppath);
+
+	return rc;
+}
+
+static bool
+tool_cache_parse_buttons(struct libinput_tablet_tool *tool, char *buttons)
+{
+	char *code, *saveptr = NULL;
+	unsigned int c;
+
+	if (streq(buttons, "-"))
+		return true;
+
+	for (code = strtok_r(buttons, ",", &saveptr);
+	     code;
+	     code = strtok_r(NULL, ",", &saveptr)) {
+		if (!safe_atou_base(code, &c, 16) || c > KEY_MAX)
+			return false;
+		set_bit(tool->buttons, c);
+	}
+
+	return true;
+}
+
+static struct libinput_tablet_tool *
+tool_cache_parse_tool(const char *line)
+{
+	struct libinput_tablet_tool *tool;
+	int type;
+	unsigned int serial, tool_id, axes;
+	char offset[16], buttons[512];
+	int pressure_offset;
+
+	if (sscanf(line, "%d %x %x %x %15s %511s",
+		   &type, &serial, &tool_id, &axes, offset, buttons) != 6)
+		return NULL;
+
+	if (type < LIBINPUT_TABLET_TOOL_TYPE_PEN ||
+	    type > LIBINPUT_TABLET_TOOL_TYPE_LENS ||
+	    serial == 0 ||
+	    axes >= 1U << (LIBINPUT_TABLET_TOOL_AXIS_MAX + 1))
+		return NULL;
+
+	tool = zalloc(sizeof *tool);
+	*tool = (struct libinput_tablet_tool) {
+		.type = type,
+		.serial = serial,
+		.tool_id = tool_id,
+		.refcount = 1,
+		.initialized = false,
+	};
+
+	for (int axis = 0; axis <= LIBINPUT_TABLET_TOOL_AXIS_MAX; axis++) {
+		if (axes & (1 << axis))
+			set_bit(tool->axis_caps, axis);
+	}
+
+	if (!streq(offset, "-")) {
+		if (!safe_atoi(offset, &pressure_offset) || pressure_offset < 0)
+			goto error;
+
+		tool->pressure_offset = pressure_offset;
+		tool->has_pressure_offset = true;
+	}
+
+	if (!tool_cache_parse_buttons(tool, buttons))
+		goto error;
+
+	return tool;
+
+error:
+	free(tool);
+	return NULL;
+}
+
+LIBINPUT_EXPORT int
+libinput_load_tablet_tool_cache(struct libinput *libinput,
+				const char *path)
+{
+	struct libinput_tablet_tool *tool;
+	char line[1024];
+	FILE *fp;
+	int lineno = 1;
+	int ntools = 0;
+
+	fp = fopen(path, "re");
+	if (!fp)
+		return -errno;
+
+	if (!fgets(line, sizeof(line), fp) ||
+	    !streq(line, TOOL_CACHE_HEADER)) {
+		log_info(libinput,
+			 "%s: not a tablet tool cache, ignoring\n",
+			 path);
+		fclose(fp);
+		return -EINVAL;
+	}
+
+	while (fgets(line, sizeof(line), fp)) {
+		lineno++;
+
+		tool = tool_cache_parse_tool(line);
+		if (!tool) {
+			log_info(libinput,
+				 "%s:%d: invalid tablet tool, ignoring\n",
+				 path,
+				 lineno);
+			continue;
+		}
+
+		/* Tools we've seen already know better */
+		if (libinput_tool_table_find(libinput,
+					     tool->type,
+					     tool->serial)) {
+			free(tool);
+			continue;
+		}
+
+		libinput_tool_table_insert(libinput, tool);
+		ntools++;
+	}
+
+	fclose(fp);
+
+	return ntools;
+}
+
 LIBINPUT_EXPORT struct libinput_event *
 libinput_event_switch_get_base_event(struct libinput_event_switch *event)
 {
@@ -1712,6 +1973,157 @@ libinput_remove_source(struct libinput *libinput,
 	epoll_ctl(libinput->epoll_fd, EPOLL_CTL_DEL, source->fd, NULL);
 	source->fd = -1;
 	list_insert(&libinput->source_destroy_list, &source->link);
+
+	if (source->queued) {
+		list_remove(&source->queue_link);
+		source->queued = false;
+	}
+	if (libinput->dispatch.current == source)
+		libinput->dispatch.current = NULL;
+}
+
+/* Number of event structs each pool keeps around for re-use by default */
+#define EVENT_POOL_DEFAULT_LIMIT 64
+
+static inline enum event_pool_type
+event_type_to_pool(enum libinput_event_type type)
+{
+	switch (type) {
+	case LIBINPUT_EVENT_NONE:
+		break;
+	case LIBINPUT_EVENT_DEVICE_ADDED:
+	case LIBINPUT_EVENT_DEVICE_REMOVED:
+		return EVENT_POOL_DEVICE_NOTIFY;
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+		return EVENT_POOL_KEYBOARD;
+	case LIBINPUT_EVENT_POINTER_MOTION:
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+	case LIBINPUT_EVENT_POINTER_AXIS:
+		return EVENT_POOL_POINTER;
+	case LIBINPUT_EVENT_TOUCH_DOWN:
+	case LIBINPUT_EVENT_TOUCH_UP:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+	case LIBINPUT_EVENT_TOUCH_CANCEL:
+	case LIBINPUT_EVENT_TOUCH_FRAME:
+		return EVENT_POOL_TOUCH;
+	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
+	case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
+	case LIBINPUT_EVENT_TABLET_TOOL_TIP:
+	case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:
+		return EVENT_POOL_TABLET_TOOL;
+	case LIBINPUT_EVENT_TABLET_PAD_BUTTON:
+	case LIBINPUT_EVENT_TABLET_PAD_RING:
+	case LIBINPUT_EVENT_TABLET_PAD_STRIP:
+		return EVENT_POOL_TABLET_PAD;
+	case LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_END:
+	case LIBINPUT_EVENT_GESTURE_PINCH_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_PINCH_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_PINCH_END:
+	case LIBINPUT_EVENT_GESTURE_TAP_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_TAP_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_TAP_END:
+		return EVENT_POOL_GESTURE;
+	case LIBINPUT_EVENT_SWITCH_TOGGLE:
+		return EVENT_POOL_SWITCH;
+	}
+
+	return EVENT_POOL_COUNT;
+}
+
+static void
+event_pool_init(struct libinput *libinput)
+{
+	static const size_t sizes[EVENT_POOL_COUNT] = {
+		[EVENT_POOL_DEVICE_NOTIFY] =
+			sizeof(struct libinput_event_device_notify),
+		[EVENT_POOL_KEYBOARD] = sizeof(struct libinput_event_keyboard),
+		[EVENT_POOL_POINTER] = sizeof(struct libinput_event_pointer),
+		[EVENT_POOL_TOUCH] = sizeof(struct libinput_event_touch),
+		[EVENT_POOL_TABLET_TOOL] =
+			sizeof(struct libinput_event_tablet_tool),
+		[EVENT_POOL_TABLET_PAD] =
+			sizeof(struct libinput_event_tablet_pad),
+		[EVENT_POOL_GESTURE] = sizeof(struct libinput_event_gesture),
+		[EVENT_POOL_SWITCH] = sizeof(struct libinput_event_switch),
+	};
+
+	for (size_t i = 0; i < EVENT_POOL_COUNT; i++)
+		libinput->event_pool.pools[i].size = sizes[i];
+
+	libinput->event_pool.limit = EVENT_POOL_DEFAULT_LIMIT;
+}
+
+static void
+event_pool_trim(struct event_pool *pool, unsigned int limit)
+{
+	struct event_pool_entry *entry;
+
+	while (pool->ncached > limit) {
+		entry = pool->free_list;
+		pool->free_list = entry->next;
+		pool->ncached--;
+		free(entry);
+	}
+}
+
+static void
+event_pool_destroy(struct libinput *libinput)
+{
+	for (size_t i = 0; i < EVENT_POOL_COUNT; i++)
+		event_pool_trim(&libinput->event_pool.pools[i], 0);
+}
+
+/**
+ * Return an event struct of the pool's type. The memory is not zeroed if
+ * the event is recycled, the caller must initialize all fields.
+ */
+static void *
+event_pool_alloc(struct libinput *libinput, enum event_pool_type type)
+{
+	struct event_pool *pool = &libinput->event_pool.pools[type];
+	struct event_pool_entry *entry;
+
+	entry = pool->free_list;
+	if (entry) {
+		pool->free_list = entry->next;
+		pool->ncached--;
+		pool->recycled++;
+	} else {
+		entry = zalloc(pool->size);
+		pool->allocated++;
+	}
+
+	pool->nlive++;
+	pool->peak = max(pool->peak, pool->nlive);
+
+	return entry;
+}
+
+static void
+event_pool_release(struct libinput *libinput, struct libinput_event *event)
+{
+	enum event_pool_type type;
+	struct event_pool *pool;
+	struct event_pool_entry *entry;
+
+	type = event_type_to_pool(event->type);
+	assert(type < EVENT_POOL_COUNT);
+
+	pool = &libinput->event_pool.pools[type];
+	pool->nlive--;
+
+	if (pool->ncached >= libinput->event_pool.limit) {
+		free(event);
+		return;
+	}
+
+	entry = (struct event_pool_entry *)event;
+	entry->next = pool->free_list;
+	pool->free_list = entry;
+	pool->ncached++;
 }
 
 int
@@ -1720,6 +2132,8 @@ libinput_init(struct libinput *libinput,
 	      const struct libinput_interface_backend *interface_backend,
 	      void *user_data)
 {
+	struct list *bucket;
+
 	assert(interface->open_restricted != NULL);
 	assert(interface->close_restricted != NULL);
 
@@ -1729,6 +2143,7 @@ libinput_init(struct libinput *libinput,
 
 	libinput->events_len = 4;
 	libinput->events = zalloc(libinput->events_len * sizeof(*libinput->events));
+	event_pool_init(libinput);
 	libinput->log_handler = libinput_default_log_func;
 	libinput->log_priority = LIBINPUT_LOG_PRIORITY_ERROR;
 	libinput->interface = interface;
@@ -1736,9 +2151,12 @@ libinput_init(struct libinput *libinput,
 	libinput->user_data = user_data;
 	libinput->refcount = 1;
 	list_init(&libinput->source_destroy_list);
+	list_init(&libinput->dispatch.queue);
 	list_init(&libinput->seat_list);
 	list_init(&libinput->device_group_list);
-	list_init(&libinput->tool_list);
+	list_init(&libinput->open_async.pending);
+	ARRAY_FOR_EACH(libinput->tool_table, bucket)
+		list_init(bucket);
 
 	if (libinput_timer_subsys_init(libinput) != 0) {
 		free(libinput->events);
@@ -1749,12 +2167,45 @@ libinput_init(struct libinput *libinput,
 	return 0;
 }
 
+/* The quirks context is immutable once loaded, so all libinput contexts
+ * in this process that load the same files share one. Protected by
+ * the lock, libinput contexts may live in different threads.
+ *
+ * A new libinput context only reuses the shared one if none of the files
+ * changed since, see quirks_context_up_to_date(). Otherwise its fresh
+ * parse becomes the shared one. */
+static struct {
+	pthread_mutex_t lock;
+	struct quirks_context *quirks;
+	char *data_path;
+	char *override_file;
+	unsigned int users;
+} shared_quirks = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static inline bool
+shared_quirks_same_files(const char *data_path, const char *override_file)
+{
+	if (!shared_quirks.quirks)
+		return false;
+
+	if (!streq(shared_quirks.data_path, data_path))
+		return false;
+
+	if (!override_file || !shared_quirks.override_file)
+		return override_file == shared_quirks.override_file;
+
+	return streq(shared_quirks.override_file, override_file);
+}
+
 void
 libinput_init_quirks(struct libinput *libinput)
 {
 	const char *data_path,
 	           *override_file = NULL;
 	struct quirks_context *quirks;
+	bool same_files;
 
 	if (libinput->quirks_initialized)
 		return;
@@ -1768,12 +2219,26 @@ libinput_init_quirks(struct libinput *libinput)
 		override_file = LIBINPUT_DATA_OVERRIDE_FILE;
 	}
 
+	pthread_mutex_lock(&shared_quirks.lock);
+
+	same_files = shared_quirks_same_files(data_path, override_file);
+	if (same_files &&
+	    quirks_context_up_to_date(shared_quirks.quirks,
+				      data_path,
+				      override_file)) {
+		libinput->quirks = quirks_context_ref(shared_quirks.quirks);
+		shared_quirks.users++;
+		pthread_mutex_unlock(&shared_quirks.lock);
+		return;
+	}
+
 	quirks = quirks_init_subsystem(data_path,
 				       override_file,
 				       log_msg_va,
 				       libinput,
 				       QLOG_LIBINPUT_LOGGING);
 	if (!quirks) {
+		pthread_mutex_unlock(&shared_quirks.lock);
 		log_error(libinput,
 			  "Failed to load the device quirks from %s%s%s. "
 			  "This will negatively affect device behavior. "
@@ -1786,9 +2251,47 @@ libinput_init_quirks(struct libinput *libinput)
 		return;
 	}
 
+	/* Only one set of files is shared at a time, contexts using a
+	 * previously shared set or an outdated parse keep their own
+	 * reference to it */
+	if (same_files) {
+		free(shared_quirks.data_path);
+		free(shared_quirks.override_file);
+		shared_quirks.quirks = NULL;
+	}
+
+	if (!shared_quirks.quirks) {
+		shared_quirks.quirks = quirks;
+		shared_quirks.data_path = safe_strdup(data_path);
+		shared_quirks.override_file = safe_strdup(override_file);
+		shared_quirks.users = 1;
+	}
+
+	pthread_mutex_unlock(&shared_quirks.lock);
+
 	libinput->quirks = quirks;
 }
 
+static void
+libinput_release_quirks(struct libinput *libinput)
+{
+	pthread_mutex_lock(&shared_quirks.lock);
+
+	if (libinput->quirks &&
+	    libinput->quirks == shared_quirks.quirks &&
+	    --shared_quirks.users == 0) {
+		shared_quirks.quirks = NULL;
+		free(shared_quirks.data_path);
+		free(shared_quirks.override_file);
+		shared_quirks.data_path = NULL;
+		shared_quirks.override_file = NULL;
+	}
+
+	pthread_mutex_unlock(&shared_quirks.lock);
+
+	libinput->quirks = quirks_context_unref(libinput->quirks);
+}
+
 static void
 libinput_device_destroy(struct libinput_device *device);
 
@@ -1812,6 +2315,9 @@ libinput_ref(struct libinput *libinput)
 	return libinput;
 }
 
+static void
+libinput_open_queue_destroy(struct libinput *libinput);
+
 LIBINPUT_EXPORT struct libinput *
 libinput_unref(struct libinput *libinput)
 {
@@ -1820,6 +2326,7 @@ libinput_unref(struct libinput *libinput)
 	struct libinput_seat *seat, *next_seat;
 	struct libinput_tablet_tool *tool, *next_tool;
 	struct libinput_device_group *group, *next_group;
+	struct list *bucket;
 
 	if (libinput == NULL)
 		return NULL;
@@ -1829,6 +2336,9 @@ libinput_unref(struct libinput *libinput)
 	if (libinput->refcount > 0)
 		return libinput;
 
+	/* The removed device events from here on are never retrieved */
+	libinput->event_queue.watermark = 0;
+
 	libinput_suspend(libinput);
 
 	libinput->interface_backend->destroy(libinput);
@@ -1854,13 +2364,17 @@ libinput_unref(struct libinput *libinput)
 		libinput_device_group_destroy(group);
 	}
 
-	list_for_each_safe(tool, next_tool, &libinput->tool_list, link) {
-		libinput_tablet_tool_unref(tool);
+	ARRAY_FOR_EACH(libinput->tool_table, bucket) {
+		list_for_each_safe(tool, next_tool, bucket, link)
+			libinput_tablet_tool_unref(tool);
 	}
 
+	libinput_libwacom_destroy(libinput);
+	libinput_open_queue_destroy(libinput);
 	libinput_timer_subsys_destroy(libinput);
 	libinput_drop_destroyed_sources(libinput);
-	quirks_context_unref(libinput->quirks);
+	event_pool_destroy(libinput);
+	libinput_release_quirks(libinput);
 	close(libinput->epoll_fd);
 	free(libinput);
 
@@ -1882,6 +2396,8 @@ libinput_event_tablet_pad_destroy(struct libinput_event_tablet_pad *event)
 LIBINPUT_EXPORT void
 libinput_event_destroy(struct libinput_event *event)
 {
+	struct libinput *libinput;
+
 	if (event == NULL)
 		return;
 
@@ -1903,10 +2419,129 @@ libinput_event_destroy(struct libinput_event *event)
 		break;
 	}
 
-	if (event->device)
-		libinput_device_unref(event->device);
+	if (event->device == NULL) {
+		free(event);
+		return;
+	}
+
+	/* the device may be destroyed by the unref, get the context first */
+	libinput = event->device->seat->libinput;
+	libinput_device_unref(event->device);
+	event_pool_release(libinput, event);
+}
+
+LIBINPUT_EXPORT void
+libinput_set_event_coalescing(struct libinput *libinput, int enable)
+{
+	libinput->coalesce.enabled = !!enable;
+}
+
+LIBINPUT_EXPORT int
+libinput_get_event_coalescing(struct libinput *libinput)
+{
+	return libinput->coalesce.enabled;
+}
+
+LIBINPUT_EXPORT void
+libinput_set_event_queue_limit(struct libinput *libinput,
+			       unsigned int limit)
+{
+	libinput->event_queue.limit = limit;
+}
+
+LIBINPUT_EXPORT unsigned int
+libinput_get_event_queue_limit(struct libinput *libinput)
+{
+	return libinput->event_queue.limit;
+}
+
+LIBINPUT_EXPORT void
+libinput_set_event_queue_watermark(struct libinput *libinput,
+				   unsigned int watermark,
+				   libinput_event_queue_watermark_handler handler)
+{
+	if (watermark > 0 && !handler) {
+		log_bug_client(libinput, "Watermark handler missing\n");
+		return;
+	}
+
+	libinput->event_queue.watermark = watermark;
+	libinput->event_queue.watermark_handler = handler;
+	libinput->event_queue.watermark_reached = false;
+}
 
-	free(event);
+LIBINPUT_EXPORT uint64_t
+libinput_get_counter(struct libinput *libinput,
+		     enum libinput_counter counter)
+{
+	switch (counter) {
+	case LIBINPUT_COUNTER_TIMERFD_SETTIME:
+		return libinput->timer.settime_count;
+	case LIBINPUT_COUNTER_EVENTS_COALESCED:
+		return libinput->coalesce.count;
+	case LIBINPUT_COUNTER_EVENT_QUEUE_PEAK:
+		return libinput->event_queue.peak;
+	case LIBINPUT_COUNTER_EVENTS_DROPPED:
+		return libinput->event_queue.dropped;
+	}
+
+	log_bug_client(libinput, "Invalid counter %d\n", counter);
+
+	return 0;
+}
+
+LIBINPUT_EXPORT void
+libinput_event_destroy_array(struct libinput_event **events,
+			     size_t nevents)
+{
+	for (size_t i = 0; i < nevents; i++)
+		libinput_event_destroy(events[i]);
+}
+
+LIBINPUT_EXPORT void
+libinput_event_pool_set_limit(struct libinput *libinput,
+			      unsigned int limit)
+{
+	libinput->event_pool.limit = limit;
+
+	for (size_t i = 0; i < EVENT_POOL_COUNT; i++)
+		event_pool_trim(&libinput->event_pool.pools[i], limit);
+}
+
+LIBINPUT_EXPORT unsigned int
+libinput_event_pool_get_limit(struct libinput *libinput)
+{
+	return libinput->event_pool.limit;
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_event_pool_get_counter(struct libinput *libinput,
+				enum libinput_event_type type,
+				enum libinput_event_pool_counter counter)
+{
+	enum event_pool_type pool_type;
+	struct event_pool *pool;
+
+	pool_type = event_type_to_pool(type);
+	if (pool_type == EVENT_POOL_COUNT) {
+		log_bug_client(libinput, "Invalid event type %d\n", type);
+		return 0;
+	}
+
+	pool = &libinput->event_pool.pools[pool_type];
+
+	switch (counter) {
+	case LIBINPUT_EVENT_POOL_COUNTER_ALLOCATED:
+		return pool->allocated;
+	case LIBINPUT_EVENT_POOL_COUNTER_RECYCLED:
+		return pool->recycled;
+	case LIBINPUT_EVENT_POOL_COUNTER_PEAK:
+		return pool->peak;
+	}
+
+	log_bug_client(libinput, "Invalid event pool counter %d\n", counter);
+
+	return 0;
 }
 
 int
@@ -1924,6 +2559,245 @@ close_restricted(struct libinput *libinput, int fd)
 	return libinput->interface->close_restricted(fd, libinput->user_data);
 }
 
+/* Shared between the context and its open requests. Requests may be
+ * completed from any thread and after the context is gone, so anything
+ * but the refcount and the list of completed requests is only touched
+ * from the context's thread. */
+struct libinput_open_queue {
+	pthread_mutex_t lock;
+	int refcount; /* the context plus one per request */
+	int fd; /* eventfd, -1 once the context is gone */
+	struct list completed; /* struct libinput_open_request */
+};
+
+struct libinput_open_request {
+	struct libinput_open_queue *queue;
+	struct list link; /* in libinput->open_async.pending */
+	struct list completed_link; /* in queue->completed */
+	bool cancelled;
+	int fd;
+
+	libinput_open_done_func done;
+	void *data;
+};
+
+static void
+libinput_open_queue_unref_locked(struct libinput_open_queue *queue)
+{
+	assert(queue->refcount > 0);
+
+	if (--queue->refcount > 0) {
+		pthread_mutex_unlock(&queue->lock);
+		return;
+	}
+
+	pthread_mutex_unlock(&queue->lock);
+	pthread_mutex_destroy(&queue->lock);
+	free(queue);
+}
+
+static void
+libinput_open_queue_dispatch(void *data)
+{
+	struct libinput *libinput = data;
+	struct libinput_open_queue *queue = libinput->open_async.queue;
+	struct libinput_open_request *request, *tmp;
+	struct list completed;
+	uint64_t count;
+
+	while (read(queue->fd, &count, sizeof(count)) == -1 && errno == EINTR)
+		;
+
+	list_init(&completed);
+
+	pthread_mutex_lock(&queue->lock);
+	list_for_each_safe(request, tmp, &queue->completed, completed_link) {
+		list_remove(&request->completed_link);
+		list_append(&completed, &request->completed_link);
+	}
+	pthread_mutex_unlock(&queue->lock);
+
+	/* In the order the caller completed the requests */
+	list_for_each_safe(request, tmp, &completed, completed_link) {
+		list_remove(&request->completed_link);
+
+		if (request->cancelled) {
+			if (request->fd >= 0)
+				close_restricted(libinput, request->fd);
+		} else {
+			list_remove(&request->link);
+			request->done(libinput, request->fd, request->data);
+		}
+
+		pthread_mutex_lock(&queue->lock);
+		libinput_open_queue_unref_locked(queue);
+		free(request);
+	}
+}
+
+static void
+libinput_open_queue_destroy(struct libinput *libinput)
+{
+	struct libinput_open_queue *queue = libinput->open_async.queue;
+	struct libinput_open_request *request, *tmp;
+
+	if (!queue)
+		return;
+
+	libinput_open_cancel_all(libinput);
+
+	libinput_remove_source(libinput, libinput->open_async.source);
+	libinput->open_async.source = NULL;
+	libinput->open_async.queue = NULL;
+
+	pthread_mutex_lock(&queue->lock);
+	close(queue->fd);
+	queue->fd = -1;
+	list_for_each_safe(request, tmp, &queue->completed, completed_link) {
+		list_remove(&request->completed_link);
+		if (request->fd >= 0)
+			close_restricted(libinput, request->fd);
+		queue->refcount--;
+		free(request);
+	}
+	/* Any request still outstanding holds a ref */
+	libinput_open_queue_unref_locked(queue);
+}
+
+void
+open_restricted_async(struct libinput *libinput,
+		      const char *path,
+		      int flags,
+		      libinput_open_done_func done,
+		      void *data)
+{
+	struct libinput_open_queue *queue = libinput->open_async.queue;
+	struct libinput_open_request *request;
+
+	if (!libinput_open_is_async(libinput)) {
+		done(libinput, open_restricted(libinput, path, flags), data);
+		return;
+	}
+
+	request = zalloc(sizeof *request);
+	request->queue = queue;
+	request->fd = -1;
+	request->done = done;
+	request->data = data;
+	list_init(&request->completed_link);
+	list_append(&libinput->open_async.pending, &request->link);
+
+	pthread_mutex_lock(&queue->lock);
+	queue->refcount++;
+	pthread_mutex_unlock(&queue->lock);
+
+	libinput->open_async.func(libinput,
+				  request,
+				  path,
+				  flags,
+				  libinput->user_data);
+}
+
+static void
+libinput_open_request_cancel(struct libinput *libinput,
+			     struct libinput_open_request *request)
+{
+	/* The request stays around until the caller completes it, we
+	 * close the fd then */
+	list_remove(&request->link);
+	request->cancelled = true;
+	request->done(libinput, -ECANCELED, request->data);
+}
+
+void
+libinput_open_cancel(struct libinput *libinput, void *data)
+{
+	struct libinput_open_request *request, *tmp;
+
+	list_for_each_safe(request, tmp, &libinput->open_async.pending, link) {
+		if (request->data == data)
+			libinput_open_request_cancel(libinput, request);
+	}
+}
+
+void
+libinput_open_cancel_all(struct libinput *libinput)
+{
+	struct libinput_open_request *request, *tmp;
+
+	list_for_each_safe(request, tmp, &libinput->open_async.pending, link)
+		libinput_open_request_cancel(libinput, request);
+}
+
+LIBINPUT_EXPORT int
+libinput_set_open_async(struct libinput *libinput,
+			libinput_open_async_func open_async)
+{
+	struct libinput_open_queue *queue;
+	int fd;
+
+	if (!open_async) {
+		libinput->open_async.func = NULL;
+		return 0;
+	}
+
+	if (!libinput->open_async.queue) {
+		fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+		if (fd < 0)
+			return -errno;
+
+		queue = zalloc(sizeof *queue);
+		pthread_mutex_init(&queue->lock, NULL);
+		queue->refcount = 1;
+		queue->fd = fd;
+		list_init(&queue->completed);
+
+		libinput->open_async.source =
+			libinput_add_fd(libinput,
+					fd,
+					libinput_open_queue_dispatch,
+					libinput);
+		if (!libinput->open_async.source) {
+			close(fd);
+			pthread_mutex_destroy(&queue->lock);
+			free(queue);
+			return -ENOMEM;
+		}
+
+		libinput->open_async.queue = queue;
+	}
+
+	libinput->open_async.func = open_async;
+
+	return 0;
+}
+
+LIBINPUT_EXPORT void
+libinput_open_request_complete(struct libinput_open_request *request,
+			       int fd)
+{
+	struct libinput_open_queue *queue = request->queue;
+	uint64_t one = 1;
+
+	pthread_mutex_lock(&queue->lock);
+
+	/* The context is gone, nobody to pass the fd to */
+	if (queue->fd == -1) {
+		if (fd >= 0)
+			close(fd);
+		free(request);
+		libinput_open_queue_unref_locked(queue);
+		return;
+	}
+
+	request->fd = fd;
+	list_append(&queue->completed, &request->completed_link);
+	while (write(queue->fd, &one, sizeof(one)) == -1 && errno == EINTR)
+		;
+
+	pthread_mutex_unlock(&queue->lock);
+}
+
 bool
 ignore_litest_test_suite_device(struct udev_device *device)
 {
@@ -1961,6 +2835,8 @@ static void
 libinput_seat_destroy(struct libinput_seat *seat)
 {
 	list_remove(&seat->link);
+	/* all devices have unlinked from the registry by now */
+	free(seat->pairing);
 	free(seat->logical_name);
 	free(seat->physical_name);
 	seat->destroy(seat);
@@ -1979,76 +2855,351 @@ libinput_seat_unref(struct libinput_seat *seat)
 	}
 }
 
-LIBINPUT_EXPORT void
-libinput_seat_set_user_data(struct libinput_seat *seat, void *user_data)
+LIBINPUT_EXPORT void
+libinput_seat_set_user_data(struct libinput_seat *seat, void *user_data)
+{
+	seat->user_data = user_data;
+}
+
+LIBINPUT_EXPORT void *
+libinput_seat_get_user_data(struct libinput_seat *seat)
+{
+	return seat->user_data;
+}
+
+LIBINPUT_EXPORT struct libinput *
+libinput_seat_get_context(struct libinput_seat *seat)
+{
+	return seat->libinput;
+}
+
+LIBINPUT_EXPORT const char *
+libinput_seat_get_physical_name(struct libinput_seat *seat)
+{
+	return seat->physical_name;
+}
+
+LIBINPUT_EXPORT const char *
+libinput_seat_get_logical_name(struct libinput_seat *seat)
+{
+	return seat->logical_name;
+}
+
+void
+libinput_device_init(struct libinput_device *device,
+		     struct libinput_seat *seat)
+{
+	device->seat = seat;
+	device->refcount = 1;
+	list_init(&device->event_listeners);
+}
+
+LIBINPUT_EXPORT struct libinput_device *
+libinput_device_ref(struct libinput_device *device)
+{
+	device->refcount++;
+	return device;
+}
+
+static void
+libinput_device_destroy(struct libinput_device *device)
+{
+	struct libinput_latency_histogram **histogram;
+
+	assert(list_empty(&device->event_listeners));
+
+	ARRAY_FOR_EACH(device->latency.histograms, histogram)
+		free(*histogram);
+
+	evdev_device_destroy(evdev_device(device));
+}
+
+LIBINPUT_EXPORT struct libinput_device *
+libinput_device_unref(struct libinput_device *device)
+{
+	assert(device->refcount > 0);
+	device->refcount--;
+	if (device->refcount == 0) {
+		libinput_device_destroy(device);
+		return NULL;
+	} else {
+		return device;
+	}
+}
+
+static void
+device_stats_add(struct libinput_device_stats *total,
+		 const struct libinput_device_stats *stats)
+{
+	total->input_events += stats->input_events;
+	total->frames += stats->frames;
+	total->syn_dropped += stats->syn_dropped;
+	total->process_nsec += stats->process_nsec;
+	total->timers_fired += stats->timers_fired;
+	total->events_posted += stats->events_posted;
+	total->resumes += stats->resumes;
+	total->resume_nsec += stats->resume_nsec;
+	for (size_t i = 0; i < ARRAY_LENGTH(total->events_by_type); i++)
+		total->events_by_type[i] += stats->events_by_type[i];
+}
+
+static bool
+device_stats_get_counter(const struct libinput_device_stats *stats,
+			 enum libinput_device_counter counter,
+			 uint64_t *value)
+{
+	switch (counter) {
+	case LIBINPUT_DEVICE_COUNTER_INPUT_EVENTS:
+		*value = stats->input_events;
+		return true;
+	case LIBINPUT_DEVICE_COUNTER_FRAMES:
+		*value = stats->frames;
+		return true;
+	case LIBINPUT_DEVICE_COUNTER_SYN_DROPPED:
+		*value = stats->syn_dropped;
+		return true;
+	case LIBINPUT_DEVICE_COUNTER_EVENTS_POSTED:
+		*value = stats->events_posted;
+		return true;
+	case LIBINPUT_DEVICE_COUNTER_PROCESS_USEC:
+		*value = ns2us(stats->process_nsec);
+		return true;
+	case LIBINPUT_DEVICE_COUNTER_TIMERS_FIRED:
+		*value = stats->timers_fired;
+		return true;
+	case LIBINPUT_DEVICE_COUNTER_RESUMES:
+		*value = stats->resumes;
+		return true;
+	case LIBINPUT_DEVICE_COUNTER_RESUME_USEC:
+		*value = ns2us(stats->resume_nsec);
+		return true;
+	}
+
+	return false;
+}
+
+static void
+libinput_get_device_stats(struct libinput *libinput,
+			  struct libinput_device_stats *total)
+{
+	struct libinput_seat *seat;
+	struct libinput_device *device;
+
+	*total = libinput->removed_device_stats;
+
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link)
+			device_stats_add(total, &device->stats);
+	}
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_device_get_counter(struct libinput_device *device,
+			    enum libinput_device_counter counter)
+{
+	uint64_t value;
+
+	if (!device_stats_get_counter(&device->stats, counter, &value)) {
+		log_bug_client(device->seat->libinput,
+			       "Invalid device counter %d\n",
+			       counter);
+		return 0;
+	}
+
+	return value;
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_device_get_event_counter(struct libinput_device *device,
+				  enum libinput_event_type type)
 {
-	seat->user_data = user_data;
+	size_t idx;
+
+	if (!event_type_stats_index(type, &idx)) {
+		log_bug_client(device->seat->libinput,
+			       "Invalid event type %d\n",
+			       type);
+		return 0;
+	}
+
+	return device->stats.events_by_type[idx];
 }
 
-LIBINPUT_EXPORT void *
-libinput_seat_get_user_data(struct libinput_seat *seat)
+LIBINPUT_EXPORT uint64_t
+libinput_get_device_counter(struct libinput *libinput,
+			    enum libinput_device_counter counter)
 {
-	return seat->user_data;
+	struct libinput_device_stats total;
+	uint64_t value;
+
+	libinput_get_device_stats(libinput, &total);
+	if (!device_stats_get_counter(&total, counter, &value)) {
+		log_bug_client(libinput,
+			       "Invalid device counter %d\n",
+			       counter);
+		return 0;
+	}
+
+	return value;
 }
 
-LIBINPUT_EXPORT struct libinput *
-libinput_seat_get_context(struct libinput_seat *seat)
+LIBINPUT_EXPORT uint64_t
+libinput_get_event_counter(struct libinput *libinput,
+			   enum libinput_event_type type)
 {
-	return seat->libinput;
+	struct libinput_device_stats total;
+	size_t idx;
+
+	if (!event_type_stats_index(type, &idx)) {
+		log_bug_client(libinput, "Invalid event type %d\n", type);
+		return 0;
+	}
+
+	libinput_get_device_stats(libinput, &total);
+
+	return total.events_by_type[idx];
 }
 
-LIBINPUT_EXPORT const char *
-libinput_seat_get_physical_name(struct libinput_seat *seat)
+LIBINPUT_EXPORT void
+libinput_set_latency_tracing(struct libinput *libinput, int enable)
 {
-	return seat->physical_name;
+	libinput->latency_tracing = !!enable;
 }
 
-LIBINPUT_EXPORT const char *
-libinput_seat_get_logical_name(struct libinput_seat *seat)
+LIBINPUT_EXPORT int
+libinput_get_latency_tracing(struct libinput *libinput)
 {
-	return seat->logical_name;
+	return libinput->latency_tracing;
 }
 
-void
-libinput_device_init(struct libinput_device *device,
-		     struct libinput_seat *seat)
+LIBINPUT_EXPORT size_t
+libinput_device_get_latency_histogram(struct libinput_device *device,
+				      enum libinput_event_type type,
+				      enum libinput_latency_stage stage,
+				      uint64_t *buckets,
+				      size_t nbuckets)
 {
-	device->seat = seat;
-	device->refcount = 1;
-	list_init(&device->event_listeners);
+	struct libinput_latency_histogram *histogram;
+	size_t idx;
+
+	if (!event_type_stats_index(type, &idx)) {
+		log_bug_client(device->seat->libinput,
+			       "Invalid event type %d\n",
+			       type);
+		return 0;
+	}
+
+	if (stage < LIBINPUT_LATENCY_STAGE_KERNEL ||
+	    stage > LIBINPUT_LATENCY_STAGE_QUEUE) {
+		log_bug_client(device->seat->libinput,
+			       "Invalid latency stage %d\n",
+			       stage);
+		return 0;
+	}
+
+	histogram = device->latency.histograms[idx];
+	for (size_t i = 0; i < min(nbuckets, LATENCY_HISTOGRAM_BUCKETS); i++)
+		buckets[i] = histogram ? histogram->buckets[stage - 1][i] : 0;
+
+	return LATENCY_HISTOGRAM_BUCKETS;
 }
 
-LIBINPUT_EXPORT struct libinput_device *
-libinput_device_ref(struct libinput_device *device)
+LIBINPUT_EXPORT int
+libinput_get_fd(struct libinput *libinput)
 {
-	device->refcount++;
-	return device;
+	return libinput->epoll_fd;
 }
 
-static void
-libinput_device_destroy(struct libinput_device *device)
+static inline void
+libinput_dispatch_queue_source(struct libinput *libinput,
+			       struct libinput_source *source)
 {
-	assert(list_empty(&device->event_listeners));
-	evdev_device_destroy(evdev_device(device));
+	if (source->queued)
+		return;
+
+	list_append(&libinput->dispatch.queue, &source->queue_link);
+	source->queued = true;
 }
 
-LIBINPUT_EXPORT struct libinput_device *
-libinput_device_unref(struct libinput_device *device)
+bool
+libinput_dispatch_budget_consume(struct libinput *libinput,
+				 unsigned int nevents)
 {
-	assert(device->refcount > 0);
-	device->refcount--;
-	if (device->refcount == 0) {
-		libinput_device_destroy(device);
-		return NULL;
-	} else {
-		return device;
-	}
+	struct libinput_source *source = libinput->dispatch.current;
+
+	if (!libinput->dispatch.budgeted || !source)
+		return true;
+
+	libinput->dispatch.events += nevents;
+	if (libinput->dispatch.call_events &&
+	    libinput->dispatch.events >= libinput->dispatch.call_events)
+		libinput->dispatch.exhausted = true;
+	else if (libinput->dispatch.call_usec &&
+		 libinput_now(libinput) >= libinput->dispatch.deadline)
+		libinput->dispatch.exhausted = true;
+
+	if (nevents < libinput->dispatch.source_events_left)
+		libinput->dispatch.source_events_left -= nevents;
+	else
+		libinput->dispatch.source_events_left = 0;
+
+	if (!libinput->dispatch.exhausted &&
+	    libinput->dispatch.source_events_left > 0)
+		return true;
+
+	/* The source may have data left that was already read from the
+	 * fd, so we can't rely on epoll to tell us about it again */
+	libinput_dispatch_queue_source(libinput, source);
+
+	return false;
 }
 
-LIBINPUT_EXPORT int
-libinput_get_fd(struct libinput *libinput)
+static int
+libinput_dispatch_budgeted(struct libinput *libinput,
+			   struct epoll_event *ep,
+			   int count)
 {
-	return libinput->epoll_fd;
+	struct libinput_source *source;
+	uint64_t source_events;
+	int i;
+
+	for (i = 0; i < count; ++i) {
+		source = ep[i].data.ptr;
+		if (source->fd == -1)
+			continue;
+
+		/* timers are always handled and not subject to the budget */
+		if (source == libinput->timer.source)
+			source->dispatch(source->user_data);
+		else
+			libinput_dispatch_queue_source(libinput, source);
+	}
+
+	source_events = libinput->dispatch.source_events;
+	if (source_events == 0)
+		source_events = UINT64_MAX;
+
+	libinput->dispatch.events = 0;
+	libinput->dispatch.exhausted = false;
+	if (libinput->dispatch.call_usec)
+		libinput->dispatch.deadline = libinput_now(libinput) +
+					      libinput->dispatch.call_usec;
+
+	while (!libinput->dispatch.exhausted &&
+	       !list_empty(&libinput->dispatch.queue)) {
+		source = list_first_entry(&libinput->dispatch.queue,
+					  source,
+					  queue_link);
+		list_remove(&source->queue_link);
+		source->queued = false;
+
+		libinput->dispatch.current = source;
+		libinput->dispatch.source_events_left = source_events;
+		source->dispatch(source->user_data);
+		libinput->dispatch.current = NULL;
+	}
+
+	return list_empty(&libinput->dispatch.queue) ? 0 : -EAGAIN;
 }
 
 LIBINPUT_EXPORT int
@@ -2057,21 +3208,73 @@ libinput_dispatch(struct libinput *libinput)
 	struct libinput_source *source;
 	struct epoll_event ep[32];
 	int i, count;
+	int rc = 0;
 
 	count = epoll_wait(libinput->epoll_fd, ep, ARRAY_LENGTH(ep), 0);
 	if (count < 0)
 		return -errno;
 
-	for (i = 0; i < count; ++i) {
-		source = ep[i].data.ptr;
-		if (source->fd == -1)
-			continue;
+	if (libinput->dispatch.budgeted ||
+	    !list_empty(&libinput->dispatch.queue)) {
+		rc = libinput_dispatch_budgeted(libinput, ep, count);
+	} else {
+		for (i = 0; i < count; ++i) {
+			source = ep[i].data.ptr;
+			if (source->fd == -1)
+				continue;
 
-		source->dispatch(source->user_data);
+			source->dispatch(source->user_data);
+		}
 	}
 
 	libinput_drop_destroyed_sources(libinput);
 
+	return rc;
+}
+
+LIBINPUT_EXPORT void
+libinput_dispatch_set_budget(struct libinput *libinput,
+			     enum libinput_dispatch_budget budget,
+			     uint64_t value)
+{
+	switch (budget) {
+	case LIBINPUT_DISPATCH_BUDGET_SOURCE_EVENTS:
+		libinput->dispatch.source_events = value;
+		break;
+	case LIBINPUT_DISPATCH_BUDGET_CALL_EVENTS:
+		libinput->dispatch.call_events = value;
+		break;
+	case LIBINPUT_DISPATCH_BUDGET_CALL_USEC:
+		libinput->dispatch.call_usec = value;
+		break;
+	default:
+		log_bug_client(libinput,
+			       "Invalid dispatch budget %d\n",
+			       budget);
+		return;
+	}
+
+	libinput->dispatch.budgeted = libinput->dispatch.source_events ||
+				      libinput->dispatch.call_events ||
+				      libinput->dispatch.call_usec;
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_dispatch_get_budget(struct libinput *libinput,
+			     enum libinput_dispatch_budget budget)
+{
+	switch (budget) {
+	case LIBINPUT_DISPATCH_BUDGET_SOURCE_EVENTS:
+		return libinput->dispatch.source_events;
+	case LIBINPUT_DISPATCH_BUDGET_CALL_EVENTS:
+		return libinput->dispatch.call_events;
+	case LIBINPUT_DISPATCH_BUDGET_CALL_USEC:
+		return libinput->dispatch.call_usec;
+	}
+
+	log_bug_client(libinput,
+		       "Invalid dispatch budget %d\n",
+		       budget);
 	return 0;
 }
 
@@ -2150,6 +3353,128 @@ init_event_base(struct libinput_event *event,
 {
 	event->type = type;
 	event->device = device;
+	event->posted_time = 0;
+}
+
+static inline void
+device_stats_count_event(struct libinput_device *device,
+			 enum libinput_event_type type)
+{
+	size_t idx;
+
+	static_assert(LIBINPUT_EVENT_GESTURE_TAP_END % 100 < 10 &&
+		      LIBINPUT_EVENT_SWITCH_TOGGLE / 100 * 10 <
+		      DEVICE_STATS_EVENT_TYPES,
+		      "event types don't fit the stats index");
+
+	device->stats.events_posted++;
+	if (event_type_stats_index(type, &idx))
+		device->stats.events_by_type[idx]++;
+}
+
+static inline unsigned int
+latency_bucket(uint64_t usec)
+{
+	unsigned int bucket;
+
+	if (usec == 0)
+		return 0;
+
+	bucket = 64 - __builtin_clzll(usec);
+
+	return min(bucket, LATENCY_HISTOGRAM_BUCKETS - 1);
+}
+
+static void
+latency_record(struct libinput_device *device,
+	       enum libinput_event_type type,
+	       enum libinput_latency_stage stage,
+	       uint64_t usec)
+{
+	struct libinput_latency_histogram *histogram;
+	size_t idx;
+
+	if (!event_type_stats_index(type, &idx))
+		return;
+
+	histogram = device->latency.histograms[idx];
+	if (!histogram) {
+		histogram = zalloc(sizeof *histogram);
+		device->latency.histograms[idx] = histogram;
+	}
+
+	histogram->buckets[stage - 1][latency_bucket(usec)]++;
+}
+
+static inline uint64_t
+latency_diff(uint64_t from, uint64_t to)
+{
+	return to > from ? to - from : 0;
+}
+
+/**
+ * Record the latency of an event about to be queued. Events posted while
+ * the device processes a frame with the frame's timestamp are split into
+ * kernel and processing time, anything else was held back by libinput,
+ * e.g. on a timeout.
+ */
+static void
+latency_trace_post(struct libinput_device *device,
+		   uint64_t time,
+		   struct libinput_event *event)
+{
+	struct libinput *libinput = device->seat->libinput;
+	uint64_t now;
+
+	if (!libinput->latency_tracing)
+		return;
+
+	now = libinput_now(libinput);
+
+	if (device->latency.in_frame && time >= device->latency.frame_time) {
+		latency_record(device,
+			       event->type,
+			       LIBINPUT_LATENCY_STAGE_KERNEL,
+			       latency_diff(device->latency.frame_time,
+					    device->latency.read_time));
+		latency_record(device,
+			       event->type,
+			       LIBINPUT_LATENCY_STAGE_PROCESSING,
+			       latency_diff(device->latency.read_time, now));
+	} else {
+		latency_record(device,
+			       event->type,
+			       LIBINPUT_LATENCY_STAGE_HOLD,
+			       latency_diff(time, now));
+	}
+
+	event->posted_time = now;
+}
+
+static void
+latency_trace_retrieved(struct libinput *libinput,
+			struct libinput_event **events,
+			size_t nevents)
+{
+	uint64_t now = 0;
+
+	if (!libinput->latency_tracing)
+		return;
+
+	for (size_t i = 0; i < nevents; i++) {
+		struct libinput_event *event = events[i];
+
+		if (event->posted_time == 0)
+			continue;
+
+		if (now == 0)
+			now = libinput_now(libinput);
+
+		latency_record(event->device,
+			       event->type,
+			       LIBINPUT_LATENCY_STAGE_QUEUE,
+			       latency_diff(event->posted_time, now));
+	}
 }
 
 static void
@@ -2159,6 +3484,7 @@ post_base_event(struct libinput_device *device,
 {
 	struct libinput *libinput = device->seat->libinput;
 	init_event_base(event, device, type);
+	device_stats_count_event(device, type);
 	libinput_post_event(libinput, event);
 }
 
@@ -2182,6 +3508,8 @@ post_device_event(struct libinput_device *device,
 #endif
 
 	init_event_base(event, device, type);
+	device_stats_count_event(device, type);
+	latency_trace_post(device, time, event);
 
 	list_for_each_safe(listener, tmp, &device->event_listeners, link)
 		listener->notify_func(time, event, listener->notify_func_data);
@@ -2194,7 +3522,8 @@ notify_added_device(struct libinput_device *device)
 {
 	struct libinput_event_device_notify *added_device_event;
 
-	added_device_event = zalloc(sizeof *added_device_event);
+	added_device_event = event_pool_alloc(device->seat->libinput,
+					      EVENT_POOL_DEVICE_NOTIFY);
 
 	post_base_event(device,
 			LIBINPUT_EVENT_DEVICE_ADDED,
@@ -2212,12 +3541,18 @@ notify_removed_device(struct libinput_device *device)
 {
 	struct libinput_event_device_notify *removed_device_event;
 
-	removed_device_event = zalloc(sizeof *removed_device_event);
+	removed_device_event = event_pool_alloc(device->seat->libinput,
+						EVENT_POOL_DEVICE_NOTIFY);
 
 	post_base_event(device,
 			LIBINPUT_EVENT_DEVICE_REMOVED,
 			&removed_device_event->base);
 
+	/* The device is no longer in the seat's device list, keep its
+	 * statistics for the context-wide counters */
+	device_stats_add(&device->seat->libinput->removed_device_stats,
+			 &device->stats);
+
 #ifdef __clang_analyzer__
 	/* clang doesn't realize we're not leaking the event here, so
 	 * pretend to free it  */
@@ -2278,7 +3613,8 @@ keyboard_notify_key(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_KEYBOARD))
 		return;
 
-	key_event = zalloc(sizeof *key_event);
+	key_event = event_pool_alloc(device->seat->libinput,
+				     EVENT_POOL_KEYBOARD);
 
 	seat_key_count = update_seat_key_count(device->seat, key, state);
 
@@ -2305,7 +3641,8 @@ pointer_notify_motion(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	motion_event = zalloc(sizeof *motion_event);
+	motion_event = event_pool_alloc(device->seat->libinput,
+					EVENT_POOL_POINTER);
 
 	*motion_event = (struct libinput_event_pointer) {
 		.time = time,
@@ -2328,7 +3665,8 @@ pointer_notify_motion_absolute(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	motion_absolute_event = zalloc(sizeof *motion_absolute_event);
+	motion_absolute_event = event_pool_alloc(device->seat->libinput,
+						 EVENT_POOL_POINTER);
 
 	*motion_absolute_event = (struct libinput_event_pointer) {
 		.time = time,
@@ -2352,7 +3690,8 @@ pointer_notify_button(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	button_event = zalloc(sizeof *button_event);
+	button_event = event_pool_alloc(device->seat->libinput,
+					EVENT_POOL_POINTER);
 
 	seat_button_count = update_seat_button_count(device->seat,
 						     button,
@@ -2383,7 +3722,8 @@ pointer_notify_axis(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	axis_event = zalloc(sizeof *axis_event);
+	axis_event = event_pool_alloc(device->seat->libinput,
+				      EVENT_POOL_POINTER);
 
 	*axis_event = (struct libinput_event_pointer) {
 		.time = time,
@@ -2410,7 +3750,8 @@ touch_notify_touch_down(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
-	touch_event = zalloc(sizeof *touch_event);
+	touch_event = event_pool_alloc(device->seat->libinput,
+				       EVENT_POOL_TOUCH);
 
 	*touch_event = (struct libinput_event_touch) {
 		.time = time,
@@ -2436,7 +3777,8 @@ touch_notify_touch_motion(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
-	touch_event = zalloc(sizeof *touch_event);
+	touch_event = event_pool_alloc(device->seat->libinput,
+				       EVENT_POOL_TOUCH);
 
 	*touch_event = (struct libinput_event_touch) {
 		.time = time,
@@ -2461,7 +3803,8 @@ touch_notify_touch_up(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
-	touch_event = zalloc(sizeof *touch_event);
+	touch_event = event_pool_alloc(device->seat->libinput,
+				       EVENT_POOL_TOUCH);
 
 	*touch_event = (struct libinput_event_touch) {
 		.time = time,
@@ -2483,7 +3826,8 @@ touch_notify_frame(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
-	touch_event = zalloc(sizeof *touch_event);
+	touch_event = event_pool_alloc(device->seat->libinput,
+				       EVENT_POOL_TOUCH);
 
 	*touch_event = (struct libinput_event_touch) {
 		.time = time,
@@ -2504,7 +3848,8 @@ tablet_notify_axis(struct libinput_device *device,
 {
 	struct libinput_event_tablet_tool *axis_event;
 
-	axis_event = zalloc(sizeof *axis_event);
+	axis_event = event_pool_alloc(device->seat->libinput,
+				      EVENT_POOL_TABLET_TOOL);
 
 	*axis_event = (struct libinput_event_tablet_tool) {
 		.time = time,
@@ -2534,7 +3879,8 @@ tablet_notify_proximity(struct libinput_device *device,
 {
 	struct libinput_event_tablet_tool *proximity_event;
 
-	proximity_event = zalloc(sizeof *proximity_event);
+	proximity_event = event_pool_alloc(device->seat->libinput,
+					   EVENT_POOL_TABLET_TOOL);
 
 	*proximity_event = (struct libinput_event_tablet_tool) {
 		.time = time,
@@ -2563,7 +3909,8 @@ tablet_notify_tip(struct libinput_device *device,
 {
 	struct libinput_event_tablet_tool *tip_event;
 
-	tip_event = zalloc(sizeof *tip_event);
+	tip_event = event_pool_alloc(device->seat->libinput,
+				     EVENT_POOL_TABLET_TOOL);
 
 	*tip_event = (struct libinput_event_tablet_tool) {
 		.time = time,
@@ -2594,7 +3941,8 @@ tablet_notify_button(struct libinput_device *device,
 	struct libinput_event_tablet_tool *button_event;
 	int32_t seat_button_count;
 
-	button_event = zalloc(sizeof *button_event);
+	button_event = event_pool_alloc(device->seat->libinput,
+					EVENT_POOL_TABLET_TOOL);
 
 	seat_button_count = update_seat_button_count(device->seat,
 						     button,
@@ -2627,7 +3975,8 @@ tablet_pad_notify_button(struct libinput_device *device,
 	struct libinput_event_tablet_pad *button_event;
 	unsigned int mode;
 
-	button_event = zalloc(sizeof *button_event);
+	button_event = event_pool_alloc(device->seat->libinput,
+					EVENT_POOL_TABLET_PAD);
 
 	mode = libinput_tablet_pad_mode_group_get_mode(group);
 
@@ -2656,7 +4005,8 @@ tablet_pad_notify_ring(struct libinput_device *device,
 	struct libinput_event_tablet_pad *ring_event;
 	unsigned int mode;
 
-	ring_event = zalloc(sizeof *ring_event);
+	ring_event = event_pool_alloc(device->seat->libinput,
+				      EVENT_POOL_TABLET_PAD);
 
 	mode = libinput_tablet_pad_mode_group_get_mode(group);
 
@@ -2686,7 +4036,8 @@ tablet_pad_notify_strip(struct libinput_device *device,
 	struct libinput_event_tablet_pad *strip_event;
 	unsigned int mode;
 
-	strip_event = zalloc(sizeof *strip_event);
+	strip_event = event_pool_alloc(device->seat->libinput,
+				       EVENT_POOL_TABLET_PAD);
 
 	mode = libinput_tablet_pad_mode_group_get_mode(group);
 
@@ -2721,7 +4072,8 @@ gesture_notify(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_GESTURE))
 		return;
 
-	gesture_event = zalloc(sizeof *gesture_event);
+	gesture_event = event_pool_alloc(device->seat->libinput,
+					 EVENT_POOL_GESTURE);
 
 	*gesture_event = (struct libinput_event_gesture) {
 		.time = time,
@@ -2822,7 +4174,8 @@ switch_notify_toggle(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_SWITCH))
 		return;
 
-	switch_event = zalloc(sizeof *switch_event);
+	switch_event = event_pool_alloc(device->seat->libinput,
+					EVENT_POOL_SWITCH);
 
 	*switch_event = (struct libinput_event_switch) {
 		.time = time,
@@ -2841,13 +4194,134 @@ switch_notify_toggle(struct libinput_device *device,
 #endif
 }
 
+static inline bool
+pointer_axis_event_is_stop(const struct libinput_event_pointer *event)
+{
+	if ((event->axes & AS_MASK(LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL)) &&
+	    event->delta.x == 0.0)
+		return true;
+
+	if ((event->axes & AS_MASK(LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL)) &&
+	    event->delta.y == 0.0)
+		return true;
+
+	return false;
+}
+
+static bool
+libinput_coalesce_event(struct libinput *libinput,
+			struct libinput_event *event)
+{
+	struct libinput_event *last;
+	struct libinput_event_pointer *prev, *pev;
+	size_t idx;
+
+	if (!libinput->coalesce.enabled || libinput->events_count == 0)
+		return false;
+
+	idx = (libinput->events_in + libinput->events_len - 1) %
+		libinput->events_len;
+	last = libinput->events[idx];
+	if (last->type != event->type || last->device != event->device)
+		return false;
+
+	prev = (struct libinput_event_pointer *)last;
+	pev = (struct libinput_event_pointer *)event;
+
+	switch (event->type) {
+	case LIBINPUT_EVENT_POINTER_MOTION:
+		prev->delta_raw.x += pev->delta_raw.x;
+		prev->delta_raw.y += pev->delta_raw.y;
+		break;
+	case LIBINPUT_EVENT_POINTER_AXIS:
+		/* scroll stop events must stay separate */
+		if (prev->axes != pev->axes ||
+		    prev->source != pev->source ||
+		    pointer_axis_event_is_stop(prev) ||
+		    pointer_axis_event_is_stop(pev))
+			return false;
+
+		prev->discrete.x += pev->discrete.x;
+		prev->discrete.y += pev->discrete.y;
+		break;
+	default:
+		return false;
+	}
+
+	prev->delta.x += pev->delta.x;
+	prev->delta.y += pev->delta.y;
+	prev->time = pev->time;
+
+	libinput->coalesce.count++;
+	event_pool_release(libinput, event);
+
+	return true;
+}
+
+static inline bool
+event_is_droppable(const struct libinput_event *event)
+{
+	switch (event->type) {
+	case LIBINPUT_EVENT_POINTER_MOTION:
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_PINCH_UPDATE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/**
+ * Discard the oldest queued motion event.
+ *
+ * Usually that's the event at the head of the queue, otherwise the
+ * events before it move along by one slot. The number of events at the
+ * head that can't be discarded is remembered, so they're only scanned
+ * once.
+ *
+ * @return true if an event was discarded, false otherwise
+ */
+static bool
+libinput_drop_queued_event(struct libinput *libinput)
+{
+	struct libinput_event **events = libinput->events;
+	size_t len = libinput->events_len;
+	size_t out = libinput->events_out;
+	size_t count = libinput->events_count;
+	size_t i;
+
+	for (i = libinput->event_queue.undroppable; i < count; i++) {
+		if (event_is_droppable(events[(out + i) % len]))
+			break;
+	}
+
+	libinput->event_queue.undroppable = i;
+	if (i == count)
+		return false;
+
+	libinput_event_destroy(events[(out + i) % len]);
+
+	/* close the gap, the events before the dropped one move down */
+	for (; i > 0; i--)
+		events[(out + i) % len] = events[(out + i - 1) % len];
+
+	libinput->events_out = (out + 1) % len;
+	libinput->events_count--;
+	libinput->event_queue.dropped++;
+
+	return true;
+}
+
 static void
 libinput_post_event(struct libinput *libinput,
 		    struct libinput_event *event)
 {
-	struct libinput_event **events = libinput->events;
-	size_t events_len = libinput->events_len;
-	size_t events_count = libinput->events_count;
+	struct libinput_event **events;
+	size_t events_len;
+	size_t events_count;
 	size_t move_len;
 	size_t new_out;
 
@@ -2855,6 +4329,29 @@ libinput_post_event(struct libinput *libinput,
 	log_debug(libinput, "Queuing %s\n", event_type_to_str(event->type));
 #endif
 
+	trace_point1(post_event, event->type);
+
+	if (libinput_coalesce_event(libinput, event))
+		return;
+
+	/* From here on the event is ours, a discarded event gets
+	 * destroyed like any other */
+	if (event->device)
+		libinput_device_ref(event->device);
+
+	if (libinput->event_queue.limit &&
+	    libinput->events_count >= libinput->event_queue.limit &&
+	    !libinput_drop_queued_event(libinput) &&
+	    event_is_droppable(event)) {
+		libinput_event_destroy(event);
+		libinput->event_queue.dropped++;
+		return;
+	}
+
+	events = libinput->events;
+	events_len = libinput->events_len;
+	events_count = libinput->events_count;
+
 	events_count++;
 	if (events_count > events_len) {
 		void *tmp;
@@ -2865,6 +4362,8 @@ libinput_post_event(struct libinput *libinput,
 			log_error(libinput,
 				  "Failed to reallocate event ring buffer. "
 				  "Events may be discarded\n");
+			libinput_event_destroy(event);
+			libinput->event_queue.dropped++;
 			return;
 		}
 
@@ -2886,12 +4385,31 @@ libinput_post_event(struct libinput *libinput,
 		libinput->events_len = events_len;
 	}
 
-	if (event->device)
-		libinput_device_ref(event->device);
-
 	libinput->events_count = events_count;
 	events[libinput->events_in] = event;
 	libinput->events_in = (libinput->events_in + 1) % libinput->events_len;
+
+	libinput->event_queue.peak = max(libinput->event_queue.peak,
+					 events_count);
+
+	if (libinput->event_queue.watermark &&
+	    !libinput->event_queue.watermark_reached &&
+	    events_count >= libinput->event_queue.watermark) {
+		libinput->event_queue.watermark_reached = true;
+		libinput->event_queue.watermark_handler(libinput,
+							events_count);
+	}
+}
+
+static inline void
+libinput_event_queue_drained(struct libinput *libinput, size_t count)
+{
+	size_t *undroppable = &libinput->event_queue.undroppable;
+
+	*undroppable = *undroppable > count ? *undroppable - count : 0;
+
+	if (libinput->events_count < libinput->event_queue.watermark)
+		libinput->event_queue.watermark_reached = false;
 }
 
 LIBINPUT_EXPORT struct libinput_event *
@@ -2906,10 +4424,42 @@ libinput_get_event(struct libinput *libinput)
 	libinput->events_out =
 		(libinput->events_out + 1) % libinput->events_len;
 	libinput->events_count--;
+	libinput_event_queue_drained(libinput, 1);
+	latency_trace_retrieved(libinput, &event, 1);
 
 	return event;
 }
 
+LIBINPUT_EXPORT size_t
+libinput_get_events(struct libinput *libinput,
+		    struct libinput_event **events,
+		    size_t nevents)
+{
+	size_t count, chunk;
+
+	count = min(nevents, libinput->events_count);
+	if (count == 0)
+		return 0;
+
+	/* The ring buffer may wrap, so copy in up to two chunks */
+	chunk = min(count, libinput->events_len - libinput->events_out);
+	memcpy(events,
+	       libinput->events + libinput->events_out,
+	       chunk * sizeof *events);
+	if (chunk < count)
+		memcpy(events + chunk,
+		       libinput->events,
+		       (count - chunk) * sizeof *events);
+
+	libinput->events_out =
+		(libinput->events_out + count) % libinput->events_len;
+	libinput->events_count -= count;
+	libinput_event_queue_drained(libinput, count);
+	latency_trace_retrieved(libinput, events, count);
+
+	return count;
+}
+
 LIBINPUT_EXPORT enum libinput_event_type
 libinput_next_event_type(struct libinput *libinput)
 {
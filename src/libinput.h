@@ -832,6 +832,21 @@ enum libinput_event_type {
 void
 libinput_event_destroy(struct libinput_event *event);
 
+/**
+ * @ingroup event
+ *
+ * Destroy all events in the array, freeing all associated resources. This
+ * is equivalent to calling libinput_event_destroy() for each event in the
+ * array. The array itself is not modified or freed.
+ *
+ * @param events An array of events retrieved by libinput_get_events() or
+ * libinput_get_event().
+ * @param nevents The number of events in the array
+ */
+void
+libinput_event_destroy_array(struct libinput_event **events,
+			     size_t nevents);
+
 /**
  * @ingroup event
  *
@@ -2553,6 +2568,48 @@ libinput_tablet_tool_get_serial(struct libinput_tablet_tool *tool);
 void *
 libinput_tablet_tool_get_user_data(struct libinput_tablet_tool *tool);
 
+/**
+ * @ingroup event_tablet
+ *
+ * Save the capabilities and the pressure offset of all unique tools (see
+ * @ref tablet-serial-numbers) seen by this context to the file at path,
+ * replacing the file if it exists. Load the file with
+ * libinput_load_tablet_tool_cache() in a later session.
+ *
+ * The file format is private to libinput and may change between
+ * versions.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param path The file to write
+ * @return 0 on success or a negative errno on failure
+ *
+ * @see libinput_load_tablet_tool_cache
+ */
+int
+libinput_save_tablet_tool_cache(struct libinput *libinput,
+				const char *path);
+
+/**
+ * @ingroup event_tablet
+ *
+ * Load tools previously saved with libinput_save_tablet_tool_cache().
+ * When a loaded tool first comes into proximity, libinput uses the saved
+ * capabilities and pressure offset instead of looking them up and
+ * detecting the pressure offset again, see @ref tablet-tool-cache.
+ *
+ * Tools already seen by this context are not modified. Invalid entries
+ * in the file are ignored.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param path The file to read
+ * @return The number of tools loaded or a negative errno on failure
+ *
+ * @see libinput_save_tablet_tool_cache
+ */
+int
+libinput_load_tablet_tool_cache(struct libinput *libinput,
+				const char *path);
+
 /**
  * @ingroup event_tablet
  *
@@ -2914,6 +2971,89 @@ struct libinput_interface {
 	void (*close_restricted)(int fd, void *user_data);
 };
 
+/**
+ * @ingroup base
+ * @struct libinput_open_request
+ *
+ * A pending request to open a device, see libinput_set_open_async().
+ */
+struct libinput_open_request;
+
+/**
+ * @ingroup base
+ *
+ * Asynchronous replacement for libinput_interface::open_restricted(). The
+ * caller must eventually call libinput_open_request_complete() exactly
+ * once for the request, with the opened file descriptor or a negative
+ * errno. This may happen from within this function or any time later,
+ * from any thread.
+ *
+ * @param libinput The libinput context
+ * @param request The request to complete
+ * @param path The device path to open
+ * @param flags Flags as defined by open(2)
+ * @param user_data The user_data provided in
+ * libinput_udev_create_context()
+ *
+ * @see libinput_set_open_async
+ */
+typedef void (*libinput_open_async_func)(struct libinput *libinput,
+					 struct libinput_open_request *request,
+					 const char *path,
+					 int flags,
+					 void *user_data);
+
+/**
+ * @ingroup base
+ *
+ * Open devices asynchronously. Where opening a device is slow, e.g. a
+ * D-Bus round trip to logind for each device, this allows the caller to
+ * have many requests in flight at the same time instead of handling the
+ * requests one-by-one in libinput_interface::open_restricted().
+ *
+ * With an asynchronous open function set, libinput_udev_assign_seat(),
+ * libinput_resume() and hotplugged devices request the open and
+ * return. The device is created in the first libinput_dispatch() after
+ * the caller completed the request with libinput_open_request_complete(),
+ * and the @ref LIBINPUT_EVENT_DEVICE_ADDED events are queued in the order
+ * the requests were completed.
+ *
+ * The path backend and any other file opened by libinput always use
+ * libinput_interface::open_restricted(), libinput_path_add_device()
+ * must return the device immediately. File descriptors are always
+ * closed with libinput_interface::close_restricted().
+ *
+ * @param libinput A previously initialized libinput context
+ * @param open_async The open function, or NULL to use
+ * libinput_interface::open_restricted() again
+ * @return 0 on success or a negative errno on failure
+ */
+int
+libinput_set_open_async(struct libinput *libinput,
+			libinput_open_async_func open_async);
+
+/**
+ * @ingroup base
+ *
+ * Complete a request from the libinput_open_async_func. This function
+ * may be called from any thread, libinput processes the result in the
+ * next call to libinput_dispatch(). The file descriptor returned by
+ * libinput_get_fd() becomes readable when a request is completed.
+ *
+ * Once the request is completed, the request must not be accessed any
+ * more. If libinput no longer needs the device, e.g. because it was
+ * suspended in the meantime, the fd is closed with
+ * libinput_interface::close_restricted() in libinput_dispatch(). If the
+ * libinput context was destroyed in the meantime, the fd is closed with
+ * close(2) immediately.
+ *
+ * @param request The request passed to the libinput_open_async_func
+ * @param fd The file descriptor, or a negative errno on failure
+ */
+void
+libinput_open_request_complete(struct libinput_open_request *request,
+			       int fd);
+
 /**
  * @ingroup base
  *
@@ -3004,6 +3144,41 @@ struct libinput_device *
 libinput_path_add_device(struct libinput *libinput,
 			 const char *path);
 
+/**
+ * @ingroup base
+ *
+ * Add multiple devices to a libinput context initialized with
+ * libinput_path_create_context(). This is equivalent to calling
+ * libinput_path_add_device() for each path in turn, but the devices are
+ * probed in parallel where possible. This makes adding a large number
+ * of devices significantly faster.
+ *
+ * The @ref LIBINPUT_EVENT_DEVICE_ADDED events are queued in the order of
+ * the paths, regardless of the order in which the devices finished
+ * probing.
+ *
+ * If devices is not NULL, it must have space for npaths devices. On
+ * return, devices[i] is the device created for paths[i] or NULL if that
+ * device could not be added. The lifetime of the returned device pointers
+ * is the same as for libinput_path_add_device().
+ *
+ * @param libinput A previously initialized libinput context
+ * @param paths An array of paths to input devices
+ * @param npaths The number of paths
+ * @param devices Optional array to store the newly initiated devices in
+ * @return The number of devices successfully added
+ *
+ * @note It is an application bug to call this function on a libinput
+ * context initialized with libinput_udev_create_context().
+ *
+ * @see libinput_path_add_device
+ */
+size_t
+libinput_path_add_devices(struct libinput *libinput,
+			  const char **paths,
+			  size_t npaths,
+			  struct libinput_device **devices);
+
 /**
  * @ingroup base
  *
@@ -3049,13 +3224,88 @@ libinput_get_fd(struct libinput *libinput);
  * timing-sensitive features (e.g. tap-to-click), any delay in calling
  * libinput_dispatch() may prevent these features from working correctly.
  *
+ * If a dispatch budget is set with libinput_dispatch_set_budget(), this
+ * function may return -EAGAIN before all available data was processed.
+ * The remaining data may already have been read from the file descriptor
+ * returned by libinput_get_fd(), the caller must call libinput_dispatch()
+ * again without waiting for the file descriptor to become readable.
+ *
  * @param libinput A previously initialized libinput context
  *
- * @return 0 on success, or a negative errno on failure
+ * @return 0 on success, -EAGAIN if a dispatch budget is set and was
+ * exhausted before all data was processed, or a negative errno on failure
  */
 int
 libinput_dispatch(struct libinput *libinput);
 
+/**
+ * @ingroup base
+ *
+ * Limits on the work done by a single call to libinput_dispatch(), see
+ * libinput_dispatch_set_budget().
+ */
+enum libinput_dispatch_budget {
+	/**
+	 * The maximum number of kernel events processed from one device
+	 * before libinput moves on to the next device with pending data.
+	 */
+	LIBINPUT_DISPATCH_BUDGET_SOURCE_EVENTS = 1,
+	/**
+	 * The maximum number of kernel events processed from all devices
+	 * within one call to libinput_dispatch().
+	 */
+	LIBINPUT_DISPATCH_BUDGET_CALL_EVENTS,
+	/**
+	 * The maximum time in microseconds spent processing kernel events
+	 * within one call to libinput_dispatch().
+	 */
+	LIBINPUT_DISPATCH_BUDGET_CALL_USEC,
+};
+
+/**
+ * @ingroup base
+ *
+ * Limit the work done by libinput_dispatch(). By default, all budgets are
+ * 0 (unlimited) and libinput_dispatch() processes all data available at
+ * the time of the call.
+ *
+ * If any budget is set, devices with pending data are served in
+ * round-robin order, each device processes at most @ref
+ * LIBINPUT_DISPATCH_BUDGET_SOURCE_EVENTS events before the next device
+ * is served. Once the per-call budget is exhausted, libinput_dispatch()
+ * returns -EAGAIN and the next call continues with the devices that were
+ * not yet served. Budgets are only checked between hardware frames, so
+ * a call may exceed the budget by the size of one frame. Internal
+ * timeouts are always processed and do not count towards the budget.
+ *
+ * This allows a caller to bound the time spent processing input per
+ * iteration of its own loop, e.g. per repaint.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param budget The budget to set
+ * @param value The new value, or 0 for unlimited
+ *
+ * @see libinput_dispatch_get_budget
+ */
+void
+libinput_dispatch_set_budget(struct libinput *libinput,
+			     enum libinput_dispatch_budget budget,
+			     uint64_t value);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @param budget The budget to return
+ * @return The current value of the given budget, 0 if unlimited or the
+ * budget is invalid
+ *
+ * @see libinput_dispatch_set_budget
+ */
+uint64_t
+libinput_dispatch_get_budget(struct libinput *libinput,
+			     enum libinput_dispatch_budget budget);
+
 /**
  * @ingroup base
  *
@@ -3070,6 +3320,32 @@ libinput_dispatch(struct libinput *libinput);
 struct libinput_event *
 libinput_get_event(struct libinput *libinput);
 
+/**
+ * @ingroup base
+ *
+ * Retrieve up to nevents events from libinput's internal event queue and
+ * store them in the caller-provided array, in the order they were
+ * queued. This is equivalent to calling libinput_get_event() up to nevents
+ * times but moves the events out of the queue in one go.
+ *
+ * After handling the retrieved events, the caller must destroy each event
+ * using libinput_event_destroy() or all of them with
+ * libinput_event_destroy_array().
+ *
+ * @param libinput A previously initialized libinput context
+ * @param events An array with space for at least nevents events
+ * @param nevents The maximum number of events to retrieve
+ * @return The number of events stored in the array, or 0 if no event is
+ * available.
+ *
+ * @see libinput_get_event
+ * @see libinput_event_destroy_array
+ */
+size_t
+libinput_get_events(struct libinput *libinput,
+		    struct libinput_event **events,
+		    size_t nevents);
+
 /**
  * @ingroup base
  *
@@ -3084,6 +3360,259 @@ libinput_get_event(struct libinput *libinput);
 enum libinput_event_type
 libinput_next_event_type(struct libinput *libinput);
 
+/**
+ * @ingroup base
+ *
+ * Enable or disable coalescing of queued events. If enabled, an event is
+ * merged into the most recently queued event if that event has not yet
+ * been retrieved by the caller, is of the same type and is from the same
+ * device. This only applies to:
+ * - @ref LIBINPUT_EVENT_POINTER_MOTION events, the deltas are summed up
+ * - @ref LIBINPUT_EVENT_POINTER_AXIS events with the same axes and axis
+ *   source, the axis values and discrete values are summed up. An axis
+ *   event with a value of 0 on any axis (see
+ *   libinput_event_pointer_get_axis_value()) is never merged.
+ *
+ * The merged event carries the timestamp of the most recent event.
+ * Events retrieved with libinput_get_event() are never modified.
+ *
+ * Coalescing keeps the number of queued events and the time spent
+ * processing them bounded when the caller cannot process events for a
+ * while. It is disabled by default as it hides the individual timestamps
+ * of the events merged.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param enable Non-zero to enable coalescing, zero to disable it
+ *
+ * @see libinput_get_event_coalescing
+ */
+void
+libinput_set_event_coalescing(struct libinput *libinput, int enable);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return Non-zero if event coalescing is enabled, zero otherwise
+ *
+ * @see libinput_set_event_coalescing
+ */
+int
+libinput_get_event_coalescing(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Limit the number of events in the event queue. Once the limit is
+ * reached, libinput makes room for a new event by discarding the oldest
+ * queued motion event, i.e. an event of type @ref
+ * LIBINPUT_EVENT_POINTER_MOTION, @ref
+ * LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE, @ref
+ * LIBINPUT_EVENT_TOUCH_MOTION, @ref LIBINPUT_EVENT_TABLET_TOOL_AXIS, @ref
+ * LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE or @ref
+ * LIBINPUT_EVENT_GESTURE_PINCH_UPDATE. If no such event is queued, the new
+ * event is discarded instead if it is a motion event.
+ *
+ * Other events, e.g. button, key or touch up events, are never discarded,
+ * the queue exceeds the limit if necessary to hold them.
+ *
+ * Events already queued when the limit is set are not discarded.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param limit The maximum number of queued events, or 0 for unlimited
+ *
+ * @see libinput_get_event_queue_limit
+ * @see LIBINPUT_COUNTER_EVENTS_DROPPED
+ */
+void
+libinput_set_event_queue_limit(struct libinput *libinput,
+			       unsigned int limit);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The maximum number of queued events, or 0 for unlimited
+ *
+ * @see libinput_set_event_queue_limit
+ */
+unsigned int
+libinput_get_event_queue_limit(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Handler type for the event queue watermark, see
+ * libinput_set_event_queue_watermark().
+ *
+ * @param libinput The libinput context
+ * @param depth The number of events in the event queue
+ */
+typedef void (*libinput_event_queue_watermark_handler)(struct libinput *libinput,
+						       unsigned int depth);
+
+/**
+ * @ingroup base
+ *
+ * Set a handler that is called when the number of queued events reaches
+ * the given watermark. The handler is called once, it is called again
+ * only after the number of queued events dropped below the watermark.
+ *
+ * The handler is called as the event that reaches the watermark is
+ * queued. That is usually from within libinput_dispatch(), but any other
+ * function that generates events may call it too. These include
+ * libinput_path_add_device(), libinput_path_add_devices(),
+ * libinput_path_remove_device(), libinput_udev_assign_seat(),
+ * libinput_suspend(), libinput_resume() and
+ * libinput_device_config_send_events_set_mode(). The handler must not
+ * call libinput_dispatch() or any of those functions. It is intended to
+ * detect a caller that fails to process events in time.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param watermark The number of queued events that triggers the
+ * handler, or 0 to disable the handler
+ * @param handler The handler to call
+ */
+void
+libinput_set_event_queue_watermark(struct libinput *libinput,
+				   unsigned int watermark,
+				   libinput_event_queue_watermark_handler handler);
+
+/**
+ * @ingroup base
+ *
+ * Context-wide counters, see libinput_get_counter().
+ */
+enum libinput_counter {
+	/**
+	 * The number of times libinput re-programmed the timer file
+	 * descriptor used for internal timeouts.
+	 */
+	LIBINPUT_COUNTER_TIMERFD_SETTIME = 1,
+	/**
+	 * The number of events merged into a previously queued event, see
+	 * libinput_set_event_coalescing().
+	 */
+	LIBINPUT_COUNTER_EVENTS_COALESCED,
+	/**
+	 * The highest number of events in the event queue at the same
+	 * time.
+	 */
+	LIBINPUT_COUNTER_EVENT_QUEUE_PEAK,
+	/**
+	 * The number of events discarded because the event queue was full,
+	 * see libinput_set_event_queue_limit().
+	 */
+	LIBINPUT_COUNTER_EVENTS_DROPPED,
+};
+
+/**
+ * @ingroup base
+ *
+ * Return the current value of the given context-wide counter. Counters
+ * start at zero when the context is created and are never reset during
+ * the lifetime of the context.
+ *
+ * Counters are intended for debugging and performance measurements, their
+ * values do not affect libinput's behavior.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param counter The counter to return
+ * @return The counter value or 0 if the counter is invalid
+ */
+uint64_t
+libinput_get_counter(struct libinput *libinput,
+		     enum libinput_counter counter);
+
+/**
+ * @ingroup base
+ *
+ * Counters of the event allocation pool, see
+ * libinput_event_pool_get_counter().
+ */
+enum libinput_event_pool_counter {
+	/**
+	 * The number of events newly allocated because no previously
+	 * destroyed event was available for re-use.
+	 */
+	LIBINPUT_EVENT_POOL_COUNTER_ALLOCATED = 1,
+	/**
+	 * The number of events that re-used the memory of a previously
+	 * destroyed event.
+	 */
+	LIBINPUT_EVENT_POOL_COUNTER_RECYCLED,
+	/**
+	 * The highest number of events that were queued or held by the
+	 * caller at the same time.
+	 */
+	LIBINPUT_EVENT_POOL_COUNTER_PEAK,
+};
+
+/**
+ * @ingroup base
+ *
+ * Set the maximum number of destroyed events libinput keeps for re-use.
+ * Events destroyed with libinput_event_destroy() are kept by the context
+ * and re-used for subsequent events instead of being freed, up to this
+ * limit. The limit applies separately to each group of event types that
+ * share the same event struct, e.g. all pointer events are one group, all
+ * touch events are another group.
+ *
+ * A limit of 0 disables re-use, every event is freed when destroyed. If the
+ * new limit is lower than the number of events currently kept for re-use,
+ * the excess events are freed immediately.
+ *
+ * The default limit is 64.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param limit The maximum number of events kept for re-use per group
+ *
+ * @see libinput_event_pool_get_limit
+ * @see libinput_event_pool_get_counter
+ */
+void
+libinput_event_pool_set_limit(struct libinput *libinput,
+			      unsigned int limit);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The maximum number of events kept for re-use per group of event
+ * types
+ *
+ * @see libinput_event_pool_set_limit
+ */
+unsigned int
+libinput_event_pool_get_limit(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Return the current value of the given event pool counter for the group
+ * of event types the given type belongs to. Counters are shared between
+ * all event types in the same group, i.e. the counter for @ref
+ * LIBINPUT_EVENT_POINTER_MOTION and @ref LIBINPUT_EVENT_POINTER_BUTTON is
+ * the same counter. Counters are never reset during the lifetime of the
+ * context.
+ *
+ * This function is intended to size the limit set with
+ * libinput_event_pool_set_limit(): a @ref LIBINPUT_EVENT_POOL_COUNTER_PEAK
+ * at or below the limit means events no longer need to be allocated once
+ * the caller reaches a steady state.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param type An event type other than @ref LIBINPUT_EVENT_NONE
+ * @param counter The counter to return
+ * @return The counter value or 0 if the type or counter is invalid
+ *
+ * @see libinput_event_pool_set_limit
+ */
+uint64_t
+libinput_event_pool_get_counter(struct libinput *libinput,
+				enum libinput_event_type type,
+				enum libinput_event_pool_counter counter);
+
 /**
  * @ingroup base
  *
@@ -3420,6 +3949,226 @@ libinput_device_set_user_data(struct libinput_device *device, void *user_data);
 void *
 libinput_device_get_user_data(struct libinput_device *device);
 
+/**
+ * @ingroup device
+ *
+ * Per-device counters, see libinput_device_get_counter().
+ */
+enum libinput_device_counter {
+	/**
+	 * The number of events read from the kernel device.
+	 */
+	LIBINPUT_DEVICE_COUNTER_INPUT_EVENTS = 1,
+	/**
+	 * The number of hardware frames, i.e. SYN_REPORT events, processed.
+	 */
+	LIBINPUT_DEVICE_COUNTER_FRAMES,
+	/**
+	 * The number of times the kernel discarded events because they were
+	 * not read in time (SYN_DROPPED).
+	 */
+	LIBINPUT_DEVICE_COUNTER_SYN_DROPPED,
+	/**
+	 * The number of libinput events generated by this device, of all
+	 * types. See libinput_device_get_event_counter() for the count of
+	 * a single type.
+	 */
+	LIBINPUT_DEVICE_COUNTER_EVENTS_POSTED,
+	/**
+	 * The time in microseconds spent processing events from the kernel
+	 * device. This is only measured while latency tracing is enabled,
+	 * see libinput_set_latency_tracing().
+	 */
+	LIBINPUT_DEVICE_COUNTER_PROCESS_USEC,
+	/**
+	 * The number of internal timeouts of this device that expired.
+	 */
+	LIBINPUT_DEVICE_COUNTER_TIMERS_FIRED,
+	/**
+	 * The number of times this device was re-opened after being
+	 * suspended, e.g. after re-enabling it with
+	 * libinput_device_config_send_events_set_mode(). This does not
+	 * include libinput_resume(), devices are removed and added again
+	 * in that case.
+	 */
+	LIBINPUT_DEVICE_COUNTER_RESUMES,
+	/**
+	 * The time in microseconds spent re-opening and re-synchronizing
+	 * this device, see @ref LIBINPUT_DEVICE_COUNTER_RESUMES.
+	 */
+	LIBINPUT_DEVICE_COUNTER_RESUME_USEC,
+};
+
+/**
+ * @ingroup device
+ *
+ * Return the current value of the given counter for this device.
+ * Counters start at zero when the device is added and are never reset
+ * during the lifetime of the device.
+ *
+ * Counters are intended for debugging and performance measurements, their
+ * values do not affect libinput's behavior.
+ *
+ * @param device A previously obtained device
+ * @param counter The counter to return
+ * @return The counter value or 0 if the counter is invalid
+ *
+ * @see libinput_get_device_counter
+ */
+uint64_t
+libinput_device_get_counter(struct libinput_device *device,
+			    enum libinput_device_counter counter);
+
+/**
+ * @ingroup device
+ *
+ * Return the number of libinput events of the given type generated by
+ * this device. This includes events that were later merged or discarded,
+ * see libinput_set_event_coalescing() and
+ * libinput_set_event_queue_limit().
+ *
+ * @param device A previously obtained device
+ * @param type An event type other than @ref LIBINPUT_EVENT_NONE
+ * @return The number of events or 0 if the type is invalid
+ *
+ * @see libinput_get_event_counter
+ */
+uint64_t
+libinput_device_get_event_counter(struct libinput_device *device,
+				  enum libinput_event_type type);
+
+/**
+ * @ingroup base
+ *
+ * Return the sum of the given device counter over all devices that were
+ * ever added to this context, including devices that have since been
+ * removed.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param counter The counter to return
+ * @return The counter value or 0 if the counter is invalid
+ *
+ * @see libinput_device_get_counter
+ */
+uint64_t
+libinput_get_device_counter(struct libinput *libinput,
+			    enum libinput_device_counter counter);
+
+/**
+ * @ingroup base
+ *
+ * Return the sum of libinput_device_get_event_counter() over all devices
+ * that were ever added to this context, including devices that have since
+ * been removed.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param type An event type other than @ref LIBINPUT_EVENT_NONE
+ * @return The number of events or 0 if the type is invalid
+ *
+ * @see libinput_device_get_event_counter
+ */
+uint64_t
+libinput_get_event_counter(struct libinput *libinput,
+			   enum libinput_event_type type);
+
+/**
+ * @ingroup base
+ *
+ * Enable or disable latency tracing. If enabled, libinput records for each
+ * event how long it took from the kernel timestamp of the hardware event
+ * until the caller retrieved the libinput event with libinput_get_event()
+ * or libinput_get_events(). The time is split into the stages listed in
+ * @ref libinput_latency_stage and accumulated in per-device, per-event
+ * type histograms, see libinput_device_get_latency_histogram().
+ *
+ * Latency tracing is disabled by default. Enabling it adds a clock lookup
+ * to each event posted and each call to retrieve events, and two to each
+ * hardware frame. While enabled, libinput also measures @ref
+ * LIBINPUT_DEVICE_COUNTER_PROCESS_USEC.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param enable Non-zero to enable latency tracing, zero to disable it
+ *
+ * @see libinput_get_latency_tracing
+ */
+void
+libinput_set_latency_tracing(struct libinput *libinput, int enable);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return Non-zero if latency tracing is enabled, zero otherwise
+ *
+ * @see libinput_set_latency_tracing
+ */
+int
+libinput_get_latency_tracing(struct libinput *libinput);
+
+/**
+ * @ingroup device
+ *
+ * The stages of an event's latency, see
+ * libinput_device_get_latency_histogram(). An event is either recorded
+ * in @ref LIBINPUT_LATENCY_STAGE_KERNEL and @ref
+ * LIBINPUT_LATENCY_STAGE_PROCESSING, or in @ref
+ * LIBINPUT_LATENCY_STAGE_HOLD. All events are recorded in @ref
+ * LIBINPUT_LATENCY_STAGE_QUEUE once retrieved by the caller.
+ */
+enum libinput_latency_stage {
+	/**
+	 * From the kernel timestamp of the hardware event until libinput
+	 * starts processing it. This includes the time until the caller
+	 * calls libinput_dispatch().
+	 */
+	LIBINPUT_LATENCY_STAGE_KERNEL = 1,
+	/**
+	 * From the start of processing the hardware event until the
+	 * resulting libinput event is added to the event queue.
+	 */
+	LIBINPUT_LATENCY_STAGE_PROCESSING,
+	/**
+	 * For events libinput deliberately holds back, e.g. a tap that is
+	 * only a button click once the tap timeout expires, a button press
+	 * held for middle button emulation or debouncing: from the
+	 * timestamp of the libinput event until it is added to the event
+	 * queue.
+	 */
+	LIBINPUT_LATENCY_STAGE_HOLD,
+	/**
+	 * From adding the event to the event queue until the caller
+	 * retrieves it.
+	 */
+	LIBINPUT_LATENCY_STAGE_QUEUE,
+};
+
+/**
+ * @ingroup device
+ *
+ * Copy the latency histogram of the given event type and stage into
+ * buckets. Bucket 0 counts latencies below 1us, bucket n counts
+ * latencies of 2^(n-1)us up to but excluding 2^n us. The last bucket
+ * counts all latencies above the second-to-last bucket.
+ *
+ * Events are only recorded while latency tracing is enabled, see
+ * libinput_set_latency_tracing().
+ *
+ * @param device A previously obtained device
+ * @param type An event type other than @ref LIBINPUT_EVENT_NONE
+ * @param stage The latency stage
+ * @param buckets Storage for up to nbuckets values, may be NULL if
+ * nbuckets is 0
+ * @param nbuckets The number of elements in buckets
+ * @return The number of buckets of the histogram, independent of
+ * nbuckets, or 0 if the type or stage is invalid
+ */
+size_t
+libinput_device_get_latency_histogram(struct libinput_device *device,
+				      enum libinput_event_type type,
+				      enum libinput_latency_stage stage,
+				      uint64_t *buckets,
+				      size_t nbuckets);
+
 /**
  * @ingroup device
  *
@@ -106,16 +106,20 @@ path_seat_get_named(struct path_input *input,
 	return NULL;
 }
 
-static struct libinput_device *
-path_device_enable(struct path_input *input,
-		   struct udev_device *udev_device,
-		   const char *seat_logical_name_override)
+/**
+ * Set up the probe for a udev device, see evdev_device_create_all().
+ */
+static bool
+path_device_prepare(struct path_input *input,
+		    struct udev_device *udev_device,
+		    const char *seat_logical_name_override,
+		    struct evdev_device_probe *probe)
 {
 	struct path_seat *seat;
-	struct evdev_device *device = NULL;
 	char *seat_name = NULL, *seat_logical_name = NULL;
-	const char *seat_prop, *output_name;
+	const char *seat_prop;
 	const char *devnode, *sysname;
+	bool rc = false;
 
 	devnode = udev_device_get_devnode(udev_device);
 	sysname = udev_device_get_sysname(udev_device);
@@ -153,8 +157,30 @@ path_device_enable(struct path_input *input,
 		}
 	}
 
-	device = evdev_device_create(&seat->base, udev_device);
-	libinput_seat_unref(&seat->base);
+	probe->seat = &seat->base;
+	probe->udev_device = udev_device_ref(udev_device);
+	rc = true;
+
+out:
+	free(seat_name);
+	free(seat_logical_name);
+
+	return rc;
+}
+
+static struct libinput_device *
+path_device_finish(struct path_input *input,
+		   struct evdev_device_probe *probe)
+{
+	struct udev_device *udev_device = probe->udev_device;
+	struct evdev_device *device = probe->device;
+	const char *output_name;
+	const char *devnode, *sysname;
+
+	libinput_seat_unref(probe->seat);
+
+	devnode = udev_device_get_devnode(udev_device);
+	sysname = udev_device_get_sysname(udev_device);
 
 	if (device == EVDEV_UNHANDLED_DEVICE) {
 		device = NULL;
@@ -176,26 +202,98 @@ path_device_enable(struct path_input *input,
 	device->output_name = safe_strdup(output_name);
 
 out:
-	free(seat_name);
-	free(seat_logical_name);
+	udev_device_unref(udev_device);
 
 	return device ? &device->base : NULL;
 }
 
+/**
+ * Enable the given udev devices, NULL entries are skipped. On return,
+ * devices[i] is the device created for udev_devices[i] or NULL.
+ *
+ * @return the number of devices enabled
+ */
+static size_t
+path_devices_enable(struct path_input *input,
+		    struct udev_device **udev_devices,
+		    size_t ndevices,
+		    const char *seat_logical_name_override,
+		    struct libinput_device **devices)
+{
+	struct evdev_device_probe *probes;
+	size_t *index;
+	size_t nprobes = 0;
+	size_t nenabled = 0;
+
+	probes = zalloc(ndevices * sizeof *probes);
+	index = zalloc(ndevices * sizeof *index);
+
+	for (size_t i = 0; i < ndevices; i++) {
+		devices[i] = NULL;
+
+		if (!udev_devices[i])
+			continue;
+
+		if (!path_device_prepare(input,
+					 udev_devices[i],
+					 seat_logical_name_override,
+					 &probes[nprobes]))
+			continue;
+
+		index[nprobes++] = i;
+	}
+
+	evdev_device_create_all(probes, nprobes);
+
+	for (size_t i = 0; i < nprobes; i++) {
+		struct libinput_device *device;
+
+		device = path_device_finish(input, &probes[i]);
+		devices[index[i]] = device;
+		if (device)
+			nenabled++;
+	}
+
+	free(index);
+	free(probes);
+
+	return nenabled;
+}
+
 static int
 path_input_enable(struct libinput *libinput)
 {
 	struct path_input *input = (struct path_input*)libinput;
 	struct path_device *dev;
-
-	list_for_each(dev, &input->path_list, link) {
-		if (path_device_enable(input, dev->udev_device, NULL) == NULL) {
-			path_input_disable(libinput);
-			return -1;
-		}
+	struct udev_device **udev_devices;
+	struct libinput_device **devices;
+	size_t ndevices = 0;
+	size_t nenabled;
+	int rc = 0;
+
+	list_for_each(dev, &input->path_list, link)
+		ndevices++;
+	if (ndevices == 0)
+		return 0;
+
+	udev_devices = zalloc(ndevices * sizeof *udev_devices);
+	devices = zalloc(ndevices * sizeof *devices);
+
+	ndevices = 0;
+	list_for_each(dev, &input->path_list, link)
+		udev_devices[ndevices++] = dev->udev_device;
+
+	nenabled = path_devices_enable(input, udev_devices, ndevices,
+				       NULL, devices);
+	if (nenabled != ndevices) {
+		path_input_disable(libinput);
+		rc = -1;
 	}
 
-	return 0;
+	free(devices);
+	free(udev_devices);
+
+	return rc;
 }
 
 static void
@@ -213,28 +311,49 @@ path_input_destroy(struct libinput *input)
 
 }
 
-static struct libinput_device *
-path_create_device(struct libinput *libinput,
-		   struct udev_device *udev_device,
-		   const char *seat_name)
+/**
+ * Create the devices for the given udev devices and add them to the
+ * path list, NULL entries are skipped. On return, devices[i] is the
+ * device created for udev_devices[i] or NULL.
+ *
+ * @return the number of devices created
+ */
+static size_t
+path_create_devices(struct libinput *libinput,
+		    struct udev_device **udev_devices,
+		    size_t ndevices,
+		    const char *seat_name,
+		    struct libinput_device **devices)
 {
 	struct path_input *input = (struct path_input*)libinput;
-	struct path_device *dev;
-	struct libinput_device *device;
+	size_t ncreated;
 
-	dev = zalloc(sizeof *dev);
-	dev->udev_device = udev_device_ref(udev_device);
+	ncreated = path_devices_enable(input, udev_devices, ndevices,
+				       seat_name, devices);
 
-	list_insert(&input->path_list, &dev->link);
+	for (size_t i = 0; i < ndevices; i++) {
+		struct path_device *dev;
 
-	device = path_device_enable(input, udev_device, seat_name);
+		if (!devices[i])
+			continue;
 
-	if (!device) {
-		udev_device_unref(dev->udev_device);
-		list_remove(&dev->link);
-		free(dev);
+		dev = zalloc(sizeof *dev);
+		dev->udev_device = udev_device_ref(udev_devices[i]);
+		list_insert(&input->path_list, &dev->link);
 	}
 
+	return ncreated;
+}
+
+static struct libinput_device *
+path_create_device(struct libinput *libinput,
+		   struct udev_device *udev_device,
+		   const char *seat_name)
+{
+	struct libinput_device *device;
+
+	path_create_devices(libinput, &udev_device, 1, seat_name, &device);
+
 	return device;
 }
 
@@ -326,17 +445,39 @@ udev_device_from_devnode(struct libinput *libinput,
 LIBINPUT_EXPORT struct libinput_device *
 libinput_path_add_device(struct libinput *libinput,
 			 const char *path)
+{
+	struct libinput_device *device = NULL;
+
+	libinput_path_add_devices(libinput, &path, 1, &device);
+
+	return device;
+}
+
+LIBINPUT_EXPORT size_t
+libinput_path_add_devices(struct libinput *libinput,
+			  const char **paths,
+			  size_t npaths,
+			  struct libinput_device **devices)
 {
 	struct path_input *input = (struct path_input *)libinput;
 	struct udev *udev = input->udev;
-	struct udev_device *udev_device;
-	struct libinput_device *device;
+	struct udev_device **udev_devices;
+	struct libinput_device **created;
+	size_t ncreated;
+
+	if (devices) {
+		for (size_t i = 0; i < npaths; i++)
+			devices[i] = NULL;
+	}
 
 	if (libinput->interface_backend != &interface_backend) {
 		log_bug_client(libinput, "Mismatching backends.\n");
-		return NULL;
+		return 0;
 	}
 
+	if (npaths == 0)
+		return 0;
+
 	/* We cannot do this during path_create_context because the log
 	 * handler isn't set up there but we really want to log to the right
 	 * place if the quirks run into parser errors. So we have to do it
@@ -344,20 +485,41 @@ libinput_path_add_device(struct libinput *libinput,
 	 */
 	libinput_init_quirks(libinput);
 
-	udev_device = udev_device_from_devnode(libinput, udev, path);
-	if (!udev_device) {
-		log_bug_client(libinput, "Invalid path %s\n", path);
-		return NULL;
+	udev_devices = zalloc(npaths * sizeof *udev_devices);
+	created = zalloc(npaths * sizeof *created);
+
+	for (size_t i = 0; i < npaths; i++) {
+		struct udev_device *udev_device;
+
+		udev_device = udev_device_from_devnode(libinput, udev, paths[i]);
+		if (!udev_device) {
+			log_bug_client(libinput, "Invalid path %s\n", paths[i]);
+			continue;
+		}
+
+		if (ignore_litest_test_suite_device(udev_device)) {
+			udev_device_unref(udev_device);
+			continue;
+		}
+
+		udev_devices[i] = udev_device;
 	}
 
-	if (ignore_litest_test_suite_device(udev_device)) {
-		udev_device_unref(udev_device);
-		return NULL;
+	ncreated = path_create_devices(libinput, udev_devices, npaths,
+				       NULL, created);
+
+	for (size_t i = 0; i < npaths; i++) {
+		if (udev_devices[i])
+			udev_device_unref(udev_devices[i]);
 	}
 
-	device = path_create_device(libinput, udev_device, NULL);
-	udev_device_unref(udev_device);
-	return device;
+	if (devices)
+		memcpy(devices, created, npaths * sizeof *created);
+
+	free(created);
+	free(udev_devices);
+
+	return ncreated;
 }
 
 LIBINPUT_EXPORT void
@@ -33,10 +33,14 @@
 #include <stdlib.h>
 #include <libudev.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <fnmatch.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "libinput-util.h"
 #include "libinput-private.h"
+#include "libinput-version.h"
 
 #include "quirks.h"
 
@@ -87,6 +91,10 @@ enum match_flags {
 	M_DT		= (1 << 6),
 
 	M_LAST		= M_DT,
+
+	/* Matches that are fixed for the lifetime of the context, these
+	 * are evaluated once in quirks_index_build() */
+	M_SYSTEM	= M_DMI|M_DT,
 };
 
 enum bustype {
@@ -96,6 +104,8 @@ enum bustype {
 	BT_PS2,
 	BT_RMI,
 	BT_I2C,
+
+	BT_LAST = BT_I2C,
 };
 
 enum udev_type {
@@ -135,6 +145,7 @@ struct match {
  */
 struct section {
 	struct list link;
+	size_t position;	/* in ctx->sections, defines the match order */
 
 	bool has_match;		/* to check for empty sections */
 	bool has_property;	/* to check for empty sections */
@@ -144,21 +155,58 @@ struct section {
 	struct list properties;
 };
 
+#define NMODEL_QUIRKS (_QUIRK_LAST_MODEL_QUIRK_ - QUIRK_MODEL_ALPS_TOUCHPAD)
+#define NATTR_QUIRKS (_QUIRK_LAST_ATTR_QUIRK_ - QUIRK_ATTR_SIZE_HINT)
+
 /**
  * The struct returned to the caller. It contains the
  * properties for a given device.
  */
 struct quirks {
 	size_t refcount;
-	struct list link; /* struct quirks_context.quirks */
+	struct quirks_context *ctx;
 
-	/* These are not ref'd, just a collection of pointers */
-	struct property **properties;
+	/* These are not ref'd, just pointers into the context's sections.
+	 * Indexed by quirk_index(), the last section applied wins. */
+	struct property *properties[NMODEL_QUIRKS + NATTR_QUIRKS];
 	size_t nproperties;
 };
 
+struct section_list {
+	struct section **sections;
+	size_t nsections;
+};
+
+/**
+ * The sections that can apply to a device on this system, i.e. all
+ * sections whose MatchDMIModalias and MatchDeviceTree match. Sorted by
+ * what we can cheaply look up for a device so we only need to look at
+ * the candidates.
+ */
+struct quirks_index {
+	size_t nsections;		/* total number of sections indexed */
+
+	struct section_list generic;	/* no MatchBus or MatchVendor */
+	struct section_list bus[BT_LAST + 1]; /* MatchBus but no MatchVendor */
+	struct section_list vendor;	/* MatchVendor, sorted by vendor */
+};
+
+/**
+ * A file the sections were parsed from, used to check whether a compiled
+ * cache is still up-to-date.
+ */
+struct quirks_source {
+	char *path;
+	bool exists;
+	struct stat st;
+};
+
 /**
- * Quirk matching context, initialized once with quirks_init_subsystem()
+ * Quirk matching context, initialized once with quirks_init_subsystem().
+ *
+ * Once initialized, the context is immutable and may be shared between
+ * threads, the refcount and the quirks counter are only ever modified
+ * atomically.
  */
 struct quirks_context {
 	size_t refcount;
@@ -171,9 +219,18 @@ struct quirks_context {
 	char *dt;
 
 	struct list sections;
-
-	/* list of quirks handed to libinput, just for bookkeeping */
-	struct list quirks;
+	struct quirks_index index;
+
+	/* number of quirks handed to the caller, just for bookkeeping */
+	size_t nquirks;
+
+	/* The files parsed, or the files the cache was up-to-date with
+	 * if we loaded the sections from the cache */
+	struct quirks_source *sources;
+	size_t nsources;
+	uint64_t hash;		/* of the files' contents, unless cached */
+	bool from_cache;
+	struct quirks_source cache; /* the compiled cache file */
 };
 
 LIBINPUT_ATTRIBUTE_PRINTF(3, 0)
@@ -196,6 +253,9 @@ quirk_log_msg_va(struct quirks_context *ctx,
 	case QLOG_DEBUG: /* These map straight to libinput priorities */
 	case QLOG_INFO:
 	case QLOG_ERROR:
+		/* libinput logging is only available during init */
+		if (ctx->log_type == QLOG_LIBINPUT_LOGGING && !ctx->libinput)
+			return;
 		break;
 	}
 
@@ -267,6 +327,22 @@ quirk_get_name(enum quirk q)
 	}
 }
 
+/**
+ * @return the index of this quirk in struct quirks.properties or -1 if
+ * the quirk is invalid
+ */
+static inline int
+quirk_index(uint32_t q)
+{
+	if (q >= QUIRK_MODEL_ALPS_TOUCHPAD && q < _QUIRK_LAST_MODEL_QUIRK_)
+		return q - QUIRK_MODEL_ALPS_TOUCHPAD;
+
+	if (q >= QUIRK_ATTR_SIZE_HINT && q < _QUIRK_LAST_ATTR_QUIRK_)
+		return NMODEL_QUIRKS + q - QUIRK_ATTR_SIZE_HINT;
+
+	return -1;
+}
+
 static inline const char *
 matchflagname(enum match_flags f)
 {
@@ -295,14 +371,6 @@ property_new(void)
 	return p;
 }
 
-static inline struct property *
-property_ref(struct property *p)
-{
-	assert(p->refcount > 0);
-	p->refcount++;
-	return p;
-};
-
 static inline struct property *
 property_unref(struct property *p)
 {
@@ -762,6 +830,53 @@ out:
 	return rc;
 }
 
+#define QUIRKS_HASH_INIT 0xcbf29ce484222325ULL
+
+/* FNV-1a, good enough to notice a changed file */
+static inline uint64_t
+quirks_hash(uint64_t hash, const void *data, size_t len)
+{
+	const unsigned char *c = data;
+
+	for (size_t i = 0; i < len; i++) {
+		hash ^= c[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+static inline struct quirks_source *
+quirks_new_source(struct quirks_context *ctx, const char *path)
+{
+	struct quirks_source *src;
+	void *tmp;
+
+	tmp = realloc(ctx->sources, (ctx->nsources + 1) * sizeof(*src));
+	if (!tmp)
+		abort();
+
+	ctx->sources = tmp;
+	src = &ctx->sources[ctx->nsources++];
+	memset(src, 0, sizeof(*src));
+	src->path = safe_strdup(path);
+
+	return src;
+}
+
+static inline void
+quirks_add_source(struct quirks_context *ctx, const char *path, FILE *fp)
+{
+	struct quirks_source *src = quirks_new_source(ctx, path);
+
+	src->exists = fp && fstat(fileno(fp), &src->st) == 0;
+
+	/* A missing file doesn't contribute to the hash, the path of
+	 * existing ones does so we notice renamed files */
+	if (src->exists)
+		ctx->hash = quirks_hash(ctx->hash, path, strlen(path) + 1);
+}
+
 static inline bool
 parse_file(struct quirks_context *ctx, const char *path)
 {
@@ -790,16 +905,21 @@ parse_file(struct quirks_context *ctx, const char *path)
 		 * happen is for the custom override file, all others are
 		 * provided by scandir so they do exist. Short of races we
 		 * don't care about. */
-		if (errno == ENOENT)
+		if (errno == ENOENT) {
+			quirks_add_source(ctx, path, NULL);
 			return true;
+		}
 
 		qlog_error(ctx, "%s: failed to open file\n", path);
 		goto out;
 	}
 
+	quirks_add_source(ctx, path, fp);
+
 	while (fgets(line, sizeof(line), fp)) {
 		char *comment;
 
+		ctx->hash = quirks_hash(ctx->hash, line, strlen(line));
 		lineno++;
 
 		comment = strstr(line, "#");
@@ -978,12 +1098,801 @@ parse_files(struct quirks_context *ctx, const char *data_path)
 	return idx == ndev;
 }
 
-struct quirks_context *
-quirks_init_subsystem(const char *data_path,
-		      const char *override_file,
-		      libinput_log_handler log_handler,
-		      struct libinput *libinput,
-		      enum quirks_log_type log_type)
+static inline bool
+quirks_source_matches(const struct quirks_source *src, const char *path)
+{
+	struct stat st;
+	bool exists = stat(path, &st) == 0;
+
+	if (!exists || !src->exists)
+		return exists == src->exists;
+
+	return src->st.st_mtim.tv_sec == st.st_mtim.tv_sec &&
+	       src->st.st_mtim.tv_nsec == st.st_mtim.tv_nsec &&
+	       src->st.st_size == st.st_size;
+}
+
+/**
+ * Record the files in data_path and the override file as the context's
+ * sources, for a context loaded from the cache.
+ */
+static void
+quirks_add_sources(struct quirks_context *ctx,
+		   const char *data_path,
+		   const char *override_file)
+{
+	struct quirks_source *src;
+	struct dirent **namelist;
+	int ndev;
+
+	ndev = scandir(data_path, &namelist, is_data_file, versionsort);
+	for (int idx = 0; idx < ndev; idx++) {
+		char path[PATH_MAX];
+
+		snprintf(path, sizeof(path), "%s/%s",
+			 data_path, namelist[idx]->d_name);
+		src = quirks_new_source(ctx, path);
+		src->exists = stat(path, &src->st) == 0;
+		free(namelist[idx]);
+	}
+	if (ndev >= 0)
+		free(namelist);
+
+	if (override_file) {
+		src = quirks_new_source(ctx, override_file);
+		src->exists = stat(override_file, &src->st) == 0;
+	}
+}
+
+/* The compiled cache is a snapshot of the sections parsed from the data
+ * files, written by libinput list-quirks --update-cache into the data
+ * directory. It is only used if it was written by the same version of
+ * libinput from the same files, otherwise we parse the text files.
+ *
+ * The file is in host byte order: a header, the stamps of the source files,
+ * the sections, their properties and a string table. Strings are offsets
+ * into the string table, offset 0 is the empty string.
+ */
+#define QUIRKS_CACHE_FILE "quirks.cache"
+#define QUIRKS_CACHE_MAGIC "LIQUIRKS"
+#define QUIRKS_CACHE_FORMAT 1
+
+struct cache_stamp {
+	int64_t mtime_sec;
+	int64_t mtime_nsec;
+	uint64_t size;
+	uint32_t path;		/* string offset */
+	uint32_t exists;
+};
+
+struct cache_header {
+	char magic[8];
+	uint32_t format;
+	uint32_t version;	/* string offset, the libinput version */
+	uint64_t size;		/* of the whole file */
+	uint64_t hash;		/* of the source files' contents */
+
+	uint32_t data_path;	/* string offset */
+	uint32_t override_file;	/* string offset, 0 for none */
+
+	uint32_t nstamps;
+	uint32_t stamps_offset;
+	uint32_t nsections;
+	uint32_t sections_offset;
+	uint32_t nproperties;
+	uint32_t properties_offset;
+	uint32_t strings_size;
+	uint32_t strings_offset;
+};
+
+struct cache_section {
+	uint32_t name;		/* string offset */
+	uint32_t match_bits;
+	uint32_t match_name;	/* string offset */
+	uint32_t match_bus;
+	uint32_t match_vendor;
+	uint32_t match_product;
+	uint32_t match_dmi;	/* string offset */
+	uint32_t match_udev_type;
+	uint32_t match_dt;	/* string offset */
+	uint32_t first_property;
+	uint32_t nproperties;
+	uint32_t padding;
+};
+
+struct cache_property {
+	uint32_t id;
+	uint32_t type;
+	/* u, i, b, string offset, dim.x or range.lower */
+	uint32_t value1;
+	/* dim.y or range.upper */
+	uint32_t value2;
+};
+
+struct cache_buf {
+	char *data;
+	size_t len;
+	size_t size;
+};
+
+static size_t
+cache_buf_append(struct cache_buf *buf, const void *data, size_t len)
+{
+	size_t offset = buf->len;
+
+	if (buf->len + len > buf->size) {
+		size_t size = max(buf->size * 2, buf->len + len + 4096);
+		char *tmp = realloc(buf->data, size);
+
+		if (!tmp)
+			abort();
+		buf->data = tmp;
+		buf->size = size;
+	}
+
+	memcpy(buf->data + buf->len, data, len);
+	buf->len += len;
+
+	return offset;
+}
+
+static inline uint32_t
+cache_buf_add_string(struct cache_buf *strings, const char *str)
+{
+	if (!str || str[0] == '\0')
+		return 0;
+
+	return cache_buf_append(strings, str, strlen(str) + 1);
+}
+
+static inline void
+cache_stamp_from_stat(struct cache_stamp *stamp,
+		      const struct stat *st,
+		      bool exists)
+{
+	stamp->exists = exists;
+	if (!exists)
+		return;
+
+	stamp->mtime_sec = st->st_mtim.tv_sec;
+	stamp->mtime_nsec = st->st_mtim.tv_nsec;
+	stamp->size = st->st_size;
+}
+
+static inline bool
+cache_stamp_matches(const struct cache_stamp *stamp, const char *path)
+{
+	struct stat st;
+	bool exists = stat(path, &st) == 0;
+
+	if (!exists || !stamp->exists)
+		return exists == (bool)stamp->exists;
+
+	return stamp->mtime_sec == st.st_mtim.tv_sec &&
+	       stamp->mtime_nsec == st.st_mtim.tv_nsec &&
+	       stamp->size == (uint64_t)st.st_size;
+}
+
+/**
+ * Serialize the context's sections into a cache file image. The context
+ * must have been parsed from the text files.
+ */
+static bool
+quirks_cache_serialize(struct quirks_context *ctx,
+		       const char *data_path,
+		       const char *override_file,
+		       struct cache_buf *out)
+{
+	struct cache_header header = {0};
+	struct cache_buf stamps = {0},
+			 sections = {0},
+			 properties = {0},
+			 strings = {0};
+	struct section *s;
+	bool rc = false;
+
+	assert(!ctx->from_cache);
+
+	cache_buf_append(&strings, "", 1);
+
+	memcpy(header.magic, QUIRKS_CACHE_MAGIC, sizeof(header.magic));
+	header.format = QUIRKS_CACHE_FORMAT;
+	header.version = cache_buf_add_string(&strings, LIBINPUT_VERSION);
+	header.hash = ctx->hash;
+	header.data_path = cache_buf_add_string(&strings, data_path);
+	header.override_file = cache_buf_add_string(&strings, override_file);
+
+	for (size_t i = 0; i < ctx->nsources; i++) {
+		struct quirks_source *src = &ctx->sources[i];
+		struct cache_stamp stamp = {0};
+
+		stamp.path = cache_buf_add_string(&strings, src->path);
+		cache_stamp_from_stat(&stamp, &src->st, src->exists);
+		cache_buf_append(&stamps, &stamp, sizeof(stamp));
+		header.nstamps++;
+	}
+
+	list_for_each(s, &ctx->sections, link) {
+		struct cache_section cs = {0};
+		struct property *p;
+
+		cs.name = cache_buf_add_string(&strings, s->name);
+		cs.match_bits = s->match.bits;
+		cs.match_name = cache_buf_add_string(&strings, s->match.name);
+		cs.match_bus = s->match.bus;
+		cs.match_vendor = s->match.vendor;
+		cs.match_product = s->match.product;
+		cs.match_dmi = cache_buf_add_string(&strings, s->match.dmi);
+		cs.match_udev_type = s->match.udev_type;
+		cs.match_dt = cache_buf_add_string(&strings, s->match.dt);
+		cs.first_property = header.nproperties;
+
+		list_for_each(p, &s->properties, link) {
+			struct cache_property cp = {0};
+
+			cp.id = p->id;
+			cp.type = p->type;
+			switch (p->type) {
+			case PT_UINT:
+				cp.value1 = p->value.u;
+				break;
+			case PT_INT:
+				cp.value1 = p->value.i;
+				break;
+			case PT_BOOL:
+				cp.value1 = p->value.b;
+				break;
+			case PT_STRING:
+				cp.value1 = cache_buf_add_string(&strings,
+								 p->value.s);
+				break;
+			case PT_DIMENSION:
+				if (p->value.dim.x > UINT32_MAX ||
+				    p->value.dim.y > UINT32_MAX)
+					goto out;
+				cp.value1 = p->value.dim.x;
+				cp.value2 = p->value.dim.y;
+				break;
+			case PT_RANGE:
+				cp.value1 = p->value.range.lower;
+				cp.value2 = p->value.range.upper;
+				break;
+			}
+
+			cache_buf_append(&properties, &cp, sizeof(cp));
+			cs.nproperties++;
+			header.nproperties++;
+		}
+
+		cache_buf_append(&sections, &cs, sizeof(cs));
+		header.nsections++;
+	}
+
+	/* All records are multiples of 8 bytes, so the offsets are aligned */
+	header.stamps_offset = sizeof(header);
+	header.sections_offset = header.stamps_offset + stamps.len;
+	header.properties_offset = header.sections_offset + sections.len;
+	header.strings_offset = header.properties_offset + properties.len;
+	header.strings_size = strings.len;
+	header.size = (uint64_t)header.strings_offset + strings.len;
+	if (header.size > UINT32_MAX)
+		goto out;
+
+	cache_buf_append(out, &header, sizeof(header));
+	cache_buf_append(out, stamps.data, stamps.len);
+	cache_buf_append(out, sections.data, sections.len);
+	cache_buf_append(out, properties.data, properties.len);
+	cache_buf_append(out, strings.data, strings.len);
+
+	rc = true;
+out:
+	free(stamps.data);
+	free(sections.data);
+	free(properties.data);
+	free(strings.data);
+
+	return rc;
+}
+
+static inline bool
+cache_region_valid(const struct cache_header *header,
+		   uint32_t offset,
+		   uint32_t nmemb,
+		   size_t size)
+{
+	return offset % 8 == 0 &&
+	       (uint64_t)offset + (uint64_t)nmemb * size <= header->size;
+}
+
+static inline const char *
+cache_string(const struct cache_header *header, uint32_t offset)
+{
+	if (offset >= header->strings_size)
+		return NULL;
+
+	return (const char*)header + header->strings_offset + offset;
+}
+
+static inline bool
+cache_header_valid(const struct cache_header *header, size_t size)
+{
+	const char *strings;
+
+	if (size < sizeof(*header) ||
+	    memcmp(header->magic, QUIRKS_CACHE_MAGIC, sizeof(header->magic)) != 0 ||
+	    header->format != QUIRKS_CACHE_FORMAT ||
+	    header->size != size)
+		return false;
+
+	if (!cache_region_valid(header, header->stamps_offset,
+				header->nstamps, sizeof(struct cache_stamp)) ||
+	    !cache_region_valid(header, header->sections_offset,
+				header->nsections, sizeof(struct cache_section)) ||
+	    !cache_region_valid(header, header->properties_offset,
+				header->nproperties, sizeof(struct cache_property)) ||
+	    header->strings_size == 0 ||
+	    (uint64_t)header->strings_offset + header->strings_size > size)
+		return false;
+
+	/* The string table is terminated so no string can run past it */
+	strings = (const char*)header + header->strings_offset;
+	return strings[header->strings_size - 1] == '\0';
+}
+
+/* Hash the files in the data directory the same way the parser does */
+static bool
+quirks_hash_files(const char *data_path,
+		  const char *override_file,
+		  uint64_t *hash_out)
+{
+	struct dirent **namelist;
+	uint64_t hash = QUIRKS_HASH_INIT;
+	int ndev;
+	bool rc = true;
+
+	ndev = scandir(data_path, &namelist, is_data_file, versionsort);
+	if (ndev <= 0)
+		return false;
+
+	for (int idx = 0; idx <= ndev && rc; idx++) {
+		char path[PATH_MAX];
+		char buf[4096];
+		size_t len;
+		FILE *fp;
+
+		if (idx < ndev) {
+			snprintf(path, sizeof(path), "%s/%s",
+				 data_path, namelist[idx]->d_name);
+		} else if (override_file) {
+			snprintf(path, sizeof(path), "%s", override_file);
+		} else {
+			break;
+		}
+
+		fp = fopen(path, "r");
+		if (!fp) {
+			rc = (errno == ENOENT && idx == ndev);
+			continue;
+		}
+
+		hash = quirks_hash(hash, path, strlen(path) + 1);
+		while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+			hash = quirks_hash(hash, buf, len);
+		fclose(fp);
+	}
+
+	for (int i = 0; i < ndev; i++)
+		free(namelist[i]);
+	free(namelist);
+
+	*hash_out = hash;
+
+	return rc;
+}
+
+static inline bool
+cache_strings_match(const struct cache_header *header,
+		    uint32_t offset,
+		    const char *str)
+{
+	const char *cached = cache_string(header, offset);
+
+	return cached && streq(cached, str ? str : "");
+}
+
+static bool
+quirks_cache_stamps_match(const char *data_path,
+			  const char *override_file,
+			  const struct cache_header *header,
+			  const struct cache_stamp *stamps)
+{
+	struct dirent **namelist;
+	uint32_t nstamps = header->nstamps;
+	bool rc = false;
+	int ndev;
+
+	if (override_file) {
+		const char *path;
+
+		if (nstamps == 0)
+			return false;
+
+		nstamps--;
+		path = cache_string(header, stamps[nstamps].path);
+		if (!path ||
+		    !streq(path, override_file) ||
+		    !cache_stamp_matches(&stamps[nstamps], path))
+			return false;
+	}
+
+	ndev = scandir(data_path, &namelist, is_data_file, versionsort);
+	if (ndev <= 0)
+		return false;
+
+	if ((uint32_t)ndev != nstamps)
+		goto out;
+
+	for (int idx = 0; idx < ndev; idx++) {
+		char path[PATH_MAX];
+		const char *cached = cache_string(header, stamps[idx].path);
+
+		snprintf(path, sizeof(path), "%s/%s",
+			 data_path, namelist[idx]->d_name);
+		if (!cached ||
+		    !streq(path, cached) ||
+		    !cache_stamp_matches(&stamps[idx], path))
+			goto out;
+	}
+
+	rc = true;
+out:
+	for (int i = 0; i < ndev; i++)
+		free(namelist[i]);
+	free(namelist);
+
+	return rc;
+}
+
+static bool
+quirks_cache_up_to_date(struct quirks_context *ctx,
+			const struct cache_header *header,
+			const char *data_path,
+			const char *override_file)
+{
+	const struct cache_stamp *stamps;
+	uint64_t hash;
+
+	if (!cache_strings_match(header, header->version, LIBINPUT_VERSION) ||
+	    !cache_strings_match(header, header->data_path, data_path) ||
+	    !cache_strings_match(header, header->override_file, override_file))
+		return false;
+
+	/* If the same files are there and none has changed we're good,
+	 * otherwise the files may have just been touched, so compare the
+	 * contents */
+	stamps = (const struct cache_stamp*)((const char*)header +
+					     header->stamps_offset);
+	if (quirks_cache_stamps_match(data_path,
+				      override_file,
+				      header,
+				      stamps))
+		return true;
+
+	quirk_log_msg(ctx, QLOG_DEBUG,
+		      "%s: quirks cache timestamps outdated, comparing contents\n",
+		      data_path);
+
+	return quirks_hash_files(data_path, override_file, &hash) &&
+	       hash == header->hash;
+}
+
+static inline bool
+quirk_is_valid(uint32_t id)
+{
+	return quirk_index(id) >= 0;
+}
+
+static bool
+quirks_cache_decode_section(struct quirks_context *ctx,
+			    const struct cache_header *header,
+			    const struct cache_section *cs)
+{
+	const struct cache_property *properties;
+	struct section *s;
+	const char *name;
+	const uint32_t match_mask = M_LAST | (M_LAST - 1);
+	const uint32_t udev_type_mask = UDEV_MOUSE | UDEV_POINTINGSTICK |
+					UDEV_TOUCHPAD | UDEV_TABLET |
+					UDEV_TABLET_PAD | UDEV_JOYSTICK |
+					UDEV_KEYBOARD;
+
+	/* The bus is used as an index in quirks_index_build() and
+	 * everything else is taken as-is, so reject anything the parser
+	 * could never have produced */
+	name = cache_string(header, cs->name);
+	if (!name ||
+	    cs->nproperties == 0 ||
+	    (uint64_t)cs->first_property + cs->nproperties > header->nproperties ||
+	    (cs->match_bits & ~match_mask) != 0 ||
+	    cs->match_bus > BT_LAST ||
+	    (cs->match_udev_type & ~udev_type_mask) != 0)
+		return false;
+
+	s = zalloc(sizeof(*s));
+	s->name = safe_strdup(name);
+	list_init(&s->properties);
+	list_append(&ctx->sections, &s->link);
+
+	s->has_match = true;
+	s->has_property = true;
+	s->match.bits = cs->match_bits;
+	s->match.bus = cs->match_bus;
+	s->match.vendor = cs->match_vendor;
+	s->match.product = cs->match_product;
+	s->match.udev_type = cs->match_udev_type;
+
+	if (cs->match_bits & M_NAME) {
+		s->match.name = safe_strdup(cache_string(header, cs->match_name));
+		if (!s->match.name)
+			return false;
+	}
+	if (cs->match_bits & M_DMI) {
+		s->match.dmi = safe_strdup(cache_string(header, cs->match_dmi));
+		if (!s->match.dmi)
+			return false;
+	}
+	if (cs->match_bits & M_DT) {
+		s->match.dt = safe_strdup(cache_string(header, cs->match_dt));
+		if (!s->match.dt)
+			return false;
+	}
+
+	properties = (const struct cache_property*)((const char*)header +
+						    header->properties_offset);
+	for (uint32_t i = 0; i < cs->nproperties; i++) {
+		const struct cache_property *cp = &properties[cs->first_property + i];
+		struct property *p;
+
+		if (!quirk_is_valid(cp->id) || cp->type > PT_RANGE)
+			return false;
+
+		p = property_new();
+		p->id = cp->id;
+		p->type = cp->type;
+		list_append(&s->properties, &p->link);
+
+		switch (p->type) {
+		case PT_UINT:
+			p->value.u = cp->value1;
+			break;
+		case PT_INT:
+			p->value.i = (int32_t)cp->value1;
+			break;
+		case PT_BOOL:
+			p->value.b = cp->value1 != 0;
+			break;
+		case PT_STRING:
+			p->value.s = safe_strdup(cache_string(header, cp->value1));
+			if (!p->value.s)
+				return false;
+			break;
+		case PT_DIMENSION:
+			p->value.dim.x = cp->value1;
+			p->value.dim.y = cp->value2;
+			break;
+		case PT_RANGE:
+			p->value.range.lower = (int32_t)cp->value1;
+			p->value.range.upper = (int32_t)cp->value2;
+			break;
+		default:
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Load the sections from the compiled cache in the data directory.
+ *
+ * @return true if the cache is up-to-date and was loaded, false if the
+ * text files need to be parsed.
+ */
+static bool
+quirks_cache_load(struct quirks_context *ctx,
+		  const char *data_path,
+		  const char *override_file)
+{
+	char path[PATH_MAX];
+	const struct cache_header *header;
+	const struct cache_section *sections;
+	struct section *s, *tmp;
+	struct stat st;
+	void *map = MAP_FAILED;
+	bool rc = false;
+	int fd;
+
+	snprintf(path, sizeof(path), "%s/%s", data_path, QUIRKS_CACHE_FILE);
+
+	fd = open(path, O_RDONLY|O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(*header))
+		goto out;
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		goto out;
+
+	header = map;
+	if (!cache_header_valid(header, st.st_size)) {
+		quirk_log_msg(ctx, QLOG_ERROR,
+			      "%s: invalid quirks cache, ignoring\n",
+			      path);
+		goto out;
+	}
+
+	if (!quirks_cache_up_to_date(ctx, header, data_path, override_file)) {
+		quirk_log_msg(ctx, QLOG_DEBUG,
+			      "%s: quirks cache is outdated, ignoring\n",
+			      path);
+		goto out;
+	}
+
+	sections = (const struct cache_section*)((const char*)map +
+						 header->sections_offset);
+	for (uint32_t i = 0; i < header->nsections; i++) {
+		if (!quirks_cache_decode_section(ctx, header, &sections[i])) {
+			quirk_log_msg(ctx, QLOG_ERROR,
+				      "%s: invalid quirks cache, ignoring\n",
+				      path);
+			list_for_each_safe(s, tmp, &ctx->sections, link)
+				section_destroy(s);
+			goto out;
+		}
+	}
+
+	quirk_log_msg(ctx, QLOG_DEBUG,
+		      "%s: loaded %u sections from the quirks cache\n",
+		      path,
+		      header->nsections);
+	ctx->from_cache = true;
+	rc = true;
+out:
+	if (map != MAP_FAILED)
+		munmap(map, st.st_size);
+	close(fd);
+
+	return rc;
+}
+
+static void
+section_list_append(struct section_list *list, struct section *s)
+{
+	struct section **sections;
+
+	sections = realloc(list->sections,
+			   (list->nsections + 1) * sizeof(*sections));
+	if (!sections)
+		abort();
+
+	sections[list->nsections++] = s;
+	list->sections = sections;
+}
+
+static int
+section_cmp_position(const void *a, const void *b)
+{
+	const struct section *sa = *(const struct section * const *)a;
+	const struct section *sb = *(const struct section * const *)b;
+
+	return (sa->position > sb->position) - (sa->position < sb->position);
+}
+
+static int
+section_cmp_vendor(const void *a, const void *b)
+{
+	const struct section *sa = *(const struct section * const *)a;
+	const struct section *sb = *(const struct section * const *)b;
+
+	if (sa->match.vendor != sb->match.vendor)
+		return sa->match.vendor < sb->match.vendor ? -1 : 1;
+
+	return section_cmp_position(a, b);
+}
+
+/**
+ * The DMI modalias and the device tree compatible string don't change
+ * while we're running, so we only need to match those once.
+ *
+ * @return true if the section may apply to devices on this system
+ */
+static bool
+section_matches_system(struct quirks_context *ctx, struct section *s)
+{
+	if (s->match.bits & M_DMI) {
+		if (!ctx->dmi) {
+			qlog_debug(ctx, "%s wants %s but we don't have that\n",
+				   s->name, matchflagname(M_DMI));
+			return false;
+		}
+
+		if (fnmatch(s->match.dmi, ctx->dmi, 0) != 0)
+			return false;
+
+		qlog_debug(ctx, "%s matches for %s\n",
+			   s->name, matchflagname(M_DMI));
+	}
+
+	if (s->match.bits & M_DT) {
+		if (!ctx->dt) {
+			qlog_debug(ctx, "%s wants %s but we don't have that\n",
+				   s->name, matchflagname(M_DT));
+			return false;
+		}
+
+		if (fnmatch(s->match.dt, ctx->dt, 0) != 0)
+			return false;
+
+		qlog_debug(ctx, "%s matches for %s\n",
+			   s->name, matchflagname(M_DT));
+	}
+
+	return true;
+}
+
+static void
+quirks_index_build(struct quirks_context *ctx)
+{
+	struct quirks_index *index = &ctx->index;
+	struct section *s;
+	size_t position = 0;
+
+	list_for_each(s, &ctx->sections, link) {
+		s->position = position++;
+
+		if (!section_matches_system(ctx, s))
+			continue;
+
+		if (s->match.bits & M_VID)
+			section_list_append(&index->vendor, s);
+		else if (s->match.bits & M_BUS)
+			section_list_append(&index->bus[s->match.bus], s);
+		else
+			section_list_append(&index->generic, s);
+
+		index->nsections++;
+	}
+
+	if (index->vendor.nsections > 0)
+		qsort(index->vendor.sections,
+		      index->vendor.nsections,
+		      sizeof(*index->vendor.sections),
+		      section_cmp_vendor);
+
+	qlog_debug(ctx, "%zu of %zu sections apply to this system\n",
+		   index->nsections, position);
+}
+
+static void
+quirks_index_destroy(struct quirks_context *ctx)
+{
+	struct quirks_index *index = &ctx->index;
+
+	free(index->generic.sections);
+	for (size_t i = 0; i < ARRAY_LENGTH(index->bus); i++)
+		free(index->bus[i].sections);
+	free(index->vendor.sections);
+}
+
+static struct quirks_context *
+quirks_context_new(const char *data_path,
+		   const char *override_file,
+		   libinput_log_handler log_handler,
+		   struct libinput *libinput,
+		   enum quirks_log_type log_type,
+		   bool use_cache)
 {
 	struct quirks_context *ctx = zalloc(sizeof *ctx);
 
@@ -991,7 +1900,7 @@ quirks_init_subsystem(const char *data_path,
 	ctx->log_handler = log_handler;
 	ctx->log_type = log_type;
 	ctx->libinput = libinput;
-	list_init(&ctx->quirks);
+	ctx->hash = QUIRKS_HASH_INIT;
 	list_init(&ctx->sections);
 
 	qlog_debug(ctx, "%s is data root\n", data_path);
@@ -1001,12 +1910,33 @@ quirks_init_subsystem(const char *data_path,
 	if (!ctx->dmi && !ctx->dt)
 		goto error;
 
+	if (use_cache) {
+		char path[PATH_MAX];
+
+		snprintf(path, sizeof(path), "%s/%s",
+			 data_path, QUIRKS_CACHE_FILE);
+		ctx->cache.exists = stat(path, &ctx->cache.st) == 0;
+
+		if (quirks_cache_load(ctx, data_path, override_file)) {
+			quirks_add_sources(ctx, data_path, override_file);
+			goto out;
+		}
+	}
+
 	if (!parse_files(ctx, data_path))
 		goto error;
 
 	if (override_file && !parse_file(ctx, override_file))
 		goto error;
 
+out:
+	quirks_index_build(ctx);
+
+	/* The context may be shared with and outlive the libinput context
+	 * that created it, don't hang on to it */
+	if (log_type == QLOG_LIBINPUT_LOGGING)
+		ctx->libinput = NULL;
+
 	return ctx;
 
 error:
@@ -1014,11 +1944,199 @@ error:
 	return NULL;
 }
 
+struct quirks_context *
+quirks_init_subsystem(const char *data_path,
+		      const char *override_file,
+		      libinput_log_handler log_handler,
+		      struct libinput *libinput,
+		      enum quirks_log_type log_type)
+{
+	return quirks_context_new(data_path,
+				  override_file,
+				  log_handler,
+				  libinput,
+				  log_type,
+				  true);
+}
+
+bool
+quirks_context_is_cached(struct quirks_context *ctx)
+{
+	return ctx->from_cache;
+}
+
+bool
+quirks_context_up_to_date(struct quirks_context *ctx,
+			  const char *data_path,
+			  const char *override_file)
+{
+	char path[PATH_MAX];
+	struct dirent **namelist;
+	size_t nsources = ctx->nsources;
+	bool rc = false;
+	int ndev;
+
+	snprintf(path, sizeof(path), "%s/%s", data_path, QUIRKS_CACHE_FILE);
+	if (!quirks_source_matches(&ctx->cache, path))
+		return false;
+
+	/* the override file is the last source */
+	if (override_file) {
+		const struct quirks_source *src;
+
+		if (nsources == 0)
+			return false;
+
+		src = &ctx->sources[--nsources];
+		if (!streq(src->path, override_file) ||
+		    !quirks_source_matches(src, override_file))
+			return false;
+	}
+
+	ndev = scandir(data_path, &namelist, is_data_file, versionsort);
+	if (ndev <= 0)
+		return false;
+
+	if ((size_t)ndev != nsources)
+		goto out;
+
+	for (int idx = 0; idx < ndev; idx++) {
+		snprintf(path, sizeof(path), "%s/%s",
+			 data_path, namelist[idx]->d_name);
+		if (!streq(ctx->sources[idx].path, path) ||
+		    !quirks_source_matches(&ctx->sources[idx], path))
+			goto out;
+	}
+
+	rc = true;
+out:
+	for (int i = 0; i < ndev; i++)
+		free(namelist[i]);
+	free(namelist);
+
+	return rc;
+}
+
+bool
+quirks_cache_update(const char *data_path,
+		    const char *override_file,
+		    libinput_log_handler log_handler,
+		    enum quirks_log_type log_type)
+{
+	struct quirks_context *ctx;
+	struct cache_buf buf = {0};
+	char path[PATH_MAX];
+	char tmppath[PATH_MAX];
+	bool rc = false;
+	int fd = -1;
+
+	ctx = quirks_context_new(data_path,
+				 override_file,
+				 log_handler,
+				 NULL,
+				 log_type,
+				 false);
+	if (!ctx)
+		return false;
+
+	if (!quirks_cache_serialize(ctx, data_path, override_file, &buf)) {
+		qlog_error(ctx, "Failed to compile the quirks cache\n");
+		goto out;
+	}
+
+	snprintf(path, sizeof(path), "%s/%s", data_path, QUIRKS_CACHE_FILE);
+	snprintf(tmppath, sizeof(tmppath), "%s.XXXXXX", path);
+
+	/* Write to a temporary file and rename it so a concurrently
+	 * starting libinput never sees a partial cache */
+	fd = mkostemp(tmppath, O_CLOEXEC);
+	if (fd < 0) {
+		qlog_error(ctx, "%s: failed to create file (%s)\n",
+			   tmppath, strerror(errno));
+		goto out;
+	}
+
+	if (fchmod(fd, 0644) < 0 ||
+	    write(fd, buf.data, buf.len) != (ssize_t)buf.len ||
+	    fsync(fd) < 0 ||
+	    rename(tmppath, path) < 0) {
+		qlog_error(ctx, "%s: failed to write the quirks cache (%s)\n",
+			   path, strerror(errno));
+		unlink(tmppath);
+		goto out;
+	}
+
+	qlog_info(ctx, "%s: wrote the quirks cache\n", path);
+	rc = true;
+out:
+	if (fd >= 0)
+		close(fd);
+	free(buf.data);
+	quirks_context_unref(ctx);
+
+	return rc;
+}
+
+enum quirks_cache_status
+quirks_cache_verify(const char *data_path,
+		    const char *override_file,
+		    libinput_log_handler log_handler,
+		    enum quirks_log_type log_type)
+{
+	enum quirks_cache_status status = QUIRKS_CACHE_ERROR;
+	struct quirks_context *ctx;
+	struct cache_buf buf = {0};
+	char path[PATH_MAX];
+	struct stat st;
+	void *map = MAP_FAILED;
+	int fd = -1;
+
+	ctx = quirks_context_new(data_path,
+				 override_file,
+				 log_handler,
+				 NULL,
+				 log_type,
+				 false);
+	if (!ctx)
+		return QUIRKS_CACHE_ERROR;
+
+	if (!quirks_cache_serialize(ctx, data_path, override_file, &buf))
+		goto out;
+
+	snprintf(path, sizeof(path), "%s/%s", data_path, QUIRKS_CACHE_FILE);
+	fd = open(path, O_RDONLY|O_CLOEXEC);
+	if (fd < 0) {
+		status = QUIRKS_CACHE_MISSING;
+		goto out;
+	}
+
+	/* The serialization is deterministic, so an up-to-date cache is
+	 * identical to what we'd write now */
+	status = QUIRKS_CACHE_OUTDATED;
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size != buf.len)
+		goto out;
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map != MAP_FAILED && memcmp(map, buf.data, buf.len) == 0)
+		status = QUIRKS_CACHE_UP_TO_DATE;
+out:
+	if (map != MAP_FAILED)
+		munmap(map, st.st_size);
+	if (fd >= 0)
+		close(fd);
+	free(buf.data);
+	quirks_context_unref(ctx);
+
+	return status;
+}
+
 struct quirks_context *
 quirks_context_ref(struct quirks_context *ctx)
 {
-	assert(ctx->refcount > 0);
-	ctx->refcount++;
+	size_t refcount;
+
+	refcount = __atomic_fetch_add(&ctx->refcount, 1, __ATOMIC_RELAXED);
+	assert(refcount > 0);
 
 	return ctx;
 }
@@ -1027,38 +2145,47 @@ struct quirks_context *
 quirks_context_unref(struct quirks_context *ctx)
 {
 	struct section *s, *tmp;
+	size_t refcount;
 
 	if (!ctx)
 		return NULL;
 
-	assert(ctx->refcount >= 1);
-	ctx->refcount--;
+	refcount = __atomic_fetch_sub(&ctx->refcount, 1, __ATOMIC_ACQ_REL);
+	assert(refcount >= 1);
 
-	if (ctx->refcount > 0)
+	if (refcount > 1)
 		return NULL;
 
 	/* Caller needs to clean up before calling this */
-	assert(list_empty(&ctx->quirks));
+	assert(__atomic_load_n(&ctx->nquirks, __ATOMIC_ACQUIRE) == 0);
+
+	quirks_index_destroy(ctx);
 
 	list_for_each_safe(s, tmp, &ctx->sections, link) {
 		section_destroy(s);
 	}
 
+	for (size_t i = 0; i < ctx->nsources; i++)
+		free(ctx->sources[i].path);
+	free(ctx->sources);
+
 	free(ctx->dmi);
+	free(ctx->dt);
 	free(ctx);
 
 	return NULL;
 }
 
 static struct quirks *
-quirks_new(void)
+quirks_new(struct quirks_context *ctx)
 {
 	struct quirks *q;
 
 	q = zalloc(sizeof *q);
 	q->refcount = 1;
+	q->ctx = ctx;
 	q->nproperties = 0;
-	list_init(&q->link);
+	__atomic_fetch_add(&ctx->nquirks, 1, __ATOMIC_RELAXED);
 
 	return q;
 }
@@ -1066,8 +2193,6 @@ quirks_new(void)
 struct quirks *
 quirks_unref(struct quirks *q)
 {
-	struct property *p;
-
 	if (!q)
 		return NULL;
 
@@ -1075,13 +2200,7 @@ quirks_unref(struct quirks *q)
 	 * as well have the API in place */
 	assert(q->refcount == 1);
 
-	for (size_t i = 0; i < q->nproperties; i++) {
-		property_unref(q->properties[i]);
-		p++;
-	}
-
-	list_remove(&q->link);
-	free(q->properties);
+	__atomic_fetch_sub(&q->ctx->nquirks, 1, __ATOMIC_RELEASE);
 	free(q);
 
 	return NULL;
@@ -1191,29 +2310,14 @@ match_fill_udev_type(struct match *m,
 	m->bits |= M_UDEV_TYPE;
 }
 
-static inline void
-match_fill_dmi_dt(struct match *m, char *dmi, char *dt)
-{
-	if (dmi) {
-		m->dmi = dmi;
-		m->bits |= M_DMI;
-	}
-
-	if (dt) {
-		m->dt = dt;
-		m->bits |= M_DT;
-	}
-}
-
 static struct match *
-match_new(struct udev_device *device,
-	  char *dmi, char *dt)
+match_new(struct udev_device *device)
 {
 	struct match *m = zalloc(sizeof *m);
 
+	/* DMI and DT are matched in quirks_index_build() */
 	match_fill_name(m, device);
 	match_fill_bus_vid_pid(m, device);
-	match_fill_dmi_dt(m, dmi, dt);
 	match_fill_udev_type(m, device);
 	return m;
 }
@@ -1221,7 +2325,6 @@ match_new(struct udev_device *device,
 static void
 match_free(struct match *m)
 {
-	/* dmi and dt are global */
 	free(m->name);
 	free(m);
 }
@@ -1232,24 +2335,17 @@ quirk_apply_section(struct quirks_context *ctx,
 		    const struct section *s)
 {
 	struct property *p;
-	size_t nprops = 0;
-	void *tmp;
 
 	list_for_each(p, &s->properties, link) {
-		nprops++;
-	}
+		int idx = quirk_index(p->id);
 
-	nprops += q->nproperties;
-	tmp = realloc(q->properties, nprops * sizeof(p));
-	if (!tmp)
-		return;
+		assert(idx >= 0);
 
-	q->properties = tmp;
-	list_for_each(p, &s->properties, link) {
 		qlog_debug(ctx, "property added: %s from %s\n",
 			   quirk_get_name(p->id), s->name);
 
-		q->properties[q->nproperties++] = property_ref(p);
+		q->properties[idx] = p;
+		q->nproperties++;
 	}
 }
 
@@ -1260,12 +2356,13 @@ quirk_match_section(struct quirks_context *ctx,
 		    struct match *m,
 		    struct udev_device *device)
 {
-	uint32_t matched_flags = 0x0;
+	/* Only sections matching the system are in the index */
+	uint32_t matched_flags = s->match.bits & M_SYSTEM;
 
 	for (uint32_t flag = 0x1; flag <= M_LAST; flag <<= 1) {
 		uint32_t prev_matched_flags = matched_flags;
 		/* section doesn't have this bit set, continue */
-		if ((s->match.bits & flag) == 0)
+		if ((s->match.bits & flag) == 0 || (flag & M_SYSTEM))
 			continue;
 
 		/* Couldn't fill in this bit for the match, so we
@@ -1295,14 +2392,6 @@ quirk_match_section(struct quirks_context *ctx,
 			if (m->product == s->match.product)
 				matched_flags |= flag;
 			break;
-		case M_DMI:
-			if (fnmatch(s->match.dmi, m->dmi, 0) == 0)
-				matched_flags |= flag;
-			break;
-		case M_DT:
-			if (fnmatch(s->match.dt, m->dt, 0) == 0)
-				matched_flags |= flag;
-			break;
 		case M_UDEV_TYPE:
 			if (s->match.udev_type & m->udev_type)
 				matched_flags |= flag;
@@ -1327,12 +2416,85 @@ quirk_match_section(struct quirks_context *ctx,
 	return true;
 }
 
+static void
+section_list_append_all(struct section_list *dest,
+			const struct section_list *src)
+{
+	if (src->nsections == 0)
+		return;
+
+	memcpy(&dest->sections[dest->nsections],
+	       src->sections,
+	       src->nsections * sizeof(*src->sections));
+	dest->nsections += src->nsections;
+}
+
+/**
+ * Append the sections matching the given vendor to dest. This is just a
+ * binary search for the first section with that vendor in the sorted
+ * list.
+ */
+static void
+section_list_append_vendor(struct section_list *dest,
+			   const struct section_list *src,
+			   uint32_t vendor)
+{
+	size_t lo = 0,
+	       hi = src->nsections;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo)/2;
+
+		if (src->sections[mid]->match.vendor < vendor)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (size_t i = lo; i < src->nsections; i++) {
+		if (src->sections[i]->match.vendor != vendor)
+			break;
+		dest->sections[dest->nsections++] = src->sections[i];
+	}
+}
+
+/**
+ * Fill in the sections in the index that may match this device, in the
+ * order they appear in the quirks files.
+ */
+static void
+quirks_index_lookup(struct quirks_context *ctx,
+		    struct match *m,
+		    struct section_list *candidates)
+{
+	struct quirks_index *index = &ctx->index;
+
+	candidates->sections = zalloc((index->nsections + 1) *
+				      sizeof(*candidates->sections));
+	candidates->nsections = 0;
+
+	section_list_append_all(candidates, &index->generic);
+
+	if (m->bits & M_BUS)
+		section_list_append_all(candidates, &index->bus[m->bus]);
+
+	if (m->bits & M_VID)
+		section_list_append_vendor(candidates,
+					   &index->vendor,
+					   m->vendor);
+
+	qsort(candidates->sections,
+	      candidates->nsections,
+	      sizeof(*candidates->sections),
+	      section_cmp_position);
+}
+
 struct quirks *
 quirks_fetch_for_device(struct quirks_context *ctx,
 			struct udev_device *udev_device)
 {
 	struct quirks *q = NULL;
-	struct section *s;
+	struct section_list candidates;
 	struct match *m;
 
 	if (!ctx)
@@ -1341,14 +2503,20 @@ quirks_fetch_for_device(struct quirks_context *ctx,
 	qlog_debug(ctx, "%s: fetching quirks\n",
 		   udev_device_get_devnode(udev_device));
 
-	q = quirks_new();
+	q = quirks_new(ctx);
 
-	m = match_new(udev_device, ctx->dmi, ctx->dt);
+	m = match_new(udev_device);
 
-	list_for_each(s, &ctx->sections, link) {
-		quirk_match_section(ctx, q, s, m, udev_device);
+	quirks_index_lookup(ctx, m, &candidates);
+	for (size_t i = 0; i < candidates.nsections; i++) {
+		quirk_match_section(ctx,
+				    q,
+				    candidates.sections[i],
+				    m,
+				    udev_device);
 	}
 
+	free(candidates.sections);
 	match_free(m);
 
 	if (q->nproperties == 0) {
@@ -1356,8 +2524,6 @@ quirks_fetch_for_device(struct quirks_context *ctx,
 		return NULL;
 	}
 
-	list_insert(&ctx->quirks, &q->link);
-
 	return q;
 }
 
@@ -1365,14 +2531,12 @@ quirks_fetch_for_device(struct quirks_context *ctx,
 static inline struct property *
 quirk_find_prop(struct quirks *q, enum quirk which)
 {
-	/* Run backwards to only handle the last one assigned */
-	for (ssize_t i = q->nproperties - 1; i >= 0; i--) {
-		struct property *p = q->properties[i];
-		if (p->id == which)
-			return p;
-	}
+	int idx = quirk_index(which);
 
-	return NULL;
+	if (idx < 0)
+		return NULL;
+
+	return q->properties[idx];
 }
 
 bool
@@ -84,6 +84,7 @@ enum quirk {
 	QUIRK_MODEL_WACOM_TOUCHPAD,
 	QUIRK_MODEL_JUMPING_SEMI_MT,
 
+	_QUIRK_LAST_MODEL_QUIRK_, /* Guard: do not modify */
 
 	QUIRK_ATTR_SIZE_HINT = 300,
 	QUIRK_ATTR_TOUCH_SIZE_RANGE,
@@ -96,6 +97,8 @@ enum quirk {
 	QUIRK_ATTR_RESOLUTION_HINT,
 	QUIRK_ATTR_TRACKPOINT_RANGE,
 	QUIRK_ATTR_THUMB_PRESSURE_THRESHOLD,
+
+	_QUIRK_LAST_ATTR_QUIRK_, /* Guard: do not modify */
 };
 
 /**
@@ -137,6 +140,14 @@ enum quirks_log_type {
  * the custom QLOG_* log priorities. Otherwise, the log handler only uses
  * the libinput log priorities.
  *
+ * If data_path contains an up-to-date compiled cache (see
+ * quirks_cache_update()), the sections are loaded from the cache,
+ * otherwise the data files are parsed.
+ * The returned context is immutable and may be shared between libinput
+ * contexts and threads, see quirks_context_ref(). With
+ * QLOG_LIBINPUT_LOGGING, the libinput struct is only used for logging
+ * during this call.
+ *
  * @param data_path The directory containing the various data files
  * @param override_file A file path containing custom overrides
  * @param log_handler The libinput log handler called for debugging output
@@ -152,23 +163,80 @@ quirks_init_subsystem(const char *data_path,
 		      enum quirks_log_type log_type);
 
 /**
- * Clean up after ourselves. This function must be called
- * as the last call to the quirks subsystem.
+ * Returns true if the context's sections were loaded from the compiled
+ * cache rather than parsed from the data files.
+ */
+bool
+quirks_context_is_cached(struct quirks_context *ctx);
+
+/**
+ * Returns true if the files in data_path and the override file are the
+ * ones the context was created from and none of them has changed since.
+ * The compiled cache counts as one of the files, a context is outdated
+ * once the cache was rebuilt.
+ *
+ * data_path and override_file must be the ones the context was created
+ * with.
+ */
+bool
+quirks_context_up_to_date(struct quirks_context *ctx,
+			  const char *data_path,
+			  const char *override_file);
+
+/**
+ * Parse the data files and compile them into a cache in data_path, used
+ * by quirks_init_subsystem() for as long as the files don't change.
+ * The cache is only valid for the same data_path and override_file.
+ * @return true on success, false otherwise
+ */
+bool
+quirks_cache_update(const char *data_path,
+		    const char *override_file,
+		    libinput_log_handler log_handler,
+		    enum quirks_log_type log_type);
+
+enum quirks_cache_status {
+	QUIRKS_CACHE_UP_TO_DATE,
+	QUIRKS_CACHE_MISSING,
+	QUIRKS_CACHE_OUTDATED,
+	QUIRKS_CACHE_ERROR, /**< The data files failed to parse */
+};
+
+/**
+ * Parse the data files and compare the result against the compiled cache
+ * in data_path.
+ */
+enum quirks_cache_status
+quirks_cache_verify(const char *data_path,
+		    const char *override_file,
+		    libinput_log_handler log_handler,
+		    enum quirks_log_type log_type);
+
+/**
+ * Clean up after ourselves. Dropping the last reference must be the
+ * last call to the quirks subsystem.
  *
  * All quirks returned to the caller in quirks_fetch_for_device() must be
- * unref'd before this call.
+ * unref'd before the last reference is dropped.
  *
  * @return Always NULL
  */
 struct quirks_context *
 quirks_context_unref(struct quirks_context *ctx);
 
+/**
+ * Take a reference to the context. Referencing and unreferencing is
+ * thread-safe.
+ *
+ * @return The context
+ */
 struct quirks_context *
 quirks_context_ref(struct quirks_context *ctx);
 
 /**
  * Fetch the quirks for a given device. If no quirks are defined, this
- * function returns NULL.
+ * function returns NULL. This function does not modify the context and
+ * may be called from multiple threads at the same time.
  *
  * @return A new quirks struct, use quirks_unref() to release
  */
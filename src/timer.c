@@ -32,15 +32,17 @@
 
 #include "libinput-private.h"
 #include "timer.h"
+#include "tracepoints.h"
 
 void
 libinput_timer_init(struct libinput_timer *timer,
-		    struct libinput *libinput,
+		    struct libinput_device *device,
 		    const char *timer_name,
 		    void (*timer_func)(uint64_t now, void *timer_func_data),
 		    void *timer_func_data)
 {
-	timer->libinput = libinput;
+	timer->libinput = device->seat->libinput;
+	timer->device = device;
 	timer->timer_name = safe_strdup(timer_name);
 	timer->timer_func = timer_func;
 	timer->timer_func_data = timer_func_data;
@@ -52,29 +54,157 @@ libinput_timer_destroy(struct libinput_timer *timer)
 	free(timer->timer_name);
 }
 
+static inline void
+timer_heap_set(struct libinput *libinput,
+	       size_t idx,
+	       struct libinput_timer *timer)
+{
+	libinput->timer.heap[idx] = timer;
+	timer->heap_index = idx;
+}
+
 static void
-libinput_timer_arm_timer_fd(struct libinput *libinput)
+timer_heap_sift_up(struct libinput *libinput, size_t idx)
 {
-	int r;
-	struct libinput_timer *timer;
-	struct itimerspec its = { { 0, 0 }, { 0, 0 } };
-	uint64_t earliest_expire = UINT64_MAX;
+	struct libinput_timer **heap = libinput->timer.heap;
+	struct libinput_timer *timer = heap[idx];
+
+	while (idx > 0) {
+		size_t parent = (idx - 1) / 2;
+
+		if (heap[parent]->expire <= timer->expire)
+			break;
+
+		timer_heap_set(libinput, idx, heap[parent]);
+		idx = parent;
+	}
+
+	timer_heap_set(libinput, idx, timer);
+}
+
+static void
+timer_heap_sift_down(struct libinput *libinput, size_t idx)
+{
+	struct libinput_timer **heap = libinput->timer.heap;
+	struct libinput_timer *timer = heap[idx];
+	size_t len = libinput->timer.heap_len;
+
+	while (true) {
+		size_t child = 2 * idx + 1;
+
+		if (child >= len)
+			break;
 
-	list_for_each(timer, &libinput->timer.list, link) {
-		if (timer->expire < earliest_expire)
-			earliest_expire = timer->expire;
+		if (child + 1 < len &&
+		    heap[child + 1]->expire < heap[child]->expire)
+			child++;
+
+		if (timer->expire <= heap[child]->expire)
+			break;
+
+		timer_heap_set(libinput, idx, heap[child]);
+		idx = child;
+	}
+
+	timer_heap_set(libinput, idx, timer);
+}
+
+static void
+timer_heap_insert(struct libinput *libinput, struct libinput_timer *timer)
+{
+	size_t idx = libinput->timer.heap_len;
+
+	if (idx == libinput->timer.heap_size) {
+		size_t size = max(2 * libinput->timer.heap_size, 16);
+		struct libinput_timer **heap;
+
+		heap = realloc(libinput->timer.heap, size * sizeof(*heap));
+		if (!heap)
+			abort();
+
+		libinput->timer.heap = heap;
+		libinput->timer.heap_size = size;
 	}
 
-	if (earliest_expire != UINT64_MAX) {
-		its.it_value.tv_sec = earliest_expire / ms2us(1000);
-		its.it_value.tv_nsec = (earliest_expire % ms2us(1000)) * 1000;
+	libinput->timer.heap_len++;
+	timer_heap_set(libinput, idx, timer);
+	timer_heap_sift_up(libinput, idx);
+}
+
+static void
+timer_heap_update(struct libinput *libinput, struct libinput_timer *timer)
+{
+	size_t idx = timer->heap_index;
+
+	if (idx > 0 &&
+	    libinput->timer.heap[(idx - 1) / 2]->expire > timer->expire)
+		timer_heap_sift_up(libinput, idx);
+	else
+		timer_heap_sift_down(libinput, idx);
+}
+
+static void
+timer_heap_remove(struct libinput *libinput, struct libinput_timer *timer)
+{
+	size_t idx = timer->heap_index;
+	struct libinput_timer *last;
+
+	assert(idx < libinput->timer.heap_len);
+	assert(libinput->timer.heap[idx] == timer);
+
+	libinput->timer.heap_len--;
+	if (idx == libinput->timer.heap_len)
+		return;
+
+	/* move the last timer into the gap and restore the heap order */
+	last = libinput->timer.heap[libinput->timer.heap_len];
+	timer_heap_set(libinput, idx, last);
+	timer_heap_update(libinput, last);
+}
+
+static inline uint64_t
+libinput_timer_earliest_expiry(struct libinput *libinput)
+{
+	if (libinput->timer.heap_len == 0)
+		return UINT64_MAX;
+
+	return libinput->timer.heap[0]->expire;
+}
+
+static void
+libinput_timer_program_timer_fd(struct libinput *libinput, uint64_t expire)
+{
+	int r;
+	struct itimerspec its = { { 0, 0 }, { 0, 0 } };
+
+	if (expire != UINT64_MAX) {
+		its.it_value.tv_sec = expire / ms2us(1000);
+		its.it_value.tv_nsec = (expire % ms2us(1000)) * 1000;
 	}
 
+	libinput->timer.settime_count++;
 	r = timerfd_settime(libinput->timer.fd, TFD_TIMER_ABSTIME, &its, NULL);
 	if (r)
 		log_error(libinput, "timer: timerfd_settime error: %s\n", strerror(errno));
 
-	libinput->timer.next_expiry = earliest_expire;
+	libinput->timer.fd_expiry = expire;
+}
+
+/**
+ * The timerfd is only re-programmed when the earliest expiry moves before
+ * the currently programmed expiry. If the earliest timer was cancelled or
+ * moved to a later time, the timerfd fires early and
+ * libinput_timer_dispatch() re-programs it for the actual expiry then.
+ * This way timers that get pushed back repeatedly (e.g. disable-while-
+ * typing on every key press) do not cost a syscall on every update.
+ */
+static void
+libinput_timer_arm_timer_fd(struct libinput *libinput)
+{
+	uint64_t earliest_expire = libinput_timer_earliest_expiry(libinput);
+
+	if (earliest_expire < libinput->timer.fd_expiry)
+		libinput_timer_program_timer_fd(libinput, earliest_expire);
 }
 
 void
@@ -82,6 +212,8 @@ libinput_timer_set_flags(struct libinput_timer *timer,
 			 uint64_t expire,
 			 uint32_t flags)
 {
+	struct libinput *libinput = timer->libinput;
+
 #ifndef NDEBUG
 	uint64_t now = libinput_now(timer->libinput);
 	if (expire < now) {
@@ -100,11 +232,19 @@ libinput_timer_set_flags(struct libinput_timer *timer,
 
 	assert(expire);
 
-	if (!timer->expire)
-		list_insert(&timer->libinput->timer.list, &timer->link);
+	/* Round up to the slack so timers with the same slack coalesce */
+	if (timer->slack > 1)
+		expire = (expire + timer->slack - 1) / timer->slack * timer->slack;
 
-	timer->expire = expire;
-	libinput_timer_arm_timer_fd(timer->libinput);
+	if (!timer->expire) {
+		timer->expire = expire;
+		timer_heap_insert(libinput, timer);
+	} else {
+		timer->expire = expire;
+		timer_heap_update(libinput, timer);
+	}
+
+	libinput_timer_arm_timer_fd(libinput);
 }
 
 void
@@ -113,6 +253,12 @@ libinput_timer_set(struct libinput_timer *timer, uint64_t expire)
 	libinput_timer_set_flags(timer, expire, TIMER_FLAG_NONE);
 }
 
+void
+libinput_timer_set_slack(struct libinput_timer *timer, uint64_t slack)
+{
+	timer->slack = slack;
+}
+
 void
 libinput_timer_cancel(struct libinput_timer *timer)
 {
@@ -120,7 +266,7 @@ libinput_timer_cancel(struct libinput_timer *timer)
 		return;
 
 	timer->expire = 0;
-	list_remove(&timer->link);
+	timer_heap_remove(timer->libinput, timer);
 	libinput_timer_arm_timer_fd(timer->libinput);
 }
 
@@ -129,27 +275,21 @@ libinput_timer_handler(struct libinput *libinput , uint64_t now)
 {
 	struct libinput_timer *timer;
 
-restart:
-	list_for_each(timer, &libinput->timer.list, link) {
-		if (timer->expire == 0)
-			continue;
-
-		if (timer->expire <= now) {
-			/* Clear the timer before calling timer_func,
-			   as timer_func may re-arm it */
-			libinput_timer_cancel(timer);
-			timer->timer_func(now, timer->timer_func_data);
-
-			/*
-			 * Restart the loop. We can't use
-			 * list_for_each_safe() here because that only
-			 * allows removing one (our) timer per timer_func.
-			 * But the timer func may trigger another unrelated
-			 * timer to be cancelled and removed, causing a
-			 * segfault.
-			 */
-			goto restart;
-		}
+	/*
+	 * Always look at the top of the heap again after a timer_func, it
+	 * may arm or cancel any timer, including itself.
+	 */
+	while (libinput->timer.heap_len > 0) {
+		timer = libinput->timer.heap[0];
+		if (timer->expire > now)
+			break;
+
+		/* Clear the timer before calling timer_func,
+		   as timer_func may re-arm it */
+		libinput_timer_cancel(timer);
+		timer->device->stats.timers_fired++;
+		trace_point2(timer_fire, timer->timer_name, now);
+		timer->timer_func(now, timer->timer_func_data);
 	}
 }
 
@@ -168,11 +308,19 @@ libinput_timer_dispatch(void *data)
 				 errno,
 				 strerror(errno));
 
+	/* The timerfd is one-shot, once expired it is disarmed */
+	if (r > 0)
+		libinput->timer.fd_expiry = UINT64_MAX;
+
 	now = libinput_now(libinput);
 	if (now == 0)
 		return;
 
 	libinput_timer_handler(libinput, now);
+
+	/* If the timerfd fired early because the earliest timer was
+	 * cancelled or moved later, re-program it for the actual expiry */
+	libinput_timer_arm_timer_fd(libinput);
 }
 
 int
@@ -183,7 +331,7 @@ libinput_timer_subsys_init(struct libinput *libinput)
 	if (libinput->timer.fd < 0)
 		return -1;
 
-	list_init(&libinput->timer.list);
+	libinput->timer.fd_expiry = UINT64_MAX;
 
 	libinput->timer.source = libinput_add_fd(libinput,
 						 libinput->timer.fd,
@@ -201,10 +349,11 @@ void
 libinput_timer_subsys_destroy(struct libinput *libinput)
 {
 	/* All timer users should have destroyed their timers now */
-	assert(list_empty(&libinput->timer.list));
+	assert(libinput->timer.heap_len == 0);
 
 	libinput_remove_source(libinput, libinput->timer.source);
 	close(libinput->timer.fd);
+	free(libinput->timer.heap);
 }
 
 /**
@@ -219,8 +368,7 @@ libinput_timer_subsys_destroy(struct libinput *libinput)
 void
 libinput_timer_flush(struct libinput *libinput, uint64_t now)
 {
-	if (libinput->timer.next_expiry == 0 ||
-	    libinput->timer.next_expiry > now)
+	if (libinput_timer_earliest_expiry(libinput) > now)
 		return;
 
 	libinput_timer_handler(libinput, now);
@@ -29,18 +29,22 @@
 #include "libinput-util.h"
 
 struct libinput;
+struct libinput_device;
 
 struct libinput_timer {
 	struct libinput *libinput;
+	struct libinput_device *device;
 	char *timer_name;
-	struct list link;
+	size_t heap_index; /* only valid while the timer is armed */
 	uint64_t expire; /* in absolute us CLOCK_MONOTONIC */
+	uint64_t slack; /* in us */
 	void (*timer_func)(uint64_t now, void *timer_func_data);
 	void *timer_func_data;
 };
 
 void
-libinput_timer_init(struct libinput_timer *timer, struct libinput *libinput,
+libinput_timer_init(struct libinput_timer *timer,
+		    struct libinput_device *device,
 		    const char *timer_name,
 		    void (*timer_func)(uint64_t now, void *timer_func_data),
 		    void *timer_func_data);
@@ -65,6 +69,12 @@ libinput_timer_set_flags(struct libinput_timer *timer,
 void
 libinput_timer_cancel(struct libinput_timer *timer);
 
+/* Allow the timer to expire up to slack us after the requested expiry
+ * time. Timers with the same slack are aligned to the same multiple of the
+ * slack so that timers expiring around the same time fire together. */
+void
+libinput_timer_set_slack(struct libinput_timer *timer, uint64_t slack);
+
 int
 libinput_timer_subsys_init(struct libinput *libinput);
 
@@ -0,0 +1,66 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef TRACEPOINTS_H
+#define TRACEPOINTS_H
+
+/* Static tracepoints for perf, bpftrace, systemtap, etc. Enabled with the
+ * meson option -Dtracepoints=true, otherwise they compile to nothing and
+ * their arguments are not evaluated.
+ *
+ * All probes use the provider "libinput":
+ * - dispatch_start(sysname), dispatch_done(sysname, rc):
+ *   evdev_device_dispatch() entry and exit, rc is the last libevdev read
+ *   status
+ * - frame(sysname, nevents, time): a hardware frame is processed
+ * - timer_fire(timer_name, now): a timer expired
+ * - filter_accel(velocity, factor): an acceleration factor was calculated,
+ *   velocity in device units per second, factor multiplied by 1000
+ * - tp_pre_process_state(time), tp_process_state(time),
+ *   tp_post_events(time), tp_post_process_state(time),
+ *   tp_handle_state_done(time): the touchpad state machine stages
+ * - tablet_flush(sysname, time): tablet state is flushed
+ * - post_event(type): an event is queued, type is the enum
+ *   libinput_event_type
+ *
+ * For example:
+ *   bpftrace -e 'usdt:/usr/lib64/libinput.so.10:libinput:post_event {
+ *                @[arg0] = count(); }'
+ */
+
+#if HAVE_TRACEPOINTS
+#include <sys/sdt.h>
+
+#define trace_point1(name, a1) \
+	DTRACE_PROBE1(libinput, name, a1)
+#define trace_point2(name, a1, a2) \
+	DTRACE_PROBE2(libinput, name, a1, a2)
+#define trace_point3(name, a1, a2, a3) \
+	DTRACE_PROBE3(libinput, name, a1, a2, a3)
+#else
+#define trace_point1(name, a1) do { } while (0)
+#define trace_point2(name, a1, a2) do { } while (0)
+#define trace_point3(name, a1, a2, a3) do { } while (0)
+#endif
+
+#endif
@@ -43,14 +43,19 @@ udev_seat_create(struct udev_input *input,
 static struct udev_seat *
 udev_seat_get_named(struct udev_input *input, const char *seat_name);
 
+/**
+ * Set up the probe for a udev device, see evdev_device_create_all().
+ *
+ * @return 1 if the device should be created, 0 if it is to be skipped or
+ * -1 on error
+ */
 static int
-device_added(struct udev_device *udev_device,
-	     struct udev_input *input,
-	     const char *seat_name)
+device_added_prepare(struct udev_device *udev_device,
+		     struct udev_input *input,
+		     const char *seat_name,
+		     struct evdev_device_probe *probe)
 {
-	struct evdev_device *device;
-	const char *devnode, *sysname;
-	const char *device_seat, *output_name;
+	const char *device_seat;
 	struct udev_seat *seat;
 
 	device_seat = udev_device_get_property_value(udev_device, "ID_SEAT");
@@ -63,9 +68,6 @@ device_added(struct udev_device *udev_device,
 	if (ignore_litest_test_suite_device(udev_device))
 		return 0;
 
-	devnode = udev_device_get_devnode(udev_device);
-	sysname = udev_device_get_sysname(udev_device);
-
 	/* Search for matching logical seat */
 	if (!seat_name)
 		seat_name = udev_device_get_property_value(udev_device, "WL_SEAT");
@@ -82,21 +84,43 @@ device_added(struct udev_device *udev_device,
 			return -1;
 	}
 
-	device = evdev_device_create(&seat->base, udev_device);
-	libinput_seat_unref(&seat->base);
+	probe->seat = &seat->base;
+	probe->udev_device = udev_device_ref(udev_device);
+
+	return 1;
+}
+
+static void
+device_added_finish(struct udev_input *input,
+		    struct evdev_device_probe *probe)
+{
+	struct udev_device *udev_device = probe->udev_device;
+	struct evdev_device *device = probe->device;
+	const char *devnode, *sysname;
+	const char *output_name;
+
+	libinput_seat_unref(probe->seat);
+
+	/* seat was suspended or the device removed while it was being
+	 * opened */
+	if (probe->cancelled)
+		goto out;
+
+	devnode = udev_device_get_devnode(udev_device);
+	sysname = udev_device_get_sysname(udev_device);
 
 	if (device == EVDEV_UNHANDLED_DEVICE) {
 		log_info(&input->base,
 			 "%-7s - not using input device '%s'\n",
 			 sysname,
 			 devnode);
-		return 0;
+		goto out;
 	} else if (device == NULL) {
 		log_info(&input->base,
 			 "%-7s - failed to create input device '%s'\n",
 			 sysname,
 			 devnode);
-		return 0;
+		goto out;
 	}
 
 	evdev_read_calibration_prop(device);
@@ -104,6 +128,66 @@ device_added(struct udev_device *udev_device,
 	output_name = udev_device_get_property_value(udev_device, "WL_OUTPUT");
 	device->output_name = safe_strdup(output_name);
 
+out:
+	udev_device_unref(udev_device);
+}
+
+struct udev_pending_probe {
+	struct evdev_device_probe probe;
+	struct udev_input *input;
+	struct list link; /* udev_input.pending_probes */
+};
+
+static void
+device_added_async_done(struct evdev_device_probe *probe, void *data)
+{
+	struct udev_pending_probe *pending = data;
+
+	list_remove(&pending->link);
+	device_added_finish(pending->input, probe);
+	free(pending);
+}
+
+/**
+ * Create the device once the caller's asynchronous open completes, see
+ * libinput_set_open_async().
+ */
+static void
+device_added_async(struct udev_input *input,
+		   const struct evdev_device_probe *prepared)
+{
+	struct udev_pending_probe *pending;
+
+	pending = zalloc(sizeof *pending);
+	pending->probe = *prepared;
+	pending->input = input;
+	list_append(&input->pending_probes, &pending->link);
+
+	evdev_device_create_async(&pending->probe,
+				  device_added_async_done,
+				  pending);
+}
+
+static int
+device_added(struct udev_device *udev_device,
+	     struct udev_input *input,
+	     const char *seat_name)
+{
+	struct evdev_device_probe probe = {0};
+	int rc;
+
+	rc = device_added_prepare(udev_device, input, seat_name, &probe);
+	if (rc <= 0)
+		return rc;
+
+	if (libinput_open_is_async(&input->base)) {
+		device_added_async(input, &probe);
+		return 0;
+	}
+
+	evdev_device_create_all(&probe, 1);
+	device_added_finish(input, &probe);
+
 	return 0;
 }
 
@@ -111,10 +195,20 @@ static void
 device_removed(struct udev_device *udev_device, struct udev_input *input)
 {
 	struct evdev_device *device, *next;
+	struct udev_pending_probe *pending, *tmp;
 	struct udev_seat *seat;
 	const char *syspath;
 
 	syspath = udev_device_get_syspath(udev_device);
+
+	/* Removed before the open completed, the fd is closed once the
+	 * caller completes the request */
+	list_for_each_safe(pending, tmp, &input->pending_probes, link) {
+		if (streq(syspath,
+			  udev_device_get_syspath(pending->probe.udev_device)))
+			evdev_device_create_async_cancel(&pending->probe);
+	}
+
 	list_for_each(seat, &input->base.seat_list, base.link) {
 		list_for_each_safe(device, next,
 				   &seat->base.devices_list, base.link) {
@@ -134,7 +228,12 @@ udev_input_add_devices(struct udev_input *input, struct udev *udev)
 	struct udev_list_entry *entry;
 	struct udev_device *device;
 	const char *path, *sysname;
+	struct evdev_device_probe *probes = NULL;
+	size_t nprobes = 0, sz = 0;
+	int rc = 0;
 
+	/* Collect all devices first so we can probe them in one go, the
+	 * devices are added in enumeration order */
 	e = udev_enumerate_new(udev);
 	udev_enumerate_add_match_subsystem(e, "input");
 	udev_enumerate_scan_devices(e);
@@ -161,17 +260,36 @@ udev_input_add_devices(struct udev_input *input, struct udev *udev)
 			continue;
 		}
 
-		if (device_added(device, input, NULL) < 0) {
-			udev_device_unref(device);
-			udev_enumerate_unref(e);
-			return -1;
+		if (nprobes == sz) {
+			sz = sz ? sz * 2 : 16;
+			probes = realloc(probes, sz * sizeof *probes);
+			if (!probes)
+				abort();
 		}
 
+		memset(&probes[nprobes], 0, sizeof *probes);
+		rc = device_added_prepare(device, input, NULL,
+					  &probes[nprobes]);
 		udev_device_unref(device);
+		if (rc < 0)
+			break;
+		if (rc > 0)
+			nprobes++;
 	}
 	udev_enumerate_unref(e);
 
-	return 0;
+	if (libinput_open_is_async(&input->base)) {
+		/* All open requests are in flight at the same time */
+		for (size_t i = 0; i < nprobes; i++)
+			device_added_async(input, &probes[i]);
+	} else {
+		evdev_device_create_all(probes, nprobes);
+		for (size_t i = 0; i < nprobes; i++)
+			device_added_finish(input, &probes[i]);
+	}
+	free(probes);
+
+	return rc < 0 ? -1 : 0;
 }
 
 static void
@@ -225,6 +343,8 @@ udev_input_disable(struct libinput *libinput)
 	if (!input->udev_monitor)
 		return;
 
+	libinput_open_cancel_all(libinput);
+
 	udev_monitor_unref(input->udev_monitor);
 	input->udev_monitor = NULL;
 	libinput_remove_source(&input->base, input->udev_monitor_source);
@@ -372,6 +492,7 @@ libinput_udev_create_context(const struct libinput_interface *interface,
 	}
 
 	input->udev = udev_ref(udev);
+	list_init(&input->pending_probes);
 
 	return &input->base;
 }
@@ -39,6 +39,7 @@ struct udev_input {
 	struct udev_monitor *udev_monitor;
 	struct libinput_source *udev_monitor_source;
 	char *seat_id;
+	struct list pending_probes; /* devices waiting for their open */
 };
 
 #endif
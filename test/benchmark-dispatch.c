@@ -0,0 +1,680 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Measures the cost of processing input frames in the dispatch backends.
+ *
+ * Devices are created through uinput once so they are set up like any
+ * other device. The scripted frames are then injected directly into the
+ * device's event processing, no events go through the kernel. For each
+ * scenario, the time per frame, the number of heap allocations per frame
+ * and the number of libinput events per frame are printed. Allocations
+ * are only counted where the linker supports --wrap.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <libudev.h>
+#include <libevdev/libevdev-uinput.h>
+
+#include "libinput.h"
+#include "evdev.h"
+
+#define EXIT_SKIP 77
+
+#ifdef BENCHMARK_WRAP_ALLOC
+/* The library objects are linked with --wrap for the allocator
+ * functions, so all their allocations go through these */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t nmemb, size_t size);
+void *__wrap_realloc(void *ptr, size_t size);
+
+static uint64_t nallocs;
+
+void *
+__wrap_malloc(size_t size)
+{
+	nallocs++;
+	return __real_malloc(size);
+}
+
+void *
+__wrap_calloc(size_t nmemb, size_t size)
+{
+	nallocs++;
+	return __real_calloc(nmemb, size);
+}
+
+void *
+__wrap_realloc(void *ptr, size_t size)
+{
+	nallocs++;
+	return __real_realloc(ptr, size);
+}
+#else
+static const uint64_t nallocs = 0;
+#endif
+
+/* The timer code complains about timers more than 5s in the future, so
+ * the synthetic event time may not run too far ahead of the clock. Each
+ * scenario is run in rounds of at most this much event time, every
+ * round with a new context. */
+#define ROUND_TIME s2us(3)
+
+#define MAX_SLOTS 10
+
+struct frame {
+	struct input_event events[128];
+	size_t count;
+};
+
+struct scenario_state {
+	int tracking_id;
+	uint32_t seed;
+	int ntouches;
+	bool down[MAX_SLOTS];
+	int x[MAX_SLOTS];
+	int y[MAX_SLOTS];
+};
+
+struct scenario {
+	const char *name;
+	struct libevdev *(*create)(void);
+	enum libinput_device_capability capability;
+	void (*frame)(struct scenario_state *state,
+		      struct frame *frame,
+		      unsigned int index);
+	uint64_t interval; /* us between frames */
+	unsigned int nframes;
+};
+
+static void
+frame_add(struct frame *frame, unsigned int type, unsigned int code, int value)
+{
+	struct input_event *ev;
+
+	if (frame->count >= ARRAY_LENGTH(frame->events))
+		abort();
+
+	ev = &frame->events[frame->count++];
+	ev->type = type;
+	ev->code = code;
+	ev->value = value;
+}
+
+static uint32_t
+scenario_random(struct scenario_state *state)
+{
+	state->seed = state->seed * 1103515245 + 12345;
+	return (state->seed >> 16) & 0x7fff;
+}
+
+static void
+enable_abs(struct libevdev *dev,
+	   unsigned int code,
+	   int minimum,
+	   int maximum,
+	   int resolution)
+{
+	struct input_absinfo abs = {
+		.minimum = minimum,
+		.maximum = maximum,
+		.resolution = resolution,
+	};
+
+	libevdev_enable_event_code(dev, EV_ABS, code, &abs);
+}
+
+static struct libevdev *
+create_mouse(void)
+{
+	struct libevdev *dev = libevdev_new();
+
+	libevdev_set_name(dev, "benchmark mouse");
+	libevdev_set_id_bustype(dev, BUS_USB);
+	libevdev_enable_event_code(dev, EV_REL, REL_X, NULL);
+	libevdev_enable_event_code(dev, EV_REL, REL_Y, NULL);
+	libevdev_enable_event_code(dev, EV_REL, REL_WHEEL, NULL);
+	libevdev_enable_event_code(dev, EV_KEY, BTN_LEFT, NULL);
+	libevdev_enable_event_code(dev, EV_KEY, BTN_RIGHT, NULL);
+	libevdev_enable_event_code(dev, EV_KEY, BTN_MIDDLE, NULL);
+
+	return dev;
+}
+
+static struct libevdev *
+create_touchpad(void)
+{
+	struct libevdev *dev = libevdev_new();
+
+	libevdev_set_name(dev, "benchmark touchpad");
+	libevdev_set_id_bustype(dev, BUS_I2C);
+	libevdev_enable_event_code(dev, EV_KEY, BTN_LEFT, NULL);
+	libevdev_enable_event_code(dev, EV_KEY, BTN_TOUCH, NULL);
+	libevdev_enable_event_code(dev, EV_KEY, BTN_TOOL_FINGER, NULL);
+	libevdev_enable_event_code(dev, EV_KEY, BTN_TOOL_DOUBLETAP, NULL);
+	libevdev_enable_event_code(dev, EV_KEY, BTN_TOOL_TRIPLETAP, NULL);
+	libevdev_enable_event_code(dev, EV_KEY, BTN_TOOL_QUADTAP, NULL);
+	libevdev_enable_event_code(dev, EV_KEY, BTN_TOOL_QUINTTAP, NULL);
+	enable_abs(dev, ABS_X, 0, 4000, 40);
+	enable_abs(dev, ABS_Y, 0, 3000, 40);
+	enable_abs(dev, ABS_MT_SLOT, 0, 4, 0);
+	enable_abs(dev, ABS_MT_POSITION_X, 0, 4000, 40);
+	enable_abs(dev, ABS_MT_POSITION_Y, 0, 3000, 40);
+	enable_abs(dev, ABS_MT_TRACKING_ID, 0, 65535, 0);
+	libevdev_enable_property(dev, INPUT_PROP_POINTER);
+	libevdev_enable_property(dev, INPUT_PROP_BUTTONPAD);
+
+	return dev;
+}
+
+static struct libevdev *
+create_touchscreen(void)
+{
+	struct libevdev *dev = libevdev_new();
+
+	libevdev_set_name(dev, "benchmark touchscreen");
+	libevdev_set_id_bustype(dev, BUS_I2C);
+	libevdev_enable_event_code(dev, EV_KEY, BTN_TOUCH, NULL);
+	enable_abs(dev, ABS_X, 0, 4000, 10);
+	enable_abs(dev, ABS_Y, 0, 3000, 10);
+	enable_abs(dev, ABS_MT_SLOT, 0, MAX_SLOTS - 1, 0);
+	enable_abs(dev, ABS_MT_POSITION_X, 0, 4000, 10);
+	enable_abs(dev, ABS_MT_POSITION_Y, 0, 3000, 10);
+	enable_abs(dev, ABS_MT_TRACKING_ID, 0, 65535, 0);
+	libevdev_enable_property(dev, INPUT_PROP_DIRECT);
+
+	return dev;
+}
+
+static struct libevdev *
+create_tablet(void)
+{
+	struct libevdev *dev = libevdev_new();
+
+	libevdev_set_name(dev, "benchmark tablet pen");
+	libevdev_set_id_bustype(dev, BUS_USB);
+	libevdev_enable_event_code(dev, EV_KEY, BTN_TOOL_PEN, NULL);
+	libevdev_enable_event_code(dev, EV_KEY, BTN_TOOL_RUBBER, NULL);
+	libevdev_enable_event_code(dev, EV_KEY, BTN_TOUCH, NULL);
+	libevdev_enable_event_code(dev, EV_KEY, BTN_STYLUS, NULL);
+	libevdev_enable_event_code(dev, EV_KEY, BTN_STYLUS2, NULL);
+	enable_abs(dev, ABS_X, 0, 44704, 200);
+	enable_abs(dev, ABS_Y, 0, 27940, 200);
+	enable_abs(dev, ABS_PRESSURE, 0, 2047, 0);
+	enable_abs(dev, ABS_DISTANCE, 0, 63, 0);
+	enable_abs(dev, ABS_TILT_X, 0, 127, 0);
+	enable_abs(dev, ABS_TILT_Y, 0, 127, 0);
+	libevdev_enable_property(dev, INPUT_PROP_POINTER);
+
+	return dev;
+}
+
+static struct libevdev *
+create_pad(void)
+{
+	struct libevdev *dev = libevdev_new();
+
+	libevdev_set_name(dev, "benchmark tablet pad");
+	libevdev_set_id_bustype(dev, BUS_USB);
+	for (unsigned int code = BTN_0; code <= BTN_8; code++)
+		libevdev_enable_event_code(dev, EV_KEY, code, NULL);
+	libevdev_enable_event_code(dev, EV_KEY, BTN_STYLUS, NULL);
+	enable_abs(dev, ABS_X, 0, 1, 0);
+	enable_abs(dev, ABS_Y, 0, 1, 0);
+	enable_abs(dev, ABS_WHEEL, 0, 71, 0);
+	enable_abs(dev, ABS_MISC, 0, 0, 0);
+
+	return dev;
+}
+
+static void
+frame_mouse_motion(struct scenario_state *state,
+		   struct frame *frame,
+		   unsigned int index)
+{
+	/* a slow square, 200 frames per side */
+	int dx = ((index / 200) % 4 == 0) - ((index / 200) % 4 == 2);
+	int dy = ((index / 200) % 4 == 1) - ((index / 200) % 4 == 3);
+
+	if (dx)
+		frame_add(frame, EV_REL, REL_X, dx);
+	if (dy)
+		frame_add(frame, EV_REL, REL_Y, dy);
+}
+
+static void
+frame_touch_slot(struct scenario_state *state,
+		 struct frame *frame,
+		 int slot,
+		 bool down,
+		 bool begin)
+{
+	frame_add(frame, EV_ABS, ABS_MT_SLOT, slot);
+	if (!down) {
+		frame_add(frame, EV_ABS, ABS_MT_TRACKING_ID, -1);
+		return;
+	}
+
+	if (begin)
+		frame_add(frame, EV_ABS, ABS_MT_TRACKING_ID, ++state->tracking_id);
+	frame_add(frame, EV_ABS, ABS_MT_POSITION_X, state->x[slot]);
+	frame_add(frame, EV_ABS, ABS_MT_POSITION_Y, state->y[slot]);
+}
+
+static void
+frame_touchpad_tool(struct scenario_state *state,
+		    struct frame *frame,
+		    int ntouches)
+{
+	static const unsigned int tools[] = {
+		BTN_TOOL_FINGER,
+		BTN_TOOL_DOUBLETAP,
+		BTN_TOOL_TRIPLETAP,
+		BTN_TOOL_QUADTAP,
+		BTN_TOOL_QUINTTAP,
+	};
+
+	if (ntouches == state->ntouches)
+		return;
+
+	if (state->ntouches > 0)
+		frame_add(frame, EV_KEY, tools[state->ntouches - 1], 0);
+	if (ntouches > 0)
+		frame_add(frame, EV_KEY, tools[ntouches - 1], 1);
+	if ((ntouches == 0) != (state->ntouches == 0))
+		frame_add(frame, EV_KEY, BTN_TOUCH, ntouches > 0);
+
+	state->ntouches = ntouches;
+}
+
+static void
+frame_touchpad_scroll(struct scenario_state *state,
+		      struct frame *frame,
+		      unsigned int index)
+{
+	unsigned int step = index % 100;
+	bool begin = step == 0,
+	     end = step == 99;
+
+	for (int slot = 0; slot < 2; slot++) {
+		state->x[slot] = 1500 + slot * 1000;
+		state->y[slot] = 800 + step * 15;
+		frame_touch_slot(state, frame, slot, !end, begin);
+	}
+
+	frame_touchpad_tool(state, frame, end ? 0 : 2);
+	if (!end) {
+		frame_add(frame, EV_ABS, ABS_X, state->x[0]);
+		frame_add(frame, EV_ABS, ABS_Y, state->y[0]);
+	}
+}
+
+static void
+frame_touchpad_palms(struct scenario_state *state,
+		     struct frame *frame,
+		     unsigned int index)
+{
+	int ntouches = 0;
+
+	for (int slot = 0; slot < 5; slot++) {
+		bool was_down = state->down[slot];
+
+		/* every touch changes state every 16 frames on average */
+		if (scenario_random(state) % 16 == 0)
+			state->down[slot] = !was_down;
+
+		if (!state->down[slot]) {
+			if (was_down)
+				frame_touch_slot(state, frame, slot, false, false);
+			continue;
+		}
+
+		if (!was_down) {
+			state->x[slot] = 500 + scenario_random(state) % 3000;
+			state->y[slot] = 500 + scenario_random(state) % 2000;
+		} else {
+			state->x[slot] += (int)(scenario_random(state) % 81) - 40;
+			state->y[slot] += (int)(scenario_random(state) % 81) - 40;
+		}
+		state->x[slot] = max(0, min(4000, state->x[slot]));
+		state->y[slot] = max(0, min(3000, state->y[slot]));
+
+		frame_touch_slot(state, frame, slot, true, !was_down);
+		ntouches++;
+	}
+
+	frame_touchpad_tool(state, frame, ntouches);
+}
+
+static void
+frame_touchscreen(struct scenario_state *state,
+		  struct frame *frame,
+		  unsigned int index)
+{
+	unsigned int step = index % 120;
+	bool begin = step == 0,
+	     end = step == 119;
+
+	for (int slot = 0; slot < MAX_SLOTS; slot++) {
+		state->x[slot] = 200 + slot * 350 + step * 2;
+		state->y[slot] = 500 + step * 15;
+		frame_touch_slot(state, frame, slot, !end, begin);
+	}
+
+	if (begin || end)
+		frame_add(frame, EV_KEY, BTN_TOUCH, !end);
+	if (!end) {
+		frame_add(frame, EV_ABS, ABS_X, state->x[0]);
+		frame_add(frame, EV_ABS, ABS_Y, state->y[0]);
+	}
+}
+
+static void
+frame_pen_hover(struct scenario_state *state,
+		struct frame *frame,
+		unsigned int index)
+{
+	unsigned int step = index % 300;
+
+	if (step == 299) {
+		frame_add(frame, EV_ABS, ABS_DISTANCE, 0);
+		frame_add(frame, EV_KEY, BTN_TOOL_PEN, 0);
+		return;
+	}
+
+	frame_add(frame, EV_ABS, ABS_X, 10000 + step * 80);
+	frame_add(frame, EV_ABS, ABS_Y, 8000 + step * 40);
+	frame_add(frame, EV_ABS, ABS_DISTANCE, 20 + step % 20);
+	frame_add(frame, EV_ABS, ABS_TILT_X, 64 + step % 10);
+	frame_add(frame, EV_ABS, ABS_TILT_Y, 64);
+	if (step == 0)
+		frame_add(frame, EV_KEY, BTN_TOOL_PEN, 1);
+}
+
+static void
+frame_pad_ring(struct scenario_state *state,
+	       struct frame *frame,
+	       unsigned int index)
+{
+	unsigned int step = index % 100;
+
+	if (step < 90) {
+		frame_add(frame, EV_ABS, ABS_WHEEL, (index / 2) % 72);
+		frame_add(frame, EV_ABS, ABS_MISC, 15);
+	} else if (step == 90) {
+		frame_add(frame, EV_ABS, ABS_WHEEL, 0);
+		frame_add(frame, EV_ABS, ABS_MISC, 0);
+		frame_add(frame, EV_KEY, BTN_0, 1);
+		frame_add(frame, EV_ABS, ABS_MISC, 15);
+	} else if (step == 95) {
+		frame_add(frame, EV_KEY, BTN_0, 0);
+		frame_add(frame, EV_ABS, ABS_MISC, 0);
+	}
+}
+
+static const struct scenario scenarios[] = {
+	{ "mouse 8kHz motion", create_mouse,
+	  LIBINPUT_DEVICE_CAP_POINTER,
+	  frame_mouse_motion, 125, 80000 },
+	{ "touchpad two-finger scroll", create_touchpad,
+	  LIBINPUT_DEVICE_CAP_POINTER,
+	  frame_touchpad_scroll, 7000, 20000 },
+	{ "touchpad 5-finger palm storm", create_touchpad,
+	  LIBINPUT_DEVICE_CAP_POINTER,
+	  frame_touchpad_palms, 7000, 20000 },
+	{ "touchscreen 10 fingers", create_touchscreen,
+	  LIBINPUT_DEVICE_CAP_TOUCH,
+	  frame_touchscreen, 8333, 12000 },
+	{ "pen hover 300Hz", create_tablet,
+	  LIBINPUT_DEVICE_CAP_TABLET_TOOL,
+	  frame_pen_hover, 3333, 30000 },
+	{ "pad ring", create_pad,
+	  LIBINPUT_DEVICE_CAP_TABLET_PAD,
+	  frame_pad_ring, 10000, 20000 },
+};
+
+static int
+bench_open_restricted(const char *path, int flags, void *user_data)
+{
+	int fd = open(path, flags);
+
+	return fd < 0 ? -errno : fd;
+}
+
+static void
+bench_close_restricted(int fd, void *user_data)
+{
+	close(fd);
+}
+
+static const struct libinput_interface interface = {
+	.open_restricted = bench_open_restricted,
+	.close_restricted = bench_close_restricted,
+};
+
+static uint64_t
+now_nsec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return s2us(ts.tv_sec) * 1000 + ts.tv_nsec;
+}
+
+/* The path backend needs the udev properties, so wait for udev to
+ * process the new device node */
+static bool
+wait_for_udev(const char *devnode)
+{
+	struct udev *udev;
+	struct stat st;
+	bool initialized = false;
+
+	if (stat(devnode, &st) != 0)
+		return false;
+
+	udev = udev_new();
+	for (int i = 0; i < 500 && !initialized; i++) {
+		struct udev_device *d;
+
+		d = udev_device_new_from_devnum(udev, 'c', st.st_rdev);
+		if (d) {
+			initialized = udev_device_get_is_initialized(d);
+			udev_device_unref(d);
+		}
+		if (!initialized)
+			usleep(10000);
+	}
+	udev_unref(udev);
+
+	return initialized;
+}
+
+static void
+drain_events(struct libinput *li, uint64_t *nevents)
+{
+	struct libinput_event *event;
+
+	while ((event = libinput_get_event(li))) {
+		(*nevents)++;
+		libinput_event_destroy(event);
+	}
+}
+
+struct scenario_result {
+	unsigned int nframes;
+	uint64_t elapsed;
+	uint64_t allocs;
+	uint64_t nevents;
+};
+
+/* Run the first nframes frames of the scenario on a new context.
+ * Returns false if the device isn't set up as expected. */
+static bool
+run_round(const struct scenario *scenario,
+	  struct libevdev_uinput *uinput,
+	  unsigned int round,
+	  unsigned int nframes,
+	  struct scenario_result *result)
+{
+	struct libinput *li;
+	struct libinput_device *device;
+	struct evdev_device *evdev;
+	struct scenario_state state = { .seed = round + 1 };
+	struct frame frame;
+	uint64_t time, start, allocs, nevents = 0;
+
+	li = libinput_path_create_context(&interface, NULL);
+	libinput_log_set_priority(li, LIBINPUT_LOG_PRIORITY_ERROR);
+
+	device = libinput_path_add_device(li,
+					  libevdev_uinput_get_devnode(uinput));
+	if (!device ||
+	    !libinput_device_has_capability(device, scenario->capability)) {
+		libinput_unref(li);
+		return false;
+	}
+
+	libinput_dispatch(li);
+	drain_events(li, &nevents);
+	nevents = 0;
+
+	evdev = evdev_device(device);
+	time = ns2us(now_nsec());
+
+	allocs = nallocs;
+	start = now_nsec();
+	for (unsigned int i = 0; i < nframes; i++) {
+		frame.count = 0;
+		scenario->frame(&state, &frame, i);
+		frame_add(&frame, EV_SYN, SYN_REPORT, 0);
+
+		/* A slow build may process frames slower than the
+		 * scenario's rate, the events must not be stamped in the
+		 * past either */
+		time = max(time + scenario->interval, ns2us(now_nsec()));
+		for (size_t e = 0; e < frame.count; e++)
+			frame.events[e].time = us2tv(time);
+
+		evdev_device_inject_events(evdev, frame.events, frame.count);
+		drain_events(li, &nevents);
+	}
+	result->elapsed += now_nsec() - start;
+	result->allocs += nallocs - allocs;
+	result->nevents += nevents;
+	result->nframes += nframes;
+
+	libinput_unref(li);
+
+	return true;
+}
+
+static int
+run_scenario(const struct scenario *scenario)
+{
+	struct libevdev *dev;
+	struct libevdev_uinput *uinput;
+	struct scenario_result result = {0};
+	unsigned int round_frames;
+	char allocs[32] = "n/a";
+	int rc;
+
+	dev = scenario->create();
+	rc = libevdev_uinput_create_from_device(dev,
+						LIBEVDEV_UINPUT_OPEN_MANAGED,
+						&uinput);
+	libevdev_free(dev);
+	if (rc != 0) {
+		fprintf(stderr,
+			"Failed to create uinput device (%s), skipping\n",
+			strerror(-rc));
+		return EXIT_SKIP;
+	}
+
+	if (!wait_for_udev(libevdev_uinput_get_devnode(uinput)))
+		goto skip;
+
+	round_frames = max(ROUND_TIME / scenario->interval, 1);
+	for (unsigned int round = 0;
+	     result.nframes < scenario->nframes;
+	     round++) {
+		unsigned int nframes = min(round_frames,
+					   scenario->nframes - result.nframes);
+
+		if (!run_round(scenario, uinput, round, nframes, &result))
+			goto skip;
+	}
+
+#ifdef BENCHMARK_WRAP_ALLOC
+	snprintf(allocs, sizeof(allocs), "%.2f",
+		 (double)result.allocs / result.nframes);
+#endif
+
+	printf("%-32s %8u frames %10.1f ns/frame %6s allocs/frame %6.2f events/frame\n",
+	       scenario->name,
+	       result.nframes,
+	       (double)result.elapsed / result.nframes,
+	       allocs,
+	       (double)result.nevents / result.nframes);
+
+	libevdev_uinput_destroy(uinput);
+
+	return 0;
+
+skip:
+	printf("%-32s skipped, device not set up as expected\n",
+	       scenario->name);
+	libevdev_uinput_destroy(uinput);
+
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	const struct scenario *scenario;
+	int rc = 0;
+
+	ARRAY_FOR_EACH(scenarios, scenario) {
+		if (argc > 1 && !strstr(scenario->name, argv[1]))
+			continue;
+
+		rc = run_scenario(scenario);
+		if (rc != 0)
+			break;
+	}
+
+	return rc;
+}
@@ -520,6 +520,128 @@ START_TEST(device_disable_release_keys)
 }
 END_TEST
 
+START_TEST(device_reenable_resume_stats)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	enum libinput_config_status status;
+	uint64_t resumes;
+
+	litest_drain_events(li);
+
+	resumes = libinput_device_get_counter(device,
+					      LIBINPUT_DEVICE_COUNTER_RESUMES);
+
+	for (int i = 1; i <= 3; i++) {
+		status = libinput_device_config_send_events_set_mode(device,
+				LIBINPUT_CONFIG_SEND_EVENTS_DISABLED);
+		ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+		status = libinput_device_config_send_events_set_mode(device,
+				LIBINPUT_CONFIG_SEND_EVENTS_ENABLED);
+		ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+
+		ck_assert_int_eq(libinput_device_get_counter(device,
+							     LIBINPUT_DEVICE_COUNTER_RESUMES),
+				 resumes + i);
+	}
+
+	ck_assert_int_ge(libinput_get_device_counter(li,
+						     LIBINPUT_DEVICE_COUNTER_RESUMES),
+			 resumes + 3);
+
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_MOTION);
+}
+END_TEST
+
+START_TEST(device_reenable_key_released_while_disabled)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	enum libinput_config_status status;
+
+	litest_keyboard_key(dev, KEY_A, true);
+	litest_drain_events(li);
+
+	status = libinput_device_config_send_events_set_mode(device,
+			LIBINPUT_CONFIG_SEND_EVENTS_DISABLED);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	litest_assert_key_event(li, KEY_A, LIBINPUT_KEY_STATE_RELEASED);
+
+	/* the release is never read by libinput, the resume must resync
+	 * the key state so the next press isn't swallowed */
+	litest_keyboard_key(dev, KEY_A, false);
+
+	status = libinput_device_config_send_events_set_mode(device,
+			LIBINPUT_CONFIG_SEND_EVENTS_ENABLED);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	litest_assert_empty_queue(li);
+
+	litest_keyboard_key(dev, KEY_A, true);
+	litest_keyboard_key(dev, KEY_A, false);
+	libinput_dispatch(li);
+	litest_assert_key_event(li, KEY_A, LIBINPUT_KEY_STATE_PRESSED);
+	litest_assert_key_event(li, KEY_A, LIBINPUT_KEY_STATE_RELEASED);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(device_reenable_events_queued_while_disabled)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	enum libinput_config_status status;
+
+	litest_drain_events(li);
+
+	/* The budget stops after the motion frame, the button press is
+	 * left queued in libevdev when the device is disabled */
+	libinput_dispatch_set_budget(li,
+				     LIBINPUT_DISPATCH_BUDGET_CALL_EVENTS,
+				     2);
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_event(dev, EV_KEY, BTN_LEFT, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	ck_assert_int_eq(libinput_dispatch(li), -EAGAIN);
+
+	status = libinput_device_config_send_events_set_mode(device,
+			LIBINPUT_CONFIG_SEND_EVENTS_DISABLED);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	libinput_dispatch_set_budget(li,
+				     LIBINPUT_DISPATCH_BUDGET_CALL_EVENTS,
+				     0);
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_MOTION);
+
+	/* the release is lost with the fd, the press must not show up
+	 * after the resume */
+	litest_event(dev, EV_KEY, BTN_LEFT, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+
+	status = libinput_device_config_send_events_set_mode(device,
+			LIBINPUT_CONFIG_SEND_EVENTS_ENABLED);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	libinput_dispatch(li);
+	litest_assert_empty_queue(li);
+
+	litest_button_click_debounced(dev, li, BTN_LEFT, true);
+	litest_button_click_debounced(dev, li, BTN_LEFT, false);
+	libinput_dispatch(li);
+	litest_assert_button_event(li,
+				   BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_PRESSED);
+	litest_assert_button_event(li,
+				   BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_RELEASED);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
 START_TEST(device_disable_release_tap)
 {
 	struct litest_device *dev = litest_current_device();
@@ -1496,6 +1618,161 @@ START_TEST(device_seat_phys_name)
 }
 END_TEST
 
+static void
+pairing_touch_move(struct litest_device *touchpad)
+{
+	litest_touch_down(touchpad, 0, 50, 50);
+	litest_touch_move_to(touchpad, 0, 50, 50, 70, 50, 10, 1);
+	litest_touch_up(touchpad, 0);
+}
+
+static void
+pairing_key(struct litest_device *keyboard)
+{
+	litest_keyboard_key(keyboard, KEY_A, true);
+	litest_keyboard_key(keyboard, KEY_A, false);
+}
+
+START_TEST(device_pairing_lid_and_tablet_mode)
+{
+	struct libinput *li;
+	struct litest_device *touchpad, *sw;
+
+	li = litest_create_context();
+
+	/* gpio-keys is both a lid and a tablet mode switch, the touchpad
+	 * must pair with it for both. Once with the touchpad added first,
+	 * once with the switch added first. */
+	for (int order = 0; order < 2; order++) {
+		if (order == 0) {
+			touchpad = litest_add_device(li, LITEST_SYNAPTICS_TOUCHPAD);
+			sw = litest_add_device(li, LITEST_GPIO_KEYS);
+		} else {
+			sw = litest_add_device(li, LITEST_GPIO_KEYS);
+			touchpad = litest_add_device(li, LITEST_SYNAPTICS_TOUCHPAD);
+		}
+		litest_disable_tap(touchpad->libinput_device);
+		litest_drain_events(li);
+
+		litest_switch_action(sw,
+				     LIBINPUT_SWITCH_TABLET_MODE,
+				     LIBINPUT_SWITCH_STATE_ON);
+		litest_drain_events(li);
+		pairing_touch_move(touchpad);
+		litest_assert_empty_queue(li);
+
+		/* opening the lid doesn't resume the touchpad while in
+		 * tablet mode */
+		litest_switch_action(sw,
+				     LIBINPUT_SWITCH_LID,
+				     LIBINPUT_SWITCH_STATE_ON);
+		litest_switch_action(sw,
+				     LIBINPUT_SWITCH_LID,
+				     LIBINPUT_SWITCH_STATE_OFF);
+		litest_drain_events(li);
+		pairing_touch_move(touchpad);
+		litest_assert_empty_queue(li);
+
+		litest_switch_action(sw,
+				     LIBINPUT_SWITCH_TABLET_MODE,
+				     LIBINPUT_SWITCH_STATE_OFF);
+		litest_drain_events(li);
+		pairing_touch_move(touchpad);
+		litest_assert_only_typed_events(li,
+						LIBINPUT_EVENT_POINTER_MOTION);
+
+		litest_delete_device(sw);
+		litest_delete_device(touchpad);
+	}
+
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(device_pairing_internal_keyboard_only)
+{
+	struct libinput *li;
+	struct litest_device *touchpad, *internal, *external, *sw;
+	struct libinput_event *event;
+
+	li = litest_create_context();
+
+	/* Once with the keyboards added first, once with the switch and the
+	 * touchpad added first */
+	for (int order = 0; order < 2; order++) {
+		if (order == 0) {
+			internal = litest_add_device(li, LITEST_KEYBOARD);
+			external = litest_add_device(li, LITEST_KEYBOARD_BLACKWIDOW);
+			sw = litest_add_device(li, LITEST_GPIO_KEYS);
+			touchpad = litest_add_device(li, LITEST_SYNAPTICS_TOUCHPAD);
+		} else {
+			touchpad = litest_add_device(li, LITEST_SYNAPTICS_TOUCHPAD);
+			sw = litest_add_device(li, LITEST_GPIO_KEYS);
+			external = litest_add_device(li, LITEST_KEYBOARD_BLACKWIDOW);
+			internal = litest_add_device(li, LITEST_KEYBOARD);
+		}
+		litest_disable_tap(touchpad->libinput_device);
+		litest_drain_events(li);
+
+		/* tablet mode only suspends the internal keyboard */
+		litest_switch_action(sw,
+				     LIBINPUT_SWITCH_TABLET_MODE,
+				     LIBINPUT_SWITCH_STATE_ON);
+		litest_drain_events(li);
+		pairing_key(internal);
+		litest_assert_empty_queue(li);
+		pairing_key(external);
+		litest_assert_only_typed_events(li,
+						LIBINPUT_EVENT_KEYBOARD_KEY);
+		litest_switch_action(sw,
+				     LIBINPUT_SWITCH_TABLET_MODE,
+				     LIBINPUT_SWITCH_STATE_OFF);
+		litest_drain_events(li);
+
+		/* only the internal keyboard opens the lid */
+		litest_switch_action(sw,
+				     LIBINPUT_SWITCH_LID,
+				     LIBINPUT_SWITCH_STATE_ON);
+		litest_drain_events(li);
+		pairing_key(external);
+		litest_assert_only_typed_events(li,
+						LIBINPUT_EVENT_KEYBOARD_KEY);
+		pairing_key(internal);
+		event = libinput_get_event(li);
+		litest_is_switch_event(event,
+				       LIBINPUT_SWITCH_LID,
+				       LIBINPUT_SWITCH_STATE_OFF);
+		libinput_event_destroy(event);
+		litest_assert_only_typed_events(li,
+						LIBINPUT_EVENT_KEYBOARD_KEY);
+		litest_switch_action(sw,
+				     LIBINPUT_SWITCH_LID,
+				     LIBINPUT_SWITCH_STATE_OFF);
+		litest_drain_events(li);
+
+		/* only the internal keyboard triggers disable-while-typing */
+		pairing_key(external);
+		litest_drain_events(li);
+		pairing_touch_move(touchpad);
+		litest_assert_only_typed_events(li,
+						LIBINPUT_EVENT_POINTER_MOTION);
+		pairing_key(internal);
+		litest_drain_events(li);
+		pairing_touch_move(touchpad);
+		litest_assert_empty_queue(li);
+		litest_timeout_dwt_short();
+		libinput_dispatch(li);
+
+		litest_delete_device(touchpad);
+		litest_delete_device(sw);
+		litest_delete_device(external);
+		litest_delete_device(internal);
+	}
+
+	libinput_unref(li);
+}
+END_TEST
+
 TEST_COLLECTION(device)
 {
 	struct range abs_range = { 0, ABS_MISC };
@@ -1519,6 +1796,9 @@ TEST_COLLECTION(device)
 	litest_add_no_device("device:sendevents", device_reenable_device_removed);
 	litest_add_for_device("device:sendevents", device_disable_release_buttons, LITEST_MOUSE);
 	litest_add_for_device("device:sendevents", device_disable_release_keys, LITEST_KEYBOARD);
+	litest_add_for_device("device:sendevents", device_reenable_resume_stats, LITEST_MOUSE);
+	litest_add_for_device("device:sendevents", device_reenable_key_released_while_disabled, LITEST_KEYBOARD);
+	litest_add_for_device("device:sendevents", device_reenable_events_queued_while_disabled, LITEST_MOUSE);
 	litest_add("device:sendevents", device_disable_release_tap, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add("device:sendevents", device_disable_release_tap_n_drag, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add("device:sendevents", device_disable_release_softbutton, LITEST_CLICKPAD, LITEST_APPLE_CLICKPAD);
@@ -1571,4 +1851,7 @@ TEST_COLLECTION(device)
 	litest_add("device:output", device_no_output, LITEST_KEYS, LITEST_ANY);
 
 	litest_add("device:seat", device_seat_phys_name, LITEST_ANY, LITEST_ANY);
+
+	litest_add_no_device("device:pairing", device_pairing_lid_and_tablet_mode);
+	litest_add_no_device("device:pairing", device_pairing_internal_keyboard_only);
 }
@@ -0,0 +1,313 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Tests for the per-device frame buffer. The kernel terminates a frame
+ * once it exceeds the device's events-per-packet estimate, so a uinput
+ * device cannot send a frame large enough to overflow the buffer. This
+ * links the library objects directly and injects the events instead. */
+
+#include <config.h>
+
+#include <check.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <libudev.h>
+#include <libevdev/libevdev-uinput.h>
+
+#include "libinput.h"
+#include "evdev.h"
+
+#define EXIT_SKIP 77
+
+static struct libevdev_uinput *uinput;
+
+struct frame_context {
+	struct libinput *libinput;
+	struct evdev_device *device;
+	unsigned int overflow_messages;
+};
+
+static int
+open_func(const char *path, int flags, void *data)
+{
+	int fd = open(path, flags);
+
+	return fd < 0 ? -errno : fd;
+}
+
+static void
+close_func(int fd, void *data)
+{
+	close(fd);
+}
+
+static const struct libinput_interface simple_interface = {
+	.open_restricted = open_func,
+	.close_restricted = close_func,
+};
+
+static void
+log_handler(struct libinput *libinput,
+	    enum libinput_log_priority priority,
+	    const char *format,
+	    va_list args)
+{
+	struct frame_context *ctx = libinput_get_user_data(libinput);
+
+	if (strstr(format, "without SYN_REPORT"))
+		ctx->overflow_messages++;
+}
+
+static void
+frame_context_init(struct frame_context *ctx)
+{
+	struct libinput_device *device;
+	struct libinput_event *event;
+
+	memset(ctx, 0, sizeof(*ctx));
+
+	ctx->libinput = libinput_path_create_context(&simple_interface, ctx);
+	ck_assert_notnull(ctx->libinput);
+	libinput_log_set_handler(ctx->libinput, log_handler);
+	libinput_log_set_priority(ctx->libinput, LIBINPUT_LOG_PRIORITY_INFO);
+
+	device = libinput_path_add_device(ctx->libinput,
+					  libevdev_uinput_get_devnode(uinput));
+	ck_assert_notnull(device);
+	ctx->device = evdev_device(device);
+
+	libinput_dispatch(ctx->libinput);
+	while ((event = libinput_get_event(ctx->libinput)))
+		libinput_event_destroy(event);
+}
+
+static uint64_t
+now_usec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return s2us(ts.tv_sec) + ns2us(ts.tv_nsec);
+}
+
+/* nmotion REL_X events followed by a SYN_REPORT */
+static void
+inject_motion(struct frame_context *ctx, size_t nmotion)
+{
+	struct input_event *events;
+	struct timeval time = us2tv(now_usec());
+
+	events = zalloc((nmotion + 1) * sizeof(*events));
+	for (size_t i = 0; i < nmotion; i++) {
+		events[i].time = time;
+		events[i].type = EV_REL;
+		events[i].code = REL_X;
+		events[i].value = 1;
+	}
+	events[nmotion].time = time;
+	events[nmotion].type = EV_SYN;
+	events[nmotion].code = SYN_REPORT;
+
+	evdev_device_inject_events(ctx->device, events, nmotion + 1);
+	free(events);
+}
+
+static unsigned int
+count_motion(struct frame_context *ctx, double *dx)
+{
+	struct libinput_event *event;
+	unsigned int nmotion = 0;
+
+	*dx = 0;
+
+	libinput_dispatch(ctx->libinput);
+	while ((event = libinput_get_event(ctx->libinput))) {
+		struct libinput_event_pointer *p;
+
+		ck_assert_int_eq(libinput_event_get_type(event),
+				 LIBINPUT_EVENT_POINTER_MOTION);
+		p = libinput_event_get_pointer_event(event);
+		*dx += libinput_event_pointer_get_dx_unaccelerated(p);
+		nmotion++;
+		libinput_event_destroy(event);
+	}
+
+	return nmotion;
+}
+
+static uint64_t
+frames(struct frame_context *ctx)
+{
+	return libinput_device_get_counter(&ctx->device->base,
+					   LIBINPUT_DEVICE_COUNTER_FRAMES);
+}
+
+START_TEST(frame_grow)
+{
+	struct frame_context ctx;
+	const size_t nmotion = EVDEV_FRAME_MIN_EVENTS * 4;
+	uint64_t nframes;
+	double dx;
+
+	frame_context_init(&ctx);
+	ck_assert_int_eq(ctx.device->frame.size, EVDEV_FRAME_MIN_EVENTS);
+
+	/* The buffer grows to fit the frame, it is still a single frame */
+	nframes = frames(&ctx);
+	inject_motion(&ctx, nmotion);
+	ck_assert_int_eq(count_motion(&ctx, &dx), 1);
+	ck_assert_double_eq(dx, nmotion);
+	ck_assert_int_eq(frames(&ctx), nframes + 1);
+	ck_assert_int_gt(ctx.device->frame.size, nmotion);
+	ck_assert_int_le(ctx.device->frame.size, EVDEV_FRAME_MAX_EVENTS);
+	ck_assert_int_eq(ctx.overflow_messages, 0);
+
+	libinput_unref(ctx.libinput);
+}
+END_TEST
+
+START_TEST(frame_overflow)
+{
+	struct frame_context ctx;
+	const size_t nmotion = EVDEV_FRAME_MAX_EVENTS + 100;
+	uint64_t nframes;
+	double dx;
+
+	frame_context_init(&ctx);
+
+	/* The full buffer is processed as a frame of its own with a
+	 * synthetic SYN_REPORT, no event is lost */
+	nframes = frames(&ctx);
+	inject_motion(&ctx, nmotion);
+	ck_assert_int_eq(count_motion(&ctx, &dx), 2);
+	ck_assert_double_eq(dx, nmotion);
+	ck_assert_int_eq(frames(&ctx), nframes + 2);
+	ck_assert_int_eq(ctx.device->frame.size, EVDEV_FRAME_MAX_EVENTS);
+	ck_assert_int_eq(ctx.overflow_messages, 1);
+
+	/* And the next frame is processed normally */
+	inject_motion(&ctx, 1);
+	ck_assert_int_eq(count_motion(&ctx, &dx), 1);
+	ck_assert_double_eq(dx, 1);
+	ck_assert_int_eq(frames(&ctx), nframes + 3);
+
+	libinput_unref(ctx.libinput);
+}
+END_TEST
+
+static Suite *
+frame_suite(void)
+{
+	TCase *tc;
+	Suite *s;
+
+	s = suite_create("frame");
+
+	tc = tcase_create("buffer");
+	tcase_add_test(tc, frame_grow);
+	tcase_add_test(tc, frame_overflow);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
+
+/* The path backend needs the udev properties, so wait for udev to
+ * process the new device node */
+static bool
+wait_for_udev(const char *devnode)
+{
+	struct udev *udev;
+	struct stat st;
+	bool initialized = false;
+
+	if (stat(devnode, &st) != 0)
+		return false;
+
+	udev = udev_new();
+	for (int i = 0; i < 500 && !initialized; i++) {
+		struct udev_device *d;
+
+		d = udev_device_new_from_devnum(udev, 'c', st.st_rdev);
+		if (d) {
+			initialized = udev_device_get_is_initialized(d);
+			udev_device_unref(d);
+		}
+		if (!initialized)
+			usleep(10000);
+	}
+	udev_unref(udev);
+
+	return initialized;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct libevdev *dev;
+	int nfailed;
+	Suite *s;
+	SRunner *sr;
+	int rc;
+
+	dev = libevdev_new();
+	libevdev_set_name(dev, "frame test mouse");
+	libevdev_set_id_bustype(dev, BUS_USB);
+	libevdev_enable_event_code(dev, EV_REL, REL_X, NULL);
+	libevdev_enable_event_code(dev, EV_REL, REL_Y, NULL);
+	libevdev_enable_event_code(dev, EV_KEY, BTN_LEFT, NULL);
+	libevdev_enable_event_code(dev, EV_KEY, BTN_RIGHT, NULL);
+
+	rc = libevdev_uinput_create_from_device(dev,
+						LIBEVDEV_UINPUT_OPEN_MANAGED,
+						&uinput);
+	libevdev_free(dev);
+	if (rc != 0) {
+		fprintf(stderr,
+			"Failed to create uinput device (%s), skipping\n",
+			strerror(-rc));
+		return EXIT_SKIP;
+	}
+
+	if (!wait_for_udev(libevdev_uinput_get_devnode(uinput))) {
+		libevdev_uinput_destroy(uinput);
+		return EXIT_SKIP;
+	}
+
+	s = frame_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_ENV);
+	nfailed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	libevdev_uinput_destroy(uinput);
+
+	return (nfailed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -541,6 +541,155 @@ START_TEST(event_conversion_switch)
 }
 END_TEST
 
+START_TEST(event_batch_get)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *events[16];
+	struct libinput_event_keyboard *kev;
+	const unsigned int keys[] = { KEY_A, KEY_B, KEY_C, KEY_D, KEY_E };
+	size_t count;
+
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_get_events(li, events, ARRAY_LENGTH(events)), 0);
+
+	for (int i = 0; i < 3; i++) {
+		litest_keyboard_key(dev, keys[i], true);
+		litest_keyboard_key(dev, keys[i], false);
+	}
+	libinput_dispatch(li);
+
+	count = libinput_get_events(li, events, 4);
+	ck_assert_int_eq(count, 4);
+	for (size_t i = 0; i < count; i++) {
+		kev = litest_is_keyboard_event(events[i],
+					       keys[i/2],
+					       i % 2 ?
+					       LIBINPUT_KEY_STATE_RELEASED :
+					       LIBINPUT_KEY_STATE_PRESSED);
+		ck_assert_notnull(kev);
+	}
+	libinput_event_destroy_array(events, count);
+
+	/* queue more events so the ring buffer wraps around */
+	for (int i = 3; i < 5; i++) {
+		litest_keyboard_key(dev, keys[i], true);
+		litest_keyboard_key(dev, keys[i], false);
+	}
+	libinput_dispatch(li);
+
+	count = libinput_get_events(li, events, ARRAY_LENGTH(events));
+	ck_assert_int_eq(count, 6);
+	for (size_t i = 0; i < count; i++) {
+		kev = litest_is_keyboard_event(events[i],
+					       keys[(i + 4)/2],
+					       i % 2 ?
+					       LIBINPUT_KEY_STATE_RELEASED :
+					       LIBINPUT_KEY_STATE_PRESSED);
+		ck_assert_notnull(kev);
+	}
+	libinput_event_destroy_array(events, count);
+
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(event_pool_recycle)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	uint64_t allocated, recycled;
+
+	litest_drain_events(li);
+
+	litest_button_click_debounced(dev, li, BTN_LEFT, true);
+	litest_drain_events(li);
+
+	allocated = libinput_event_pool_get_counter(li,
+					LIBINPUT_EVENT_POINTER_BUTTON,
+					LIBINPUT_EVENT_POOL_COUNTER_ALLOCATED);
+	recycled = libinput_event_pool_get_counter(li,
+					LIBINPUT_EVENT_POINTER_BUTTON,
+					LIBINPUT_EVENT_POOL_COUNTER_RECYCLED);
+	ck_assert_int_gt(allocated, 0);
+
+	/* One event at a time, each event must re-use the previous one */
+	for (int i = 0; i < 5; i++) {
+		litest_button_click_debounced(dev, li, BTN_LEFT, false);
+		litest_drain_events(li);
+		litest_button_click_debounced(dev, li, BTN_LEFT, true);
+		litest_drain_events(li);
+	}
+
+	litest_button_click_debounced(dev, li, BTN_LEFT, false);
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_event_pool_get_counter(li,
+					LIBINPUT_EVENT_POINTER_BUTTON,
+					LIBINPUT_EVENT_POOL_COUNTER_ALLOCATED),
+			 allocated);
+	ck_assert_int_eq(libinput_event_pool_get_counter(li,
+					LIBINPUT_EVENT_POINTER_BUTTON,
+					LIBINPUT_EVENT_POOL_COUNTER_RECYCLED),
+			 recycled + 11);
+
+	/* All pointer events share the same pool */
+	ck_assert_int_eq(libinput_event_pool_get_counter(li,
+					LIBINPUT_EVENT_POINTER_MOTION,
+					LIBINPUT_EVENT_POOL_COUNTER_RECYCLED),
+			 recycled + 11);
+	ck_assert_int_ge(libinput_event_pool_get_counter(li,
+					LIBINPUT_EVENT_POINTER_MOTION,
+					LIBINPUT_EVENT_POOL_COUNTER_PEAK),
+			 1);
+}
+END_TEST
+
+START_TEST(event_pool_limit)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	uint64_t allocated, recycled;
+
+	ck_assert_int_eq(libinput_event_pool_get_limit(li), 64);
+	libinput_event_pool_set_limit(li, 0);
+	ck_assert_int_eq(libinput_event_pool_get_limit(li), 0);
+
+	litest_drain_events(li);
+
+	allocated = libinput_event_pool_get_counter(li,
+					LIBINPUT_EVENT_KEYBOARD_KEY,
+					LIBINPUT_EVENT_POOL_COUNTER_ALLOCATED);
+	recycled = libinput_event_pool_get_counter(li,
+					LIBINPUT_EVENT_KEYBOARD_KEY,
+					LIBINPUT_EVENT_POOL_COUNTER_RECYCLED);
+
+	for (int i = 0; i < 5; i++) {
+		litest_keyboard_key(dev, KEY_A, true);
+		litest_keyboard_key(dev, KEY_A, false);
+		libinput_dispatch(li);
+		litest_drain_events(li);
+	}
+
+	ck_assert_int_eq(libinput_event_pool_get_counter(li,
+					LIBINPUT_EVENT_KEYBOARD_KEY,
+					LIBINPUT_EVENT_POOL_COUNTER_ALLOCATED),
+			 allocated + 10);
+	ck_assert_int_eq(libinput_event_pool_get_counter(li,
+					LIBINPUT_EVENT_KEYBOARD_KEY,
+					LIBINPUT_EVENT_POOL_COUNTER_RECYCLED),
+			 recycled);
+
+	litest_disable_log_handler(li);
+	ck_assert_int_eq(libinput_event_pool_get_counter(li,
+					LIBINPUT_EVENT_NONE,
+					LIBINPUT_EVENT_POOL_COUNTER_PEAK),
+			 0);
+	litest_restore_log_handler(li);
+}
+END_TEST
+
 START_TEST(bitfield_helpers)
 {
 	/* This value has a bit set on all of the word boundaries we want to
@@ -1695,6 +1844,763 @@ START_TEST(timer_flush)
 }
 END_TEST
 
+START_TEST(timer_lazy_rearm)
+{
+	struct libinput *li;
+	struct litest_device *keyboard, *touchpad;
+	uint64_t count;
+
+	li = litest_create_context();
+
+	touchpad = litest_add_device(li, LITEST_SYNAPTICS_TOUCHPAD);
+	keyboard = litest_add_device(li, LITEST_KEYBOARD);
+	libinput_dispatch(li);
+	litest_drain_events(li);
+
+	count = libinput_get_counter(li, LIBINPUT_COUNTER_TIMERFD_SETTIME);
+
+	/* Every key press pushes the dwt timer back, this must not
+	 * re-program the timerfd every time */
+	for (int i = 0; i < 20; i++) {
+		litest_keyboard_key(keyboard, KEY_A, true);
+		litest_keyboard_key(keyboard, KEY_A, false);
+		libinput_dispatch(li);
+	}
+
+	ck_assert_int_lt(libinput_get_counter(li,
+					      LIBINPUT_COUNTER_TIMERFD_SETTIME),
+			 count + 20);
+
+	/* The timerfd fires for the original expiry and must be
+	 * re-programmed for the moved one, dwt must still time out */
+	litest_timeout_dwt_long();
+	libinput_dispatch(li);
+	litest_drain_events(li);
+
+	litest_touch_down(touchpad, 0, 50, 50);
+	litest_touch_move_to(touchpad, 0, 50, 50, 70, 50, 10, 0);
+	litest_touch_up(touchpad, 0);
+	libinput_dispatch(li);
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_MOTION);
+
+	litest_delete_device(keyboard);
+	litest_delete_device(touchpad);
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(event_coalesce_motion)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	uint64_t count;
+
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_get_event_coalescing(li), 0);
+	libinput_set_event_coalescing(li, 1);
+	ck_assert_int_eq(libinput_get_event_coalescing(li), 1);
+
+	count = libinput_get_counter(li, LIBINPUT_COUNTER_EVENTS_COALESCED);
+
+	for (int i = 0; i < 5; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_motion_event(event);
+	ck_assert_double_eq(libinput_event_pointer_get_dx_unaccelerated(ptrev),
+			    5.0);
+	ck_assert_double_eq(libinput_event_pointer_get_dy_unaccelerated(ptrev),
+			    0.0);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	ck_assert_int_eq(libinput_get_counter(li,
+					      LIBINPUT_COUNTER_EVENTS_COALESCED),
+			 count + 4);
+
+	/* a button event in between stops coalescing */
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_button_click_debounced(dev, li, BTN_LEFT, true);
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	litest_is_motion_event(event);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_button_event(event,
+			       BTN_LEFT,
+			       LIBINPUT_BUTTON_STATE_PRESSED);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_motion_event(event);
+	libinput_event_destroy(event);
+
+	litest_button_click_debounced(dev, li, BTN_LEFT, false);
+	litest_drain_events(li);
+
+	libinput_set_event_coalescing(li, 0);
+	for (int i = 0; i < 5; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	for (int i = 0; i < 5; i++) {
+		event = libinput_get_event(li);
+		litest_is_motion_event(event);
+		libinput_event_destroy(event);
+	}
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(event_coalesce_wheel)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	enum libinput_pointer_axis axis = LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL;
+
+	litest_drain_events(li);
+	libinput_set_event_coalescing(li, 1);
+
+	for (int i = 0; i < 3; i++) {
+		litest_event(dev, EV_REL, REL_WHEEL, -1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_axis_event(event,
+				     axis,
+				     LIBINPUT_POINTER_AXIS_SOURCE_WHEEL);
+	ck_assert_double_eq(libinput_event_pointer_get_axis_value_discrete(ptrev,
+									   axis),
+			    3.0);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+static unsigned int watermark_depth;
+
+static void
+watermark_handler(struct libinput *libinput, unsigned int depth)
+{
+	ck_assert_int_eq(watermark_depth, 0);
+	watermark_depth = depth;
+}
+
+START_TEST(event_queue_limit)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	uint64_t dropped;
+
+	litest_drain_events(li);
+
+	watermark_depth = 0;
+	libinput_set_event_queue_limit(li, 3);
+	ck_assert_int_eq(libinput_get_event_queue_limit(li), 3);
+	libinput_set_event_queue_watermark(li, 2, watermark_handler);
+
+	dropped = libinput_get_counter(li, LIBINPUT_COUNTER_EVENTS_DROPPED);
+
+	for (int i = 0; i < 5; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	ck_assert_int_eq(watermark_depth, 2);
+	ck_assert_int_eq(libinput_get_counter(li,
+					      LIBINPUT_COUNTER_EVENTS_DROPPED),
+			 dropped + 2);
+	ck_assert_int_ge(libinput_get_counter(li,
+					      LIBINPUT_COUNTER_EVENT_QUEUE_PEAK),
+			 3);
+
+	/* the button event pushes out the oldest motion event */
+	litest_button_click_debounced(dev, li, BTN_LEFT, true);
+	libinput_dispatch(li);
+
+	ck_assert_int_eq(libinput_get_counter(li,
+					      LIBINPUT_COUNTER_EVENTS_DROPPED),
+			 dropped + 3);
+
+	event = libinput_get_event(li);
+	litest_is_motion_event(event);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_motion_event(event);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_button_event(event,
+			       BTN_LEFT,
+			       LIBINPUT_BUTTON_STATE_PRESSED);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	/* button events are never dropped */
+	watermark_depth = 0;
+	libinput_set_event_queue_limit(li, 1);
+	litest_button_click_debounced(dev, li, BTN_LEFT, false);
+	litest_button_click_debounced(dev, li, BTN_RIGHT, true);
+	litest_button_click_debounced(dev, li, BTN_RIGHT, false);
+	libinput_dispatch(li);
+
+	ck_assert_int_eq(libinput_get_counter(li,
+					      LIBINPUT_COUNTER_EVENTS_DROPPED),
+			 dropped + 3);
+	ck_assert_int_eq(watermark_depth, 2);
+	event = libinput_get_event(li);
+	litest_is_button_event(event,
+			       BTN_LEFT,
+			       LIBINPUT_BUTTON_STATE_RELEASED);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_button_event(event,
+			       BTN_RIGHT,
+			       LIBINPUT_BUTTON_STATE_PRESSED);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_button_event(event,
+			       BTN_RIGHT,
+			       LIBINPUT_BUTTON_STATE_RELEASED);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	libinput_set_event_queue_limit(li, 0);
+	libinput_set_event_queue_watermark(li, 0, NULL);
+}
+END_TEST
+
+static void
+post_motion_events(struct litest_device *dev, int count)
+{
+	for (int i = 0; i < count; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(dev->libinput);
+}
+
+START_TEST(event_queue_limit_drop_behind_buttons)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	uint64_t dropped;
+
+	litest_drain_events(li);
+
+	libinput_set_event_queue_limit(li, 3);
+	dropped = libinput_get_counter(li, LIBINPUT_COUNTER_EVENTS_DROPPED);
+
+	/* the motion events behind the button event get dropped */
+	litest_button_click_debounced(dev, li, BTN_LEFT, true);
+	post_motion_events(dev, 3);
+	litest_button_click_debounced(dev, li, BTN_LEFT, false);
+	post_motion_events(dev, 2);
+
+	ck_assert_int_eq(libinput_get_counter(li,
+					      LIBINPUT_COUNTER_EVENTS_DROPPED),
+			 dropped + 4);
+
+	event = libinput_get_event(li);
+	litest_is_button_event(event,
+			       BTN_LEFT,
+			       LIBINPUT_BUTTON_STATE_PRESSED);
+	libinput_event_destroy(event);
+
+	/* one known undroppable event left at the head */
+	litest_button_click_debounced(dev, li, BTN_RIGHT, true);
+	post_motion_events(dev, 1);
+
+	ck_assert_int_eq(libinput_get_counter(li,
+					      LIBINPUT_COUNTER_EVENTS_DROPPED),
+			 dropped + 5);
+
+	event = libinput_get_event(li);
+	litest_is_button_event(event,
+			       BTN_LEFT,
+			       LIBINPUT_BUTTON_STATE_RELEASED);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_button_event(event,
+			       BTN_RIGHT,
+			       LIBINPUT_BUTTON_STATE_PRESSED);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_motion_event(event);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	litest_button_click_debounced(dev, li, BTN_RIGHT, false);
+	litest_drain_events(li);
+	libinput_set_event_queue_limit(li, 0);
+}
+END_TEST
+
+START_TEST(dispatch_budget_call_events)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	int nevents = 0;
+	int rc;
+
+	litest_drain_events(li);
+
+	/* a key frame is EV_KEY + SYN_REPORT */
+	libinput_dispatch_set_budget(li,
+				     LIBINPUT_DISPATCH_BUDGET_CALL_EVENTS,
+				     2);
+	ck_assert_int_eq(libinput_dispatch_get_budget(li,
+				LIBINPUT_DISPATCH_BUDGET_CALL_EVENTS),
+			 2);
+
+	for (int i = 0; i < 3; i++) {
+		litest_keyboard_key(dev, KEY_A, true);
+		litest_keyboard_key(dev, KEY_A, false);
+	}
+
+	/* one frame per dispatch call, the last call may find nothing */
+	for (int i = 0; i < 7; i++) {
+		rc = libinput_dispatch(li);
+		ck_assert(rc == 0 || rc == -EAGAIN);
+
+		event = libinput_get_event(li);
+		if (event) {
+			litest_is_keyboard_event(event,
+						 KEY_A,
+						 nevents % 2 ?
+						 LIBINPUT_KEY_STATE_RELEASED :
+						 LIBINPUT_KEY_STATE_PRESSED);
+			libinput_event_destroy(event);
+			nevents++;
+		}
+		ck_assert_int_eq(libinput_next_event_type(li),
+				 LIBINPUT_EVENT_NONE);
+
+		if (rc == 0)
+			break;
+	}
+
+	ck_assert_int_eq(rc, 0);
+	ck_assert_int_eq(nevents, 6);
+
+	libinput_dispatch_set_budget(li,
+				     LIBINPUT_DISPATCH_BUDGET_CALL_EVENTS,
+				     0);
+	litest_keyboard_key(dev, KEY_A, true);
+	litest_keyboard_key(dev, KEY_A, false);
+	ck_assert_int_eq(libinput_dispatch(li), 0);
+	ck_assert_int_eq(libinput_next_event_type(li),
+			 LIBINPUT_EVENT_KEYBOARD_KEY);
+	litest_drain_events(li);
+}
+END_TEST
+
+START_TEST(dispatch_budget_round_robin)
+{
+	struct libinput *li;
+	struct litest_device *kbd1, *kbd2;
+	struct libinput_event *event;
+	struct libinput_device *last = NULL;
+	int nevents = 0;
+
+	li = litest_create_context();
+
+	kbd1 = litest_add_device(li, LITEST_KEYBOARD);
+	kbd2 = litest_add_device(li, LITEST_KEYBOARD);
+	litest_drain_events(li);
+
+	libinput_dispatch_set_budget(li,
+				     LIBINPUT_DISPATCH_BUDGET_SOURCE_EVENTS,
+				     2);
+
+	for (int i = 0; i < 2; i++) {
+		litest_keyboard_key(kbd1, KEY_A, true);
+		litest_keyboard_key(kbd1, KEY_A, false);
+		litest_keyboard_key(kbd2, KEY_B, true);
+		litest_keyboard_key(kbd2, KEY_B, false);
+	}
+
+	/* no per-call budget, so everything is processed in one call but
+	 * the devices take turns */
+	ck_assert_int_eq(libinput_dispatch(li), 0);
+
+	while ((event = libinput_get_event(li))) {
+		ck_assert_int_eq(libinput_event_get_type(event),
+				 LIBINPUT_EVENT_KEYBOARD_KEY);
+		ck_assert(libinput_event_get_device(event) != last);
+		last = libinput_event_get_device(event);
+		libinput_event_destroy(event);
+		nevents++;
+	}
+	ck_assert_int_eq(nevents, 8);
+
+	litest_delete_device(kbd1);
+	litest_delete_device(kbd2);
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(device_stats)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	uint64_t frames, input_events, motion, posted;
+
+	litest_drain_events(li);
+
+	frames = libinput_device_get_counter(device,
+					     LIBINPUT_DEVICE_COUNTER_FRAMES);
+	input_events = libinput_device_get_counter(device,
+						   LIBINPUT_DEVICE_COUNTER_INPUT_EVENTS);
+	posted = libinput_device_get_counter(device,
+					     LIBINPUT_DEVICE_COUNTER_EVENTS_POSTED);
+	motion = libinput_device_get_event_counter(device,
+						   LIBINPUT_EVENT_POINTER_MOTION);
+
+	for (int i = 0; i < 5; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+		libinput_dispatch(li);
+	}
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_device_get_counter(device,
+						     LIBINPUT_DEVICE_COUNTER_FRAMES),
+			 frames + 5);
+	ck_assert_int_eq(libinput_device_get_counter(device,
+						     LIBINPUT_DEVICE_COUNTER_INPUT_EVENTS),
+			 input_events + 10);
+	ck_assert_int_eq(libinput_device_get_counter(device,
+						     LIBINPUT_DEVICE_COUNTER_EVENTS_POSTED),
+			 posted + 5);
+	ck_assert_int_eq(libinput_device_get_event_counter(device,
+							   LIBINPUT_EVENT_POINTER_MOTION),
+			 motion + 5);
+	ck_assert_int_eq(libinput_device_get_counter(device,
+						     LIBINPUT_DEVICE_COUNTER_SYN_DROPPED),
+			 0);
+
+	ck_assert_int_ge(libinput_get_device_counter(li,
+						     LIBINPUT_DEVICE_COUNTER_FRAMES),
+			 frames + 5);
+	ck_assert_int_ge(libinput_get_event_counter(li,
+						    LIBINPUT_EVENT_POINTER_MOTION),
+			 motion + 5);
+
+	/* invalid counters and event types are rejected */
+	litest_disable_log_handler(li);
+	ck_assert_int_eq(libinput_device_get_counter(device, 0), 0);
+	ck_assert_int_eq(libinput_device_get_event_counter(device, 9999), 0);
+	litest_restore_log_handler(li);
+}
+END_TEST
+
+START_TEST(device_stats_syn_dropped)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput_event *event;
+	struct libevdev *evdev;
+	struct input_event ev;
+	uint64_t input_events, nread = 0;
+	int npressed = 0, nreleased = 0;
+	int fd, rc;
+
+	litest_drain_events(li);
+
+	/* Overflow the kernel's buffer with a button held down, the
+	 * release is only seen in the resync after the SYN_DROPPED */
+	litest_button_click_debounced(dev, li, BTN_LEFT, true);
+
+	/* A second reader with an empty buffer sees the same overflow and
+	 * tells us how many events libinput reads */
+	fd = open(libevdev_uinput_get_devnode(dev->uinput),
+		  O_RDONLY|O_NONBLOCK);
+	ck_assert_int_ge(fd, 0);
+	ck_assert_int_eq(libevdev_new_from_fd(fd, &evdev), 0);
+	input_events = libinput_device_get_counter(device,
+						   LIBINPUT_DEVICE_COUNTER_INPUT_EVENTS);
+
+	for (int i = 0; i < 1000; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	litest_button_click(dev, BTN_LEFT, false);
+
+	litest_disable_log_handler(li);
+	libinput_dispatch(li);
+	litest_restore_log_handler(li);
+	litest_timeout_debounce();
+	libinput_dispatch(li);
+
+	ck_assert_int_gt(libinput_device_get_counter(device,
+						     LIBINPUT_DEVICE_COUNTER_SYN_DROPPED),
+			 0);
+
+	/* The SYN_DROPPED itself isn't counted, the resync events are */
+	do {
+		rc = libevdev_next_event(evdev, LIBEVDEV_READ_FLAG_NORMAL, &ev);
+		if (rc == LIBEVDEV_READ_STATUS_SYNC) {
+			do {
+				rc = libevdev_next_event(evdev,
+							 LIBEVDEV_READ_FLAG_SYNC,
+							 &ev);
+				if (rc >= 0)
+					nread++;
+			} while (rc == LIBEVDEV_READ_STATUS_SYNC);
+			rc = LIBEVDEV_READ_STATUS_SUCCESS;
+		} else if (rc == LIBEVDEV_READ_STATUS_SUCCESS) {
+			nread++;
+		}
+	} while (rc == LIBEVDEV_READ_STATUS_SUCCESS);
+	libevdev_free(evdev);
+	close(fd);
+
+	ck_assert_int_eq(libinput_device_get_counter(device,
+						     LIBINPUT_DEVICE_COUNTER_INPUT_EVENTS),
+			 input_events + nread);
+
+	while ((event = libinput_get_event(li))) {
+		struct libinput_event_pointer *p;
+
+		if (libinput_event_get_type(event) ==
+		    LIBINPUT_EVENT_POINTER_BUTTON) {
+			p = libinput_event_get_pointer_event(event);
+			ck_assert_int_eq(libinput_event_pointer_get_button(p),
+					 BTN_LEFT);
+			if (libinput_event_pointer_get_button_state(p) ==
+			    LIBINPUT_BUTTON_STATE_PRESSED)
+				npressed++;
+			else
+				nreleased++;
+		}
+		libinput_event_destroy(event);
+	}
+	ck_assert_int_eq(npressed, 1);
+	ck_assert_int_eq(nreleased, 1);
+
+	/* back to one event per frame */
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	litest_is_motion_event(event);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(device_stats_gesture_tap)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput_event *event;
+	uint64_t tap_end;
+	int received = 0;
+
+	litest_disable_tap(device);
+	litest_drain_events(li);
+
+	/* LIBINPUT_EVENT_GESTURE_TAP_END is the 9th type of its group */
+	tap_end = libinput_device_get_event_counter(device,
+						    LIBINPUT_EVENT_GESTURE_TAP_END);
+
+	litest_touch_down(dev, 0, 40, 50);
+	litest_touch_down(dev, 1, 60, 50);
+	libinput_dispatch(li);
+	litest_touch_up(dev, 0);
+	litest_touch_up(dev, 1);
+	libinput_dispatch(li);
+
+	while ((event = libinput_get_event(li))) {
+		if (libinput_event_get_type(event) ==
+		    LIBINPUT_EVENT_GESTURE_TAP_END)
+			received++;
+		libinput_event_destroy(event);
+	}
+
+	ck_assert_int_gt(received, 0);
+	ck_assert_int_eq(libinput_device_get_event_counter(device,
+							   LIBINPUT_EVENT_GESTURE_TAP_END),
+			 tap_end + received);
+	ck_assert_int_ge(libinput_get_event_counter(li,
+						    LIBINPUT_EVENT_GESTURE_TAP_END),
+			 tap_end + received);
+}
+END_TEST
+
+static uint64_t
+latency_histogram_count(struct libinput_device *device,
+			enum libinput_event_type type,
+			enum libinput_latency_stage stage)
+{
+	uint64_t buckets[64];
+	size_t nbuckets;
+	uint64_t count = 0;
+
+	nbuckets = libinput_device_get_latency_histogram(device,
+							 type,
+							 stage,
+							 buckets,
+							 ARRAY_LENGTH(buckets));
+	ck_assert_int_gt(nbuckets, 0);
+	ck_assert_int_le(nbuckets, ARRAY_LENGTH(buckets));
+
+	for (size_t i = 0; i < nbuckets; i++)
+		count += buckets[i];
+
+	return count;
+}
+
+START_TEST(latency_tracing)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	enum libinput_config_status status;
+	struct libinput_event *event;
+
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_get_latency_tracing(li), 0);
+
+	/* nothing is recorded while tracing is disabled */
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_drain_events(li);
+	ck_assert_int_eq(latency_histogram_count(device,
+						 LIBINPUT_EVENT_POINTER_MOTION,
+						 LIBINPUT_LATENCY_STAGE_QUEUE),
+			 0);
+
+	libinput_set_latency_tracing(li, 1);
+	ck_assert_int_ne(libinput_get_latency_tracing(li), 0);
+
+	for (int i = 0; i < 3; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+		libinput_dispatch(li);
+	}
+
+	while ((event = libinput_get_event(li))) {
+		litest_is_motion_event(event);
+		libinput_event_destroy(event);
+	}
+
+	ck_assert_int_eq(latency_histogram_count(device,
+						 LIBINPUT_EVENT_POINTER_MOTION,
+						 LIBINPUT_LATENCY_STAGE_KERNEL),
+			 3);
+	ck_assert_int_eq(latency_histogram_count(device,
+						 LIBINPUT_EVENT_POINTER_MOTION,
+						 LIBINPUT_LATENCY_STAGE_PROCESSING),
+			 3);
+	ck_assert_int_eq(latency_histogram_count(device,
+						 LIBINPUT_EVENT_POINTER_MOTION,
+						 LIBINPUT_LATENCY_STAGE_QUEUE),
+			 3);
+	ck_assert_int_eq(latency_histogram_count(device,
+						 LIBINPUT_EVENT_POINTER_MOTION,
+						 LIBINPUT_LATENCY_STAGE_HOLD),
+			 0);
+
+	/* a button press held back for middle button emulation is
+	 * recorded as hold time */
+	status = libinput_device_config_middle_emulation_set_enabled(
+					    device,
+					    LIBINPUT_CONFIG_MIDDLE_EMULATION_ENABLED);
+	if (status == LIBINPUT_CONFIG_STATUS_SUCCESS) {
+		litest_button_click_debounced(dev, li, BTN_LEFT, true);
+		litest_assert_empty_queue(li);
+		litest_timeout_middlebutton();
+		litest_assert_button_event(li,
+					   BTN_LEFT,
+					   LIBINPUT_BUTTON_STATE_PRESSED);
+
+		ck_assert_int_ge(latency_histogram_count(device,
+							 LIBINPUT_EVENT_POINTER_BUTTON,
+							 LIBINPUT_LATENCY_STAGE_HOLD),
+				 1);
+		ck_assert_int_ge(latency_histogram_count(device,
+							 LIBINPUT_EVENT_POINTER_BUTTON,
+							 LIBINPUT_LATENCY_STAGE_QUEUE),
+				 1);
+
+		litest_button_click_debounced(dev, li, BTN_LEFT, false);
+		litest_drain_events(li);
+	}
+
+	litest_disable_log_handler(li);
+	ck_assert_int_eq(libinput_device_get_latency_histogram(device,
+							       LIBINPUT_EVENT_POINTER_MOTION,
+							       0,
+							       NULL,
+							       0),
+			 0);
+	litest_restore_log_handler(li);
+
+	libinput_set_latency_tracing(li, 0);
+}
+END_TEST
+
+START_TEST(latency_tracing_gesture_tap)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput_event *event;
+	int received = 0;
+
+	litest_disable_tap(device);
+	litest_drain_events(li);
+
+	libinput_set_latency_tracing(li, 1);
+
+	litest_touch_down(dev, 0, 40, 50);
+	litest_touch_down(dev, 1, 60, 50);
+	libinput_dispatch(li);
+	litest_touch_up(dev, 0);
+	litest_touch_up(dev, 1);
+	libinput_dispatch(li);
+
+	while ((event = libinput_get_event(li))) {
+		if (libinput_event_get_type(event) ==
+		    LIBINPUT_EVENT_GESTURE_TAP_END)
+			received++;
+		libinput_event_destroy(event);
+	}
+
+	ck_assert_int_gt(received, 0);
+	ck_assert_int_eq(latency_histogram_count(device,
+						 LIBINPUT_EVENT_GESTURE_TAP_END,
+						 LIBINPUT_LATENCY_STAGE_QUEUE),
+			 received);
+
+	libinput_set_latency_tracing(li, 0);
+}
+END_TEST
+
 START_TEST(list_test_insert)
 {
 	struct list_test {
@@ -1768,6 +2674,9 @@ TEST_COLLECTION(misc)
 	litest_add_for_device("events:conversion", event_conversion_tablet, LITEST_WACOM_CINTIQ);
 	litest_add_for_device("events:conversion", event_conversion_tablet_pad, LITEST_WACOM_INTUOS5_PAD);
 	litest_add_for_device("events:conversion", event_conversion_switch, LITEST_LID_SWITCH);
+	litest_add_for_device("events:batch", event_batch_get, LITEST_KEYBOARD);
+	litest_add_for_device("events:pool", event_pool_recycle, LITEST_MOUSE);
+	litest_add_for_device("events:pool", event_pool_limit, LITEST_KEYBOARD);
 	litest_add_no_device("misc:bitfield_helpers", bitfield_helpers);
 
 	litest_add_no_device("context:refcount", context_ref_counting);
@@ -1775,6 +2684,18 @@ TEST_COLLECTION(misc)
 
 	litest_add_for_device("timer:offset-warning", timer_offset_bug_warning, LITEST_SYNAPTICS_TOUCHPAD);
 	litest_add_no_device("timer:flush", timer_flush);
+	litest_add_no_device("timer:lazy-rearm", timer_lazy_rearm);
+	litest_add_for_device("events:coalesce", event_coalesce_motion, LITEST_MOUSE);
+	litest_add_for_device("events:coalesce", event_coalesce_wheel, LITEST_MOUSE);
+	litest_add_for_device("events:queue", event_queue_limit, LITEST_MOUSE);
+	litest_add_for_device("events:queue", event_queue_limit_drop_behind_buttons, LITEST_MOUSE);
+	litest_add_for_device("dispatch:budget", dispatch_budget_call_events, LITEST_KEYBOARD);
+	litest_add_no_device("dispatch:budget", dispatch_budget_round_robin);
+	litest_add_for_device("device:stats", device_stats, LITEST_MOUSE);
+	litest_add_for_device("device:stats", device_stats_syn_dropped, LITEST_MOUSE);
+	litest_add_for_device("device:stats", device_stats_gesture_tap, LITEST_BCM5974);
+	litest_add_for_device("device:latency", latency_tracing, LITEST_MOUSE);
+	litest_add_for_device("device:latency", latency_tracing_gesture_tap, LITEST_BCM5974);
 
 	litest_add_no_device("misc:matrix", matrix_helpers);
 	litest_add_no_device("misc:ratelimit", ratelimit_helpers);
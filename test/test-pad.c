@@ -717,6 +717,18 @@ START_TEST(pad_mode_groups)
 }
 END_TEST
 
+START_TEST(pad_mode_groups_not_a_pad)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+
+	ck_assert_int_eq(libinput_device_tablet_pad_get_num_mode_groups(device),
+			 -1);
+	ck_assert(libinput_device_tablet_pad_get_mode_group(device, 0) == NULL);
+	ck_assert(libinput_device_tablet_pad_get_mode_group(device, 1) == NULL);
+}
+END_TEST
+
 START_TEST(pad_mode_groups_userdata)
 {
 	struct litest_device *dev = litest_current_device();
@@ -944,6 +956,7 @@ TEST_COLLECTION(tablet_pad)
 	/* None of the current strip tablets are left-handed */
 
 	litest_add("pad:modes", pad_mode_groups, LITEST_TABLET_PAD, LITEST_ANY);
+	litest_add("pad:modes", pad_mode_groups_not_a_pad, LITEST_ANY, LITEST_TABLET_PAD);
 	litest_add("pad:modes", pad_mode_groups_userdata, LITEST_TABLET_PAD, LITEST_ANY);
 	litest_add("pad:modes", pad_mode_groups_ref, LITEST_TABLET_PAD, LITEST_ANY);
 	litest_add("pad:modes", pad_mode_group_mode, LITEST_TABLET_PAD, LITEST_ANY);
@@ -622,6 +622,98 @@ START_TEST(path_double_resume)
 }
 END_TEST
 
+START_TEST(path_add_devices)
+{
+	struct libinput *li;
+	struct libinput_device *devices[5];
+	struct libinput_event *event;
+	struct libevdev_uinput *uinputs[4];
+	const char *paths[5];
+	const char *names[] = {
+		"test device 1",
+		"test device 2",
+		NULL,
+		"test device 3",
+		"test device 4",
+	};
+	size_t nadded;
+	int rc;
+	void *userdata = &rc;
+
+	for (int i = 0; i < 4; i++) {
+		uinputs[i] = litest_create_uinput_device(names[i < 2 ? i : i + 1],
+							 NULL,
+							 EV_KEY, BTN_LEFT,
+							 EV_KEY, BTN_RIGHT,
+							 EV_REL, REL_X,
+							 EV_REL, REL_Y,
+							 -1);
+	}
+
+	paths[0] = libevdev_uinput_get_devnode(uinputs[0]);
+	paths[1] = libevdev_uinput_get_devnode(uinputs[1]);
+	paths[2] = "/tmp/";
+	paths[3] = libevdev_uinput_get_devnode(uinputs[2]);
+	paths[4] = libevdev_uinput_get_devnode(uinputs[3]);
+
+	li = libinput_path_create_context(&simple_interface, userdata);
+	ck_assert(li != NULL);
+
+	litest_disable_log_handler(li);
+	nadded = libinput_path_add_devices(li, paths, 5, devices);
+	litest_restore_log_handler(li);
+	ck_assert_int_eq(nadded, 4);
+	ck_assert(devices[2] == NULL);
+
+	libinput_dispatch(li);
+
+	/* device added events are in the order of the paths */
+	for (int i = 0; i < 5; i++) {
+		struct libinput_device *device;
+
+		if (names[i] == NULL)
+			continue;
+
+		ck_assert_notnull(devices[i]);
+
+		event = libinput_get_event(li);
+		ck_assert_notnull(event);
+		ck_assert_int_eq(libinput_event_get_type(event),
+				 LIBINPUT_EVENT_DEVICE_ADDED);
+		device = libinput_event_get_device(event);
+		ck_assert(device == devices[i]);
+		ck_assert_str_eq(libinput_device_get_name(device), names[i]);
+		libinput_event_destroy(event);
+	}
+
+	litest_assert_empty_queue(li);
+
+	/* and they are all re-added on resume */
+	libinput_suspend(li);
+	libinput_dispatch(li);
+	while ((event = libinput_get_event(li))) {
+		ck_assert_int_eq(libinput_event_get_type(event),
+				 LIBINPUT_EVENT_DEVICE_REMOVED);
+		libinput_event_destroy(event);
+	}
+
+	libinput_resume(li);
+	libinput_dispatch(li);
+	for (int i = 0; i < 4; i++) {
+		event = libinput_get_event(li);
+		ck_assert_notnull(event);
+		ck_assert_int_eq(libinput_event_get_type(event),
+				 LIBINPUT_EVENT_DEVICE_ADDED);
+		libinput_event_destroy(event);
+	}
+	litest_assert_empty_queue(li);
+
+	for (int i = 0; i < 4; i++)
+		libevdev_uinput_destroy(uinputs[i]);
+	libinput_unref(li);
+}
+END_TEST
+
 START_TEST(path_add_device_suspend_resume)
 {
 	struct libinput *li;
@@ -1002,6 +1094,7 @@ TEST_COLLECTION(path)
 	litest_add("path:device events", path_device_sysname, LITEST_ANY, LITEST_ANY);
 	litest_add_for_device("path:device events", path_add_device, LITEST_SYNAPTICS_CLICKPAD_X220);
 	litest_add_no_device("path:device events", path_add_invalid_path);
+	litest_add_no_device("path:device events", path_add_devices);
 	litest_add_for_device("path:device events", path_remove_device, LITEST_SYNAPTICS_CLICKPAD_X220);
 	litest_add_for_device("path:device events", path_double_remove_device, LITEST_SYNAPTICS_CLICKPAD_X220);
 	litest_add_no_device("path:seat", path_seat_recycle);
@@ -33,6 +33,8 @@
 #include <values.h>
 
 #include "libinput-util.h"
+#include "filter.h"
+#include "filter-private.h"
 #include "litest.h"
 
 static void
@@ -1507,6 +1509,339 @@ START_TEST(pointer_accel_profile_flat_motion_relative)
 }
 END_TEST
 
+static void
+assert_accel_profile_table(struct motion_filter *filter,
+			   accel_profile_func_t profile)
+{
+	double speed;
+
+	for (speed = -1.0; speed <= 1.0; speed += 0.25) {
+		double max_velocity, velocity;
+
+		ck_assert(filter_set_speed(filter, speed));
+		ck_assert_notnull(filter->table.factors);
+
+		/* go past the table to make sure the profile is flat there */
+		max_velocity = filter->table.max_velocity;
+		for (velocity = 0.0;
+		     velocity < 2 * max_velocity;
+		     velocity += max_velocity/5000) {
+			double analytic = profile(filter, NULL, velocity, 0);
+			double table = accel_profile_table_lookup(&filter->table,
+								  velocity);
+
+			/* The interpolation error is within 1% */
+			ck_assert_double_le(fabs(analytic - table),
+					    analytic * 0.01);
+		}
+	}
+
+	filter_destroy(filter);
+}
+
+START_TEST(pointer_accel_profile_table)
+{
+	assert_accel_profile_table(create_pointer_accelerator_filter_linear(1000),
+				   pointer_accel_profile_linear);
+	assert_accel_profile_table(create_pointer_accelerator_filter_linear(400),
+				   pointer_accel_profile_linear);
+	assert_accel_profile_table(create_pointer_accelerator_filter_linear(5000),
+				   pointer_accel_profile_linear);
+	assert_accel_profile_table(create_pointer_accelerator_filter_linear_low_dpi(400),
+				   pointer_accel_profile_linear_low_dpi);
+	/* the profile jumps at 0.07 units/ms for most speeds */
+	assert_accel_profile_table(create_pointer_accelerator_filter_linear_low_dpi(300),
+				   pointer_accel_profile_linear_low_dpi);
+	assert_accel_profile_table(create_pointer_accelerator_filter_linear_low_dpi(200),
+				   pointer_accel_profile_linear_low_dpi);
+	assert_accel_profile_table(create_pointer_accelerator_filter_touchpad(1000, 0, 0),
+				   touchpad_accel_profile_linear);
+	assert_accel_profile_table(create_pointer_accelerator_filter_touchpad(3000, 0, 0),
+				   touchpad_accel_profile_linear);
+}
+END_TEST
+
+/* Fractional deltas, a direction change, a pause longer than the motion
+ * timeout and enough events to wrap the 16-entry tracker ring twice */
+static const struct tracker_sample {
+	double dx, dy;
+	unsigned int dtime; /* us since the previous event */
+} tracker_samples[] = {
+	{ 1.25, 0.5, 7000 },
+	{ 1.5, 0.75, 7000 },
+	{ 2.125, 0.625, 7000 },
+	{ 3.3, 1.1, 7000 },
+	{ 4.7, 1.9, 7000 },
+	{ 6.1, 2.3, 7000 },
+	{ 5.9, 2.0, 7000 },
+	{ 0.35, 0.05, 7000 },
+	{ 0.2, 0.1, 7000 },
+	{ -0.4, 0.3, 7000 },
+	{ -1.7, 0.6, 7000 },
+	{ -2.9, 1.3, 6000 },
+	{ -3.1, 1.2, 8000 },
+	{ -0.1, 0.0, 7000 },
+	{ 0.0, -0.3, 7000 },
+	{ 0.7, -1.45, 7000 },
+	{ 1.1, -2.2, 7000 },
+	{ 0.9, -1.9, 1200000 },
+	{ 0.3, 0.1, 1000 },
+	{ 0.33, 0.11, 1000 },
+	{ 0.31, 0.09, 1000 },
+	{ 12.5, 4.25, 1000 },
+	{ 13.75, 4.5, 1000 },
+	{ 0.15, 0.05, 1000 },
+	{ 0.1, 0.05, 1000 },
+	{ 0.2, 0.15, 2000 },
+	{ 7.3, 5.1, 3000 },
+	{ 8.9, 6.2, 3000 },
+	{ 9.7, 7.4, 3000 },
+	{ 1.05, 0.95, 3000 },
+	{ 0.0, 0.0, 3000 },
+	{ -0.05, -0.45, 4000 },
+	{ -0.65, -2.35, 4000 },
+	{ -1.15, -4.85, 4000 },
+	{ -2.2, -6.6, 4000 },
+	{ -0.3, -0.9, 4000 },
+	{ -0.25, -0.8, 4000 },
+	{ -0.2, -0.75, 4000 },
+};
+
+/* Velocity from a trackers struct set up like the filter's and the
+ * filter's output, both recorded with the pointer trackers as they were
+ * before they kept running sums */
+struct tracker_expected {
+	double velocity;
+	double x, y;
+};
+
+static const struct tracker_expected tracker_expected_mouse[] = {
+	{ 1.3462898554937705e-06, 0.38341431159683603, 0.15336572463873441 },
+	{ 0.0002395444912333727, 1.3283657246387344, 0.66418286231936718 },
+	{ 0.0002769099067793519, 2.125, 0.625 },
+	{ 0.00035017358757415406, 3.2999999999999998, 1.1000000000000001 },
+	{ 0.00044359131324915775, 4.7375611815830245, 1.9151843074484565 },
+	{ 0.00054113316626555824, 6.7197506287718713, 2.5336764665861153 },
+	{ 0.00059920870409286133, 7.0044093693130707, 2.3743760573942612 },
+	{ 0.00052066807530897407, 0.4115762800348533, 0.058796611433550472 },
+	{ 0.00045955265954430861, 0.21982428083386113, 0.10991214041693056 },
+	{ 3.194154671094622e-05, -0.37899489284054677, 0.28424616963041005 },
+	{ 0.00010223756275217317, -1.5591826693053574, 0.55029976563718497 },
+	{ 0.00038281261866408129, -2.8999999999999999, 1.3 },
+	{ 0.00039524795903903871, -3.1000000000000001, 1.2 },
+	{ 0.00029975535970491474, -0.10000000000000001, 0 },
+	{ 4.28510212826739e-05, 0, -0.28642551064133698 },
+	{ 0.00022998489055998597, 0.66832619149645289, -1.3843899680997953 },
+	{ 0.0002906724626115939, 1.1000000000000001, -2.2000000000000002 },
+	{ 2.1023775017853617e-06, 0.79815356625267808, -1.6849908620889871 },
+	{ 0.00031591185416267526, 0.26605118875089268, 0.08868372958363091 },
+	{ 0.00033187321770882541, 0.33000000000000002, 0.11 },
+	{ 0.00032879430545935376, 0.31, 0.089999999999999997 },
+	{ 0.0067592326747820701, 22.916666666666664, 7.7916666666666661 },
+	{ 0.013828050737867725, 27.5, 9 },
+	{ 0.007309219312407543, 0.29999999999999999, 0.10000000000000001 },
+	{ 0.00013456183925873323, 0.18333333333333335, 0.091666666666666674 },
+	{ 0.00012866321095959761, 0.20000000000000001, 0.14999999999999999 },
+	{ 0.0013451323192422468, 10.320192702506935, 7.2099976414774476 },
+	{ 0.0024998828195187616, 17.800000000000001, 12.4 },
+	{ 0.0029265725662397097, 19.399999999999999, 14.800000000000001 },
+	{ 0.0028139625098587556, 2.1000000000000001, 1.8999999999999999 },
+	{ 0.00023595737807875848, 0, 0 },
+	{ 0.00011316402322091249, -0.050000000000000003, -0.45000000000000001 },
+	{ 0.00036072665141011906, -0.65000000000000002, -2.3500000000000001 },
+	{ 0.00065582156450532628, -1.2952468775608856, -5.4625629184089526 },
+	{ 0.00092583908194185784, -3.1458093822010929, -9.4374281466032777 },
+	{ 0.00078806750561613266, -0.45079458694706848, -1.3523837608412055 },
+	{ 0.00069164098583534141, -0.34345991757457767, -1.0990717362386486 },
+	{ 0.0006205540179486733, -0.25634145041624162, -0.96128043906090599 },
+};
+
+static const struct tracker_expected tracker_expected_touchpad[] = {
+	{ 1.3462898554937705e-06, 0.11203231035548851, 0.044812924142195405 },
+	{ 0.00016770509831248425, 0.22934290518012806, 0.11467145259006403 },
+	{ 0.00038770156048177059, 0.54981749465472651, 0.16171102783962543 },
+	{ 0.00073539955126448097, 0.88226759584570291, 0.29408919861523436 },
+	{ 0.0012421000362289665, 1.2565629395378195, 0.50797225215358655 },
+	{ 0.0018940201952460803, 1.6308582832299356, 0.61491377892276267 },
+	{ 0.0021290608258102916, 1.577387519845348, 0.5347076338458806 },
+	{ 0.0013093700775563797, 0.093573835923029106, 0.013367690846147015 },
+	{ 0.0006798896969362016, 0.05347076338458806, 0.02673538169229403 },
+	{ 4.4721359549995795e-05, -0.097308714348981251, 0.072981535761735938 },
+	{ 0.00021470910553583885, -0.31788677005544713, 0.11219533060780486 },
+	{ 0.00049769468552517213, -0.76748107985444969, 0.344043242693374 },
+	{ 0.00083006023877788525, -0.82879683246111491, 0.32082458030752836 },
+	{ 0.00083934498270973174, -0.02673538169229403, 0 },
+	{ 2.9999999999999997e-05, 0, -0.072426149004424525 },
+	{ 0.00016101242188104619, 0.11282629412853926, -0.23371160926625989 },
+	{ 0.00040697051490249265, 0.28368560540983079, -0.56737121081966158 },
+	{ 2.1023775017853617e-06, 0.1997770353733346, -0.42175151912148418 },
+	{ 3.1622776601683795e-05, 0.03055238729841523, 0.010184129099471743 },
+	{ 6.6407830863535961e-05, 0.041613510975622797, 0.013871170325207599 },
+	{ 9.8671171068352075e-05, 0.046932953466690353, 0.013625696167748811 },
+	{ 0.001418929526086479, 3.1257032669254148, 1.0627391107546411 },
+	{ 0.0028656562948127604, 3.6761149826904291, 1.2030921761532314 },
+	{ 0.0014625747844127493, 0.040103072538441045, 0.013367690846147015 },
+	{ 2.6925824035672519e-05, 0.024103390271808037, 0.012051695135904018 },
+	{ 5.1478150704934999e-05, 0.023739417666910609, 0.017804563250182957 },
+	{ 0.00094172713670149686, 1.7820868643345325, 1.2450195901515226 },
+	{ 0.0020263884129159441, 2.3794489706141686, 1.6575936649222298 },
+	{ 0.0032456509362530036, 2.5933320241525206, 1.9784182452297583 },
+	{ 0.0013611943285218315, 0.28072150776908733, 0.25398612607679327 },
+	{ 0.00014159802258506297, 0, 0 },
+	{ 4.5276925690687086e-05, -0.0079809746153920325, -0.071828771538528291 },
+	{ 0.00028861739379323627, -0.13552220664926598, -0.48996490096273082 },
+	{ 0.00078705145956284208, -0.30745688946138133, -1.2966660120762603 },
+	{ 0.0014814351150151668, -0.58817839723046872, -1.7645351916914058 },
+	{ 0.001576213817982827, -0.08020614507688209, -0.24061843523064627 },
+	{ 0.00087437120263650044, -0.066838454230735075, -0.21388305353835224 },
+	{ 0.00095186658729046701, -0.05347076338458806, -0.20051536269220521 },
+};
+
+static const struct tracker_expected tracker_expected_x230[] = {
+	{ 1.3462898554937705e-06, 4.2071557984180329e-05, 1.6828623193672132e-05 },
+	{ 0.0002395444912333727, 0.0090334042908324936, 0.0045167021454162468 },
+	{ 0.0002769099067793519, 0.027436639894426001, 0.0080695999689488242 },
+	{ 0.00035017358757415406, 0.05173438828416424, 0.017244796094721418 },
+	{ 0.00044359131324915775, 0.093267375846739137, 0.037703832789107307 },
+	{ 0.00054113316626555824, 0.15017048312599418, 0.056621657572096168 },
+	{ 0.00059920870409286133, 0.16820042587786688, 0.057017093517920975 },
+	{ 0.00052066807530897407, 0.0097989218197660592, 0.0013998459742522945 },
+	{ 0.00045955265954430861, 0.0049011036742664139, 0.002450551837133207 },
+	{ 3.194154671094622e-05, -0.0049149420625525493, 0.0036862065469144118 },
+	{ 0.00010223756275217317, -0.0057026121521825748, 0.0020126866419467914 },
+	{ 0.00038281261866408129, -0.035166138152678446, 0.01576413089602827 },
+	{ 0.00039524795903903871, -0.060299694771991819, 0.023341817331093605 },
+	{ 0.00029975535970491474, -0.0017375082968598837, 0 },
+	{ 4.28510212826739e-05, 0, -0.0025695478574069151 },
+	{ 0.00022998489055998597, 0.0047746284572465492, -0.0098903018042964235 },
+	{ 0.0002906724626115939, 0.01431807721221845, -0.028636154424436899 },
+	{ 2.1023775017853617e-06, 0.0065874339025510332, -0.013906804905385513 },
+	{ 0.00031591185416267526, 0.0023851067374834551, 0.00079503557916115169 },
+	{ 0.00033187321770882541, 0.0053442268429398816, 0.0017814089476466269 },
+	{ 0.00032879430545935376, 0.005120173304553389, 0.0014865019271284032 },
+	{ 0.0067592326747820701, 2.5366506817179673, 0.86246123178410883 },
+	{ 0.013828050737867725, 6.9976532323265648, 2.2901410578523302 },
+	{ 0.007309219312407543, 0.078152991165908389, 0.0260509970553028 },
+	{ 0.00013456183925873323, 0.021056441384258353, 0.010528220692129176 },
+	{ 0.00012866321095959761, 0.0013161252510916544, 0.00098709393831874072 },
+	{ 0.0013451323192422468, 0.32728155166470152, 0.2286487552725997 },
+	{ 0.0024998828195187616, 1.2512539641694054, 0.87166006492700154 },
+	{ 0.0029265725662397097, 1.701205579320858, 1.2978269368014794 },
+	{ 0.0028139625098587556, 0.19140636025787455, 0.17317718309045793 },
+	{ 0.00023595737807875848, 0, 0 },
+	{ 0.00011316402322091249, -0.00043640175162458879, -0.0039276157646212992 },
+	{ 0.00036072665141011906, -0.0077007234627542625, -0.027841077134573105 },
+	{ 0.00065582156450532628, -0.029225761207569055, -0.12325647117974775 },
+	{ 0.00092583908194185784, -0.086991335554595164, -0.26097400666378545 },
+	{ 0.00078806750561613266, -0.012854299406684932, -0.038562898220054799 },
+	{ 0.00069164098583534141, -0.0092481780715717148, -0.029594169829029487 },
+	{ 0.0006205540179486733, -0.006560975018920074, -0.024603656320950275 },
+};
+
+static const struct tracker_expected tracker_expected_low_dpi[] = {
+	{ 1.3462898554937705e-06, 0.38341431159683609, 0.15336572463873444 },
+	{ 0.0002395444912333727, 1.3502404597279118, 0.67512022986395592 },
+	{ 0.0002769099067793519, 2.3546060776773721, 0.69253119931687412 },
+	{ 0.00035017358757415406, 3.8573565422516136, 1.2857855140838712 },
+	{ 0.00044359131324915775, 5.9246822686282616, 2.3950843213603608 },
+	{ 0.00054113316626555824, 8.3301506287718716, 3.1408764665861155 },
+	{ 0.00059920870409286133, 8.5620093693130723, 2.9023760573942616 },
+	{ 0.00052066807530897407, 0.50397628003485317, 0.071996611433550461 },
+	{ 0.00045955265954430861, 0.27262428083386114, 0.13631214041693057 },
+	{ 3.194154671094622e-05, -0.42174737642465088, 0.31631053231848816 },
+	{ 0.00010223756275217317, -1.5591826693053574, 0.55029976563718497 },
+	{ 0.00038281261866408129, -3.1939654018290202, 1.4317775939233539 },
+	{ 0.00039524795903903871, -3.8809932849838198, 1.5023199812840591 },
+	{ 0.00029975535970491474, -0.12062518253091743, 0 },
+	{ 4.28510212826739e-05, 0, -0.29659875733374191 },
+	{ 0.00022998489055998597, 0.6773075857849844, -1.4029942848403247 },
+	{ 0.0002906724626115939, 1.221397698668806, -2.442795397337612 },
+	{ 2.1023775017853617e-06, 0.81971452258359112, -1.7305084365653589 },
+	{ 0.00031591185416267526, 0.27462634072983982, 0.091542113576613293 },
+	{ 0.00033187321770882541, 0.3894929905446774, 0.1298309968482258 },
+	{ 0.00032879430545935376, 0.36808381270017454, 0.10686304239682487 },
+	{ 0.0067592326747820701, 52.240277276117538, 17.761694273879964 },
+	{ 0.013828050737867725, 68.75, 22.5 },
+	{ 0.007309219312407543, 0.75, 0.25 },
+	{ 0.00013456183925873323, 0.42787197556109685, 0.21393598778054843 },
+	{ 0.00012866321095959761, 0.20000000000000001, 0.14999999999999999 },
+	{ 0.0013451323192422468, 11.97442812309281, 8.3656963599689487 },
+	{ 0.0024998828195187616, 26.15494910423514, 18.22030162317504 },
+	{ 0.0029265725662397097, 36.942939483021448, 28.183273420036983 },
+	{ 0.0028139625098587556, 4.1803590064468645, 3.7822295772614485 },
+	{ 0.00023595737807875848, 0, 0 },
+	{ 0.00011316402322091249, -0.051230168322882588, -0.46107151490594328 },
+	{ 0.00036072665141011906, -0.71059720341343491, -2.5690821969562649 },
+	{ 0.00065582156450532628, -1.5905667465665194, -6.7080423659544515 },
+	{ 0.00092583908194185784, -3.7266093822010933, -11.179828146603278 },
+	{ 0.00078806750561613266, -0.52999458694706847, -1.5899837608412055 },
+	{ 0.00069164098583534141, -0.40945991757457767, -1.3102717362386487 },
+	{ 0.0006205540179486733, -0.30914145041624169, -1.1592804390609062 },
+};
+
+static void
+assert_trackers_unchanged(struct motion_filter *filter,
+			  uint64_t smooth_threshold,
+			  uint64_t smooth_value,
+			  const struct tracker_expected *expected)
+{
+	struct pointer_trackers trackers;
+	uint64_t time = s2us(10);
+
+	/* the touchpad filter has no speed factor until a speed is set */
+	ck_assert(filter_set_speed(filter, 0.0));
+
+	trackers_init(&trackers);
+	if (smooth_threshold) {
+		trackers.smoothener = zalloc(sizeof(*trackers.smoothener));
+		trackers.smoothener->threshold = smooth_threshold;
+		trackers.smoothener->value = smooth_value;
+	}
+
+	for (size_t i = 0; i < ARRAY_LENGTH(tracker_samples); i++) {
+		struct device_float_coords delta = {
+			.x = tracker_samples[i].dx,
+			.y = tracker_samples[i].dy,
+		};
+		struct normalized_coords accel;
+		double velocity;
+
+		time += tracker_samples[i].dtime;
+		trackers_feed(&trackers, &delta, time);
+		velocity = trackers_velocity(&trackers, time);
+		accel = filter_dispatch(filter, &delta, NULL, time);
+
+		/* The sums only differ from the old per-tracker deltas by
+		 * rounding */
+		ck_assert_double_le(fabs(velocity - expected[i].velocity),
+				    fabs(expected[i].velocity) * 1e-12);
+		ck_assert_double_le(fabs(accel.x - expected[i].x),
+				    fabs(expected[i].x) * 1e-12);
+		ck_assert_double_le(fabs(accel.y - expected[i].y),
+				    fabs(expected[i].y) * 1e-12);
+	}
+
+	trackers_free(&trackers);
+	filter_destroy(filter);
+}
+
+START_TEST(pointer_accel_trackers)
+{
+	assert_trackers_unchanged(create_pointer_accelerator_filter_linear(1000),
+				  0, 0,
+				  tracker_expected_mouse);
+	assert_trackers_unchanged(create_pointer_accelerator_filter_touchpad(1000, ms2us(50), ms2us(10)),
+				  ms2us(50), ms2us(10),
+				  tracker_expected_touchpad);
+	assert_trackers_unchanged(create_pointer_accelerator_filter_lenovo_x230(1000),
+				  0, 0,
+				  tracker_expected_x230);
+	assert_trackers_unchanged(create_pointer_accelerator_filter_linear_low_dpi(400),
+				  0, 0,
+				  tracker_expected_low_dpi);
+}
+END_TEST
+
 START_TEST(middlebutton)
 {
 	struct litest_device *device = litest_current_device();
@@ -2581,6 +2916,8 @@ TEST_COLLECTION(pointer)
 	litest_add("pointer:accel", pointer_accel_profile_invalid, LITEST_RELATIVE, LITEST_ANY);
 	litest_add("pointer:accel", pointer_accel_profile_noaccel, LITEST_ANY, LITEST_TOUCHPAD|LITEST_RELATIVE|LITEST_TABLET);
 	litest_add("pointer:accel", pointer_accel_profile_flat_motion_relative, LITEST_RELATIVE, LITEST_TOUCHPAD);
+	litest_add_no_device("pointer:accel", pointer_accel_profile_table);
+	litest_add_no_device("pointer:accel", pointer_accel_trackers);
 
 	litest_add("pointer:middlebutton", middlebutton, LITEST_BUTTON, LITEST_CLICKPAD);
 	litest_add("pointer:middlebutton", middlebutton_nostart_while_down, LITEST_BUTTON, LITEST_CLICKPAD);
@@ -25,8 +25,10 @@
 
 #include <check.h>
 #include <libinput.h>
+#include <pthread.h>
 
 #include "libinput-util.h"
+#include "libinput-private.h"
 #include "litest.h"
 #include "quirks.h"
 
@@ -80,6 +82,10 @@ cleanup_data_dir(struct data_dir dd)
 		free(dd.filename);
 	}
 	if (dd.dirname) {
+		char cache[PATH_MAX];
+
+		snprintf(cache, sizeof(cache), "%s/quirks.cache", dd.dirname);
+		unlink(cache);
 		rmdir(dd.dirname);
 		free(dd.dirname);
 	}
@@ -833,6 +839,451 @@ START_TEST(quirks_model_zero)
 }
 END_TEST
 
+START_TEST(quirks_cache)
+{
+	struct litest_device *dev = litest_current_device();
+	struct udev_device *ud = libinput_device_get_udev_device(dev->libinput_device);
+	struct quirks_context *ctx;
+	const char quirks_file[] =
+	"[Section name]\n"
+	"MatchUdevType=mouse\n"
+	"ModelAppleTouchpad=1\n"
+	"AttrSizeHint=10x20\n"
+	"AttrKeyboardIntegration=internal\n";
+	struct data_dir dd = make_data_dir(quirks_file);
+	struct quirks *q;
+	struct quirk_dimensions dim;
+	char cache[PATH_MAX];
+	char *str;
+	bool isset;
+
+	ck_assert_int_eq(quirks_cache_verify(dd.dirname,
+					     NULL,
+					     log_handler,
+					     QLOG_CUSTOM_LOG_PRIORITIES),
+			 QUIRKS_CACHE_MISSING);
+	ck_assert(quirks_cache_update(dd.dirname,
+				      NULL,
+				      log_handler,
+				      QLOG_CUSTOM_LOG_PRIORITIES));
+	ck_assert_int_eq(quirks_cache_verify(dd.dirname,
+					     NULL,
+					     log_handler,
+					     QLOG_CUSTOM_LOG_PRIORITIES),
+			 QUIRKS_CACHE_UP_TO_DATE);
+
+	ctx = quirks_init_subsystem(dd.dirname,
+				    NULL,
+				    log_handler,
+				    NULL,
+				    QLOG_CUSTOM_LOG_PRIORITIES);
+	ck_assert_notnull(ctx);
+	ck_assert(quirks_context_is_cached(ctx));
+
+	q = quirks_fetch_for_device(ctx, ud);
+	ck_assert_notnull(q);
+
+	ck_assert(quirks_get_bool(q, QUIRK_MODEL_APPLE_TOUCHPAD, &isset));
+	ck_assert(isset == true);
+	ck_assert(quirks_get_dimensions(q, QUIRK_ATTR_SIZE_HINT, &dim));
+	ck_assert_int_eq(dim.x, 10);
+	ck_assert_int_eq(dim.y, 20);
+	ck_assert(quirks_get_string(q, QUIRK_ATTR_KEYBOARD_INTEGRATION, &str));
+	ck_assert_str_eq(str, "internal");
+
+	/* the cache is one of the files the context depends on */
+	ck_assert(quirks_context_up_to_date(ctx, dd.dirname, NULL));
+	snprintf(cache, sizeof(cache), "%s/quirks.cache", dd.dirname);
+	ck_assert_int_eq(unlink(cache), 0);
+	ck_assert(!quirks_context_up_to_date(ctx, dd.dirname, NULL));
+
+	quirks_unref(q);
+	quirks_context_unref(ctx);
+	cleanup_data_dir(dd);
+}
+END_TEST
+
+START_TEST(quirks_cache_outdated)
+{
+	struct litest_device *dev = litest_current_device();
+	struct udev_device *ud = libinput_device_get_udev_device(dev->libinput_device);
+	struct quirks_context *ctx;
+	const char quirks_file[] =
+	"[Section name]\n"
+	"MatchUdevType=mouse\n"
+	"ModelAppleTouchpad=1\n";
+	const char new_quirks_file[] =
+	"[New section name]\n"
+	"MatchUdevType=mouse\n"
+	"ModelAppleTouchpad=0\n";
+	struct data_dir dd = make_data_dir(quirks_file);
+	struct quirks *q;
+	bool isset = true;
+	FILE *fp;
+
+	ck_assert(quirks_cache_update(dd.dirname,
+				      NULL,
+				      log_handler,
+				      QLOG_CUSTOM_LOG_PRIORITIES));
+
+	fp = fopen(dd.filename, "w");
+	ck_assert_notnull(fp);
+	ck_assert_int_ge(fputs(new_quirks_file, fp), 0);
+	fclose(fp);
+
+	ck_assert_int_eq(quirks_cache_verify(dd.dirname,
+					     NULL,
+					     log_handler,
+					     QLOG_CUSTOM_LOG_PRIORITIES),
+			 QUIRKS_CACHE_OUTDATED);
+
+	ctx = quirks_init_subsystem(dd.dirname,
+				    NULL,
+				    log_handler,
+				    NULL,
+				    QLOG_CUSTOM_LOG_PRIORITIES);
+	ck_assert_notnull(ctx);
+	ck_assert(!quirks_context_is_cached(ctx));
+
+	q = quirks_fetch_for_device(ctx, ud);
+	ck_assert_notnull(q);
+	ck_assert(quirks_get_bool(q, QUIRK_MODEL_APPLE_TOUCHPAD, &isset));
+	ck_assert(isset == false);
+
+	quirks_unref(q);
+	quirks_context_unref(ctx);
+	cleanup_data_dir(dd);
+}
+END_TEST
+
+START_TEST(quirks_cache_invalid)
+{
+	struct quirks_context *ctx;
+	const char quirks_file[] =
+	"[Section name]\n"
+	"MatchUdevType=mouse\n"
+	"ModelAppleTouchpad=1\n";
+	struct data_dir dd = make_data_dir(quirks_file);
+	char cache[PATH_MAX];
+	FILE *fp;
+
+	snprintf(cache, sizeof(cache), "%s/quirks.cache", dd.dirname);
+	fp = fopen(cache, "w");
+	ck_assert_notnull(fp);
+	ck_assert_int_ge(fputs("LIQUIRKS and then some garbage", fp), 0);
+	fclose(fp);
+
+	ctx = quirks_init_subsystem(dd.dirname,
+				    NULL,
+				    log_handler,
+				    NULL,
+				    QLOG_CUSTOM_LOG_PRIORITIES);
+	ck_assert_notnull(ctx);
+	ck_assert(!quirks_context_is_cached(ctx));
+	quirks_context_unref(ctx);
+
+	ck_assert_int_eq(quirks_cache_verify(dd.dirname,
+					     NULL,
+					     log_handler,
+					     QLOG_CUSTOM_LOG_PRIORITIES),
+			 QUIRKS_CACHE_OUTDATED);
+
+	cleanup_data_dir(dd);
+}
+END_TEST
+
+START_TEST(quirks_cache_invalid_bus)
+{
+	struct quirks_context *ctx;
+	const char quirks_file[] =
+	"[Section name]\n"
+	"MatchBus=usb\n"
+	"MatchVendor=0x1A2B\n"
+	"MatchProduct=0x3C4D\n"
+	"ModelAppleTouchpad=1\n";
+	struct data_dir dd = make_data_dir(quirks_file);
+	/* bus, vendor and product are stored next to each other in the
+	 * cached section */
+	const uint32_t match[] = { 1 /* usb */, 0x1a2b, 0x3c4d };
+	const uint32_t bad_bus = 0xff;
+	char cache[PATH_MAX];
+	char buf[16384];
+	size_t len;
+	size_t offset = 0;
+	bool found = false;
+	FILE *fp;
+
+	ck_assert(quirks_cache_update(dd.dirname,
+				      NULL,
+				      log_handler,
+				      QLOG_CUSTOM_LOG_PRIORITIES));
+
+	snprintf(cache, sizeof(cache), "%s/quirks.cache", dd.dirname);
+	fp = fopen(cache, "r+");
+	ck_assert_notnull(fp);
+	len = fread(buf, 1, sizeof(buf), fp);
+	ck_assert_int_lt(len, sizeof(buf));
+
+	for (offset = 0; offset + sizeof(match) <= len; offset += 4) {
+		if (memcmp(&buf[offset], match, sizeof(match)) == 0) {
+			found = true;
+			break;
+		}
+	}
+	ck_assert(found);
+
+	ck_assert_int_eq(fseek(fp, offset, SEEK_SET), 0);
+	ck_assert_int_eq(fwrite(&bad_bus, sizeof(bad_bus), 1, fp), 1);
+	fclose(fp);
+
+	/* the cache is still up-to-date with the text files, but its
+	 * contents must not be used */
+	ctx = quirks_init_subsystem(dd.dirname,
+				    NULL,
+				    log_handler,
+				    NULL,
+				    QLOG_CUSTOM_LOG_PRIORITIES);
+	ck_assert_notnull(ctx);
+	ck_assert(!quirks_context_is_cached(ctx));
+	quirks_context_unref(ctx);
+
+	cleanup_data_dir(dd);
+}
+END_TEST
+
+struct quirks_thread_data {
+	struct quirks_context *ctx;
+	const char *syspath;
+	bool success;
+};
+
+static void *
+quirks_fetch_thread(void *data)
+{
+	struct quirks_thread_data *td = data;
+	struct udev *udev;
+	struct udev_device *ud;
+
+	/* libudev objects are not thread-safe, use our own */
+	udev = udev_new();
+	ud = udev_device_new_from_syspath(udev, td->syspath);
+
+	td->success = ud != NULL;
+	for (int i = 0; td->success && i < 100; i++) {
+		struct quirks_context *ctx = quirks_context_ref(td->ctx);
+		struct quirks *q;
+		bool isset = false;
+
+		q = quirks_fetch_for_device(ctx, ud);
+		td->success = q &&
+			quirks_get_bool(q, QUIRK_MODEL_APPLE_TOUCHPAD, &isset) &&
+			isset;
+
+		quirks_unref(q);
+		quirks_context_unref(ctx);
+	}
+
+	udev_device_unref(ud);
+	udev_unref(udev);
+
+	return NULL;
+}
+
+START_TEST(quirks_match_order)
+{
+	struct litest_device *dev = litest_current_device();
+	struct udev_device *ud = libinput_device_get_udev_device(dev->libinput_device);
+	struct quirks_context *ctx;
+	const char quirks_file[] =
+	"[First section]\n"
+	"MatchUdevType=mouse\n"
+	"ModelAppleTouchpad=1\n"
+	"AttrSizeHint=10x10\n"
+	"\n"
+	"[Vendor section]\n"
+	"MatchVendor=0x17EF\n"
+	"AttrSizeHint=20x20\n"
+	"\n"
+	"[Other vendor section]\n"
+	"MatchVendor=0x17EE\n"
+	"AttrSizeHint=40x40\n"
+	"\n"
+	"[Other product section]\n"
+	"MatchVendor=0x17EF\n"
+	"MatchProduct=0x6018\n"
+	"AttrPalmSizeThreshold=5\n"
+	"\n"
+	"[Bus section]\n"
+	"MatchBus=usb\n"
+	"ModelAppleTouchpad=0\n"
+	"\n"
+	"[Last section]\n"
+	"MatchUdevType=mouse\n"
+	"AttrSizeHint=30x30\n"
+	"\n"
+	"[DMI section]\n"
+	"MatchUdevType=mouse\n"
+	"MatchDMIModalias=dmi:*svnFooBar*\n"
+	"AttrPalmSizeThreshold=10\n";
+	struct data_dir dd = make_data_dir(quirks_file);
+	struct quirks *q;
+	struct quirk_dimensions dim;
+	bool isset = true;
+
+	ctx = quirks_init_subsystem(dd.dirname,
+				    NULL,
+				    log_handler,
+				    NULL,
+				    QLOG_CUSTOM_LOG_PRIORITIES);
+	ck_assert_notnull(ctx);
+
+	q = quirks_fetch_for_device(ctx, ud);
+	ck_assert_notnull(q);
+
+	/* Sections apply in file order, no matter how they match */
+	ck_assert(quirks_get_dimensions(q, QUIRK_ATTR_SIZE_HINT, &dim));
+	ck_assert_int_eq(dim.x, 30);
+	ck_assert_int_eq(dim.y, 30);
+	ck_assert(quirks_get_bool(q, QUIRK_MODEL_APPLE_TOUCHPAD, &isset));
+	ck_assert(isset == false);
+
+	ck_assert(!quirks_has_quirk(q, QUIRK_ATTR_PALM_SIZE_THRESHOLD));
+
+	quirks_unref(q);
+	quirks_context_unref(ctx);
+	cleanup_data_dir(dd);
+}
+END_TEST
+
+START_TEST(quirks_context_shared_threads)
+{
+	struct litest_device *dev = litest_current_device();
+	struct udev_device *ud = libinput_device_get_udev_device(dev->libinput_device);
+	struct quirks_context *ctx;
+	const char quirks_file[] =
+	"[Section name]\n"
+	"MatchUdevType=mouse\n"
+	"ModelAppleTouchpad=1\n";
+	struct data_dir dd = make_data_dir(quirks_file);
+	struct quirks_thread_data td[4];
+	pthread_t threads[4];
+
+	ctx = quirks_init_subsystem(dd.dirname,
+				    NULL,
+				    log_handler,
+				    NULL,
+				    QLOG_CUSTOM_LOG_PRIORITIES);
+	ck_assert_notnull(ctx);
+
+	for (size_t i = 0; i < ARRAY_LENGTH(threads); i++) {
+		td[i].ctx = ctx;
+		td[i].syspath = udev_device_get_syspath(ud);
+		td[i].success = false;
+		ck_assert_int_eq(pthread_create(&threads[i],
+						NULL,
+						quirks_fetch_thread,
+						&td[i]),
+				 0);
+	}
+
+	for (size_t i = 0; i < ARRAY_LENGTH(threads); i++) {
+		pthread_join(threads[i], NULL);
+		ck_assert(td[i].success);
+	}
+
+	quirks_context_unref(ctx);
+	cleanup_data_dir(dd);
+}
+END_TEST
+
+static struct libinput *
+shared_quirks_context(const char *devnode, struct libinput_device **device)
+{
+	struct libinput *li = litest_create_context();
+
+	*device = libinput_path_add_device(li, devnode);
+	ck_assert_notnull(*device);
+	litest_drain_events(li);
+
+	return li;
+}
+
+START_TEST(quirks_context_shared_libinput)
+{
+	struct litest_device *dev;
+	struct libinput *li1, *li2, *li3, *li4;
+	struct libinput_device *device;
+	const char quirks_file[] =
+	"[Section name]\n"
+	"MatchUdevType=mouse\n"
+	"ModelAppleTouchpad=1\n";
+	const char quirks_file_changed[] =
+	"[Changed section name]\n"
+	"MatchUdevType=mouse\n"
+	"ModelAppleTouchpad=0\n";
+	struct data_dir dd = make_data_dir(quirks_file);
+	char *data_dir = safe_strdup(getenv("LIBINPUT_DATA_DIR"));
+	const char *devnode;
+	struct quirks *q;
+	bool isset;
+	FILE *fp;
+
+	setenv("LIBINPUT_DATA_DIR", dd.dirname, 1);
+
+	dev = litest_create(LITEST_MOUSE, NULL, NULL, NULL, NULL);
+	devnode = libevdev_uinput_get_devnode(dev->uinput);
+
+	li1 = shared_quirks_context(devnode, &device);
+	li2 = shared_quirks_context(devnode, &device);
+	ck_assert_notnull(li1->quirks);
+	ck_assert_ptr_eq(li1->quirks, li2->quirks);
+
+	/* A context created after the file changed parses it again, even
+	 * while the others are alive, and shares the new parse */
+	fp = fopen(dd.filename, "w");
+	ck_assert_notnull(fp);
+	fputs(quirks_file_changed, fp);
+	fclose(fp);
+
+	li3 = shared_quirks_context(devnode, &device);
+	ck_assert_notnull(li3->quirks);
+	ck_assert_ptr_ne(li3->quirks, li1->quirks);
+	q = quirks_fetch_for_device(li3->quirks,
+				    libinput_device_get_udev_device(device));
+	ck_assert_notnull(q);
+	ck_assert(quirks_get_bool(q, QUIRK_MODEL_APPLE_TOUCHPAD, &isset));
+	ck_assert(isset == false);
+	quirks_unref(q);
+
+	li4 = shared_quirks_context(devnode, &device);
+	ck_assert_ptr_eq(li4->quirks, li3->quirks);
+
+	libinput_unref(li1);
+	libinput_unref(li2);
+	libinput_unref(li3);
+	libinput_unref(li4);
+
+	/* The last context dropped it, the next one parses the files */
+	li1 = shared_quirks_context(devnode, &device);
+	q = quirks_fetch_for_device(li1->quirks,
+				    libinput_device_get_udev_device(device));
+	ck_assert_notnull(q);
+	ck_assert(quirks_get_bool(q, QUIRK_MODEL_APPLE_TOUCHPAD, &isset));
+	ck_assert(isset == false);
+	quirks_unref(q);
+
+	libinput_unref(li1);
+	litest_delete_device(dev);
+
+	if (data_dir)
+		setenv("LIBINPUT_DATA_DIR", data_dir, 1);
+	else
+		unsetenv("LIBINPUT_DATA_DIR");
+	free(data_dir);
+	cleanup_data_dir(dd);
+}
+END_TEST
+
 START_TEST(quirks_model_alps)
 {
 	struct litest_device *dev = litest_current_device();
@@ -948,6 +1399,13 @@ TEST_COLLECTION(quirks)
 
 	litest_add_for_device("quirks:model", quirks_model_one, LITEST_MOUSE);
 	litest_add_for_device("quirks:model", quirks_model_zero, LITEST_MOUSE);
+	litest_add_for_device("quirks:model", quirks_match_order, LITEST_MOUSE);
+	litest_add_for_device("quirks:context", quirks_context_shared_threads, LITEST_MOUSE);
+	litest_add_no_device("quirks:context", quirks_context_shared_libinput);
+	litest_add_for_device("quirks:cache", quirks_cache, LITEST_MOUSE);
+	litest_add_for_device("quirks:cache", quirks_cache_outdated, LITEST_MOUSE);
+	litest_add_no_device("quirks:cache", quirks_cache_invalid);
+	litest_add_no_device("quirks:cache", quirks_cache_invalid_bus);
 
 	litest_add("quirks:devices", quirks_model_alps, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add("quirks:devices", quirks_model_wacom, LITEST_TOUCHPAD, LITEST_ANY);
@@ -1880,6 +1880,54 @@ START_TEST(motion_event_state)
 }
 END_TEST
 
+START_TEST(motion_and_button_same_frame)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_tablet_tool *tev;
+	struct axis_replacement axes[] = {
+		{ ABS_DISTANCE, 10 },
+		{ ABS_PRESSURE, 0 },
+		{ -1, -1 }
+	};
+
+	if (!libevdev_has_event_code(dev->evdev, EV_KEY, BTN_STYLUS))
+		return;
+
+	litest_tablet_proximity_in(dev, 10, 10, axes);
+	litest_drain_events(li);
+
+	/* the whole frame is decoded before anything is sent, so the
+	 * axis event comes first and carries the new position */
+	litest_push_event_frame(dev);
+	litest_tablet_motion(dev, 60, 60, axes);
+	litest_event(dev, EV_KEY, BTN_STYLUS, 1);
+	litest_pop_event_frame(dev);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	tev = litest_is_tablet_event(event, LIBINPUT_EVENT_TABLET_TOOL_AXIS);
+	ck_assert(libinput_event_tablet_tool_x_has_changed(tev));
+	ck_assert_double_gt(libinput_event_tablet_tool_get_x_transformed(tev, 100),
+			    50);
+	libinput_event_destroy(event);
+
+	event = libinput_get_event(li);
+	tev = litest_is_tablet_event(event, LIBINPUT_EVENT_TABLET_TOOL_BUTTON);
+	ck_assert_int_eq(libinput_event_tablet_tool_get_button(tev),
+			 BTN_STYLUS);
+	ck_assert_int_eq(libinput_event_tablet_tool_get_button_state(tev),
+			 LIBINPUT_BUTTON_STATE_PRESSED);
+	libinput_event_destroy(event);
+
+	litest_event(dev, EV_KEY, BTN_STYLUS, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_tablet_proximity_out(dev);
+	litest_drain_events(li);
+}
+END_TEST
+
 START_TEST(motion_outside_bounds)
 {
 	struct litest_device *dev = litest_current_device();
@@ -2278,6 +2326,52 @@ START_TEST(tools_with_serials)
 }
 END_TEST
 
+START_TEST(tools_share_libwacom)
+{
+#if HAVE_LIBWACOM
+	struct libinput *li = litest_create_context();
+	struct litest_device *dev, *dev2, *pad;
+	unsigned int nhits, nmisses;
+
+	dev = litest_add_device(li, LITEST_WACOM_INTUOS);
+	litest_drain_events(li);
+	ck_assert_int_eq(li->libwacom_stats.databases_loaded, 1);
+
+	litest_push_event_frame(dev);
+	litest_tablet_proximity_in(dev, 10, 10, NULL);
+	litest_event(dev, EV_MSC, MSC_SERIAL, 100);
+	litest_pop_event_frame(dev);
+	litest_tablet_proximity_out(dev);
+	litest_drain_events(li);
+	nhits = li->libwacom_stats.stylus_hits;
+	nmisses = li->libwacom_stats.stylus_misses;
+	ck_assert_int_gt(nmisses, 0);
+
+	/* Same tool id, different serial: a new tool but the stylus is
+	 * cached already */
+	litest_push_event_frame(dev);
+	litest_tablet_proximity_in(dev, 10, 10, NULL);
+	litest_event(dev, EV_MSC, MSC_SERIAL, 200);
+	litest_pop_event_frame(dev);
+	litest_tablet_proximity_out(dev);
+	litest_drain_events(li);
+	ck_assert_int_eq(li->libwacom_stats.stylus_misses, nmisses);
+	ck_assert_int_gt(li->libwacom_stats.stylus_hits, nhits);
+
+	/* More tablets and pads share the database */
+	dev2 = litest_add_device(li, LITEST_WACOM_INTUOS);
+	pad = litest_add_device(li, LITEST_WACOM_INTUOS5_PAD);
+	litest_drain_events(li);
+	ck_assert_int_eq(li->libwacom_stats.databases_loaded, 1);
+
+	litest_delete_device(pad);
+	litest_delete_device(dev2);
+	litest_delete_device(dev);
+	libinput_unref(li);
+#endif
+}
+END_TEST
+
 START_TEST(tools_without_serials)
 {
 	struct libinput *li = litest_create_context();
@@ -3633,6 +3727,126 @@ START_TEST(tablet_pressure_offset_none_for_small_distance)
 }
 END_TEST
 
+START_TEST(tablet_pressure_offset_from_cache)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct litest_device *dev2;
+	struct libinput *li2;
+	struct libinput_event *event;
+	struct libinput_event_tablet_tool *tev;
+	struct libinput_tablet_tool *tool, *tool2;
+	struct axis_replacement axes[] = {
+		{ ABS_DISTANCE, 70 },
+		{ ABS_PRESSURE, 20 },
+		{ -1, -1 },
+	};
+	char path[] = "/tmp/litest-tool-cache.XXXXXX";
+	int fd;
+
+	fd = mkstemp(path);
+	ck_assert_int_ge(fd, 0);
+	close(fd);
+
+	litest_drain_events(li);
+
+	/* offset 20 on prox in */
+	litest_tablet_proximity_in(dev, 5, 100, axes);
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	tev = litest_is_tablet_event(event,
+				     LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+	tool = libinput_event_tablet_tool_get_tool(tev);
+	ck_assert(tool->has_pressure_offset);
+	ck_assert_int_ne(libinput_tablet_tool_get_serial(tool), 0);
+	libinput_event_destroy(event);
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_save_tablet_tool_cache(li, path), 0);
+
+	li2 = litest_create_context();
+	ck_assert_int_eq(libinput_load_tablet_tool_cache(li2, path), 1);
+	dev2 = litest_add_device(li2, LITEST_WACOM_INTUOS);
+	litest_drain_events(li2);
+
+	/* stylus too close to detect an offset, we must use the cached
+	 * one */
+	litest_axis_set_value(axes, ABS_DISTANCE, 10);
+	litest_tablet_proximity_in(dev2, 5, 100, axes);
+	libinput_dispatch(li2);
+	event = libinput_get_event(li2);
+	tev = litest_is_tablet_event(event,
+				     LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+	tool2 = libinput_event_tablet_tool_get_tool(tev);
+	ck_assert_int_eq(libinput_tablet_tool_get_serial(tool2),
+			 libinput_tablet_tool_get_serial(tool));
+	ck_assert_int_eq(libinput_tablet_tool_get_type(tool2),
+			 libinput_tablet_tool_get_type(tool));
+	ck_assert(libinput_tablet_tool_has_pressure(tool2));
+	ck_assert(tool2->has_pressure_offset);
+	ck_assert_int_eq(tool2->pressure_offset, tool->pressure_offset);
+	libinput_event_destroy(event);
+	litest_drain_events(li2);
+
+	litest_delete_device(dev2);
+	libinput_unref(li2);
+	unlink(path);
+}
+END_TEST
+
+START_TEST(tablet_tool_cache_invalid)
+{
+	struct libinput *li = litest_create_context();
+	const char *contents[] = {
+		"",
+		"garbage\n",
+		"libinput-tablet-tool-cache 0\n",
+	};
+	const char valid[] =
+		"libinput-tablet-tool-cache 1\n"
+		"1 0x1234 0x802 0xf 20 0x14b,0x14c\n"
+		"1 0x1234 0x802 0xf - -\n"	/* duplicate */
+		"1 0 0x802 0xf - -\n"		/* no serial */
+		"99 0x1235 0x802 0xf - -\n"	/* invalid type */
+		"2 0x1236 0x802 0xf -5 -\n"	/* invalid offset */
+		"2 0x1237 0x802 0xf - 0xffff\n"	/* invalid button */
+		"2 0x1238 0x802\n"		/* truncated */
+		"2 0x1239 0x802 0xf - -\n";
+	const char **c;
+	char path[] = "/tmp/litest-tool-cache.XXXXXX";
+	FILE *fp;
+	int fd;
+
+	fd = mkstemp(path);
+	ck_assert_int_ge(fd, 0);
+	close(fd);
+
+	ARRAY_FOR_EACH(contents, c) {
+		fp = fopen(path, "w");
+		ck_assert_notnull(fp);
+		fputs(*c, fp);
+		fclose(fp);
+
+		ck_assert_int_eq(libinput_load_tablet_tool_cache(li, path),
+				 -EINVAL);
+	}
+
+	fp = fopen(path, "w");
+	ck_assert_notnull(fp);
+	fputs(valid, fp);
+	fclose(fp);
+	ck_assert_int_eq(libinput_load_tablet_tool_cache(li, path), 2);
+
+	/* all of those are already known */
+	ck_assert_int_eq(libinput_load_tablet_tool_cache(li, path), 0);
+
+	unlink(path);
+	ck_assert_int_eq(libinput_load_tablet_tool_cache(li, path), -ENOENT);
+
+	libinput_unref(li);
+}
+END_TEST
+
 START_TEST(tablet_distance_range)
 {
 	struct litest_device *dev = litest_current_device();
@@ -4691,6 +4905,7 @@ TEST_COLLECTION(tablet)
 	litest_add("tablet:tool_serial", serial_changes_tool, LITEST_TABLET | LITEST_TOOL_SERIAL, LITEST_ANY);
 	litest_add("tablet:tool_serial", invalid_serials, LITEST_TABLET | LITEST_TOOL_SERIAL, LITEST_ANY);
 	litest_add_no_device("tablet:tool_serial", tools_with_serials);
+	litest_add_no_device("tablet:tool_serial", tools_share_libwacom);
 	litest_add_no_device("tablet:tool_serial", tools_without_serials);
 	litest_add_for_device("tablet:tool_serial", tool_delayed_serial, LITEST_WACOM_HID4800_PEN);
 	litest_add("tablet:proximity", proximity_out_clear_buttons, LITEST_TABLET, LITEST_ANY);
@@ -4719,6 +4934,7 @@ TEST_COLLECTION(tablet)
 	litest_add("tablet:tip", tip_state_axis, LITEST_TABLET, LITEST_ANY);
 	litest_add("tablet:tip", tip_state_button, LITEST_TABLET, LITEST_ANY);
 	litest_add_no_device("tablet:tip", tip_up_on_delete);
+	litest_add("tablet:motion", motion_and_button_same_frame, LITEST_TABLET, LITEST_ANY);
 	litest_add("tablet:motion", motion, LITEST_TABLET, LITEST_ANY);
 	litest_add("tablet:motion", motion_event_state, LITEST_TABLET, LITEST_ANY);
 	litest_add_for_device("tablet:motion", motion_outside_bounds, LITEST_WACOM_CINTIQ_24HD);
@@ -4756,6 +4972,8 @@ TEST_COLLECTION(tablet)
 	litest_add_for_device("tablet:pressure", tablet_pressure_offset_exceed_threshold, LITEST_WACOM_INTUOS);
 	litest_add_for_device("tablet:pressure", tablet_pressure_offset_none_for_zero_distance, LITEST_WACOM_INTUOS);
 	litest_add_for_device("tablet:pressure", tablet_pressure_offset_none_for_small_distance, LITEST_WACOM_INTUOS);
+	litest_add_for_device("tablet:pressure", tablet_pressure_offset_from_cache, LITEST_WACOM_INTUOS);
+	litest_add_no_device("tablet:tool", tablet_tool_cache_invalid);
 	litest_add_for_device("tablet:distance", tablet_distance_range, LITEST_WACOM_INTUOS);
 
 	litest_add("tablet:relative", relative_no_profile, LITEST_TABLET, LITEST_ANY);
@@ -0,0 +1,347 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Tests for the internal timer heap. The timers are not reachable through
+ * the public API, so this links the library objects directly instead of
+ * going through the litest runner. */
+
+#include <config.h>
+
+#include <check.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libinput-private.h"
+#include "timer.h"
+
+#define NTIMERS 64
+
+struct test_timer {
+	struct libinput_timer timer;
+	uint64_t expire; /* expected expiry, 0 if not armed */
+	unsigned int fired;
+};
+
+struct timer_context {
+	struct libinput *libinput;
+	struct libinput_seat seat;
+	struct libinput_device device;
+	struct test_timer timers[NTIMERS];
+	uint64_t last_expire;
+	unsigned int nfired;
+	struct test_timer *rearm; /* re-armed by the first timer to fire */
+	uint64_t rearm_expire;
+};
+
+static struct timer_context ctx;
+
+static int
+open_func(const char *path, int flags, void *data)
+{
+	int fd = open(path, flags);
+
+	return fd < 0 ? -errno : fd;
+}
+
+static void
+close_func(int fd, void *data)
+{
+	close(fd);
+}
+
+static const struct libinput_interface simple_interface = {
+	.open_restricted = open_func,
+	.close_restricted = close_func,
+};
+
+static void
+timer_func(uint64_t now, void *data)
+{
+	struct test_timer *t = data;
+
+	/* timers must fire in the order of their expiry */
+	ck_assert_int_ne(t->expire, 0);
+	ck_assert_int_le(t->expire, now);
+	ck_assert_int_ge(t->expire, ctx.last_expire);
+
+	ctx.last_expire = t->expire;
+	ctx.nfired++;
+	t->fired++;
+	t->expire = 0;
+
+	if (ctx.rearm) {
+		struct test_timer *rearm = ctx.rearm;
+
+		ctx.rearm = NULL;
+		rearm->expire = ctx.rearm_expire;
+		libinput_timer_set(&rearm->timer, rearm->expire);
+	}
+}
+
+static void
+timer_context_init(void)
+{
+	memset(&ctx, 0, sizeof(ctx));
+
+	ctx.libinput = libinput_path_create_context(&simple_interface, NULL);
+	ck_assert_notnull(ctx.libinput);
+
+	ctx.seat.libinput = ctx.libinput;
+	ctx.device.seat = &ctx.seat;
+
+	for (int i = 0; i < NTIMERS; i++)
+		libinput_timer_init(&ctx.timers[i].timer,
+				    &ctx.device,
+				    "test",
+				    timer_func,
+				    &ctx.timers[i]);
+}
+
+static void
+timer_context_destroy(void)
+{
+	for (int i = 0; i < NTIMERS; i++) {
+		libinput_timer_cancel(&ctx.timers[i].timer);
+		libinput_timer_destroy(&ctx.timers[i].timer);
+	}
+
+	libinput_unref(ctx.libinput);
+}
+
+static void
+assert_heap_valid(void)
+{
+	struct libinput *li = ctx.libinput;
+	size_t armed = 0;
+
+	for (size_t i = 0; i < li->timer.heap_len; i++) {
+		struct libinput_timer *t = li->timer.heap[i];
+
+		ck_assert_int_eq(t->heap_index, i);
+		ck_assert_int_ne(t->expire, 0);
+		if (i > 0)
+			ck_assert_int_le(li->timer.heap[(i - 1)/2]->expire,
+					 t->expire);
+	}
+
+	for (int i = 0; i < NTIMERS; i++) {
+		if (ctx.timers[i].expire) {
+			ck_assert_int_eq(ctx.timers[i].timer.expire,
+					 ctx.timers[i].expire);
+			armed++;
+		}
+	}
+
+	ck_assert_int_eq(armed, li->timer.heap_len);
+}
+
+START_TEST(timer_heap_order)
+{
+	uint64_t now;
+	unsigned int expected = 0;
+
+	timer_context_init();
+	now = libinput_now(ctx.libinput);
+	srand(1);
+
+	for (int i = 0; i < NTIMERS; i++) {
+		struct test_timer *t = &ctx.timers[i];
+
+		t->expire = now + ms2us(1 + rand() % 1000);
+		libinput_timer_set(&t->timer, t->expire);
+		assert_heap_valid();
+	}
+
+	/* cancel some, move others earlier or later */
+	for (int i = 0; i < NTIMERS; i++) {
+		struct test_timer *t = &ctx.timers[i];
+
+		if (i % 3 == 0) {
+			t->expire = 0;
+			libinput_timer_cancel(&t->timer);
+		} else if (i % 5 == 0) {
+			t->expire = now + ms2us(1 + rand() % 1000);
+			libinput_timer_set(&t->timer, t->expire);
+		}
+		assert_heap_valid();
+	}
+
+	/* cancelled timers can be armed again */
+	for (int i = 0; i < NTIMERS; i += 6) {
+		struct test_timer *t = &ctx.timers[i];
+
+		t->expire = now + ms2us(1 + rand() % 1000);
+		libinput_timer_set(&t->timer, t->expire);
+		assert_heap_valid();
+	}
+
+	for (int i = 0; i < NTIMERS; i++) {
+		if (ctx.timers[i].expire)
+			expected++;
+	}
+
+	/* only the timers up to the flush time fire */
+	libinput_timer_flush(ctx.libinput, now + ms2us(500));
+	assert_heap_valid();
+	for (int i = 0; i < NTIMERS; i++) {
+		if (ctx.timers[i].expire)
+			ck_assert_int_gt(ctx.timers[i].expire, now + ms2us(500));
+	}
+
+	libinput_timer_flush(ctx.libinput, now + ms2us(2000));
+	assert_heap_valid();
+	ck_assert_int_eq(ctx.nfired, expected);
+	ck_assert_int_eq(ctx.libinput->timer.heap_len, 0);
+
+	for (int i = 0; i < NTIMERS; i++) {
+		unsigned int fired = ctx.timers[i].fired;
+
+		if (i % 3 == 0 && i % 6 != 0)
+			ck_assert_int_eq(fired, 0);
+		else
+			ck_assert_int_eq(fired, 1);
+	}
+
+	timer_context_destroy();
+}
+END_TEST
+
+START_TEST(timer_heap_rearm_in_callback)
+{
+	uint64_t now;
+
+	timer_context_init();
+	now = libinput_now(ctx.libinput);
+
+	for (int i = 0; i < 4; i++) {
+		struct test_timer *t = &ctx.timers[i];
+
+		t->expire = now + ms2us(10 * (i + 1));
+		libinput_timer_set(&t->timer, t->expire);
+	}
+
+	/* the first timer arms another one before the remaining ones, it
+	 * must fire next within the same flush */
+	ctx.rearm = &ctx.timers[10];
+	ctx.rearm_expire = now + ms2us(15);
+
+	libinput_timer_flush(ctx.libinput, now + ms2us(100));
+	assert_heap_valid();
+
+	ck_assert_int_eq(ctx.nfired, 5);
+	ck_assert_int_eq(ctx.timers[10].fired, 1);
+	ck_assert_int_eq(ctx.libinput->timer.heap_len, 0);
+
+	timer_context_destroy();
+}
+END_TEST
+
+START_TEST(timer_slack)
+{
+	struct test_timer *t1, *t2, *t3;
+	uint64_t now, base, slack = ms2us(10);
+
+	timer_context_init();
+	now = libinput_now(ctx.libinput);
+	base = (now / slack + 10) * slack;
+
+	t1 = &ctx.timers[0];
+	t2 = &ctx.timers[1];
+	t3 = &ctx.timers[2];
+
+	/* expiries are rounded up to the next multiple of the slack, so
+	 * both timers expire together */
+	libinput_timer_set_slack(&t1->timer, slack);
+	libinput_timer_set_slack(&t2->timer, slack);
+	libinput_timer_set(&t1->timer, base + 1);
+	libinput_timer_set(&t2->timer, base + slack - 1);
+	ck_assert_int_eq(t1->timer.expire, base + slack);
+	ck_assert_int_eq(t2->timer.expire, base + slack);
+
+	/* an expiry that is already aligned is left alone */
+	libinput_timer_set(&t1->timer, base + slack);
+	ck_assert_int_eq(t1->timer.expire, base + slack);
+
+	/* without slack there is no rounding */
+	libinput_timer_set(&t3->timer, base + 1);
+	ck_assert_int_eq(t3->timer.expire, base + 1);
+
+	t1->expire = base + slack;
+	t2->expire = base + slack;
+	t3->expire = base + 1;
+	assert_heap_valid();
+
+	/* the rounded timers don't fire at their requested time */
+	libinput_timer_flush(ctx.libinput, base + 1);
+	ck_assert_int_eq(t1->fired, 0);
+	ck_assert_int_eq(t2->fired, 0);
+	ck_assert_int_eq(t3->fired, 1);
+
+	libinput_timer_flush(ctx.libinput, base + slack);
+	ck_assert_int_eq(t1->fired, 1);
+	ck_assert_int_eq(t2->fired, 1);
+	ck_assert_int_eq(ctx.libinput->timer.heap_len, 0);
+
+	timer_context_destroy();
+}
+END_TEST
+
+static Suite *
+timer_suite(void)
+{
+	TCase *tc;
+	Suite *s;
+
+	s = suite_create("timer");
+
+	tc = tcase_create("heap");
+	tcase_add_test(tc, timer_heap_order);
+	tcase_add_test(tc, timer_heap_rearm_in_callback);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("slack");
+	tcase_add_test(tc, timer_slack);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
+
+int
+main(int argc, char **argv)
+{
+	int nfailed;
+	Suite *s;
+	SRunner *sr;
+
+	s = timer_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_ENV);
+	nfailed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (nfailed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -165,6 +165,41 @@ START_TEST(touchpad_2fg_scroll)
 }
 END_TEST
 
+START_TEST(touchpad_2fg_scroll_slots_out_of_order)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+
+	if (!litest_has_2fg_scroll(dev))
+		return;
+
+	litest_enable_2fg_scroll(dev);
+	litest_drain_events(li);
+
+	/* both touches begin in the same frame, higher slot first */
+	litest_push_event_frame(dev);
+	litest_touch_down(dev, 1, 55, 30);
+	litest_touch_down(dev, 0, 45, 30);
+	litest_pop_event_frame(dev);
+
+	/* every frame switches slots twice, each update must land on the
+	 * touch of its slot */
+	for (int i = 1; i <= 10; i++) {
+		litest_push_event_frame(dev);
+		litest_touch_move(dev, 1, 55, 30 + i * 4);
+		litest_touch_move(dev, 0, 45, 30 + i * 4);
+		litest_pop_event_frame(dev);
+		libinput_dispatch(li);
+	}
+
+	litest_touch_up(dev, 1);
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+
+	litest_assert_scroll(li, LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL, 10);
+}
+END_TEST
+
 START_TEST(touchpad_2fg_scroll_diagonal)
 {
 	struct litest_device *dev = litest_current_device();
@@ -6291,6 +6326,7 @@ TEST_COLLECTION(touchpad)
 	litest_add("touchpad:motion", touchpad_2fg_no_motion, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH);
 
 	litest_add("touchpad:scroll", touchpad_2fg_scroll, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH|LITEST_SEMI_MT);
+	litest_add("touchpad:scroll", touchpad_2fg_scroll_slots_out_of_order, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH|LITEST_SEMI_MT);
 	litest_add("touchpad:scroll", touchpad_2fg_scroll_diagonal, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH|LITEST_SEMI_MT);
 	litest_add("touchpad:scroll", touchpad_2fg_scroll_slow_distance, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH);
 	litest_add("touchpad:scroll", touchpad_2fg_scroll_return_to_motion, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH);
@@ -29,6 +29,8 @@
 #include <libinput.h>
 #include <libinput-util.h>
 #include <libudev.h>
+#include <poll.h>
+#include <pthread.h>
 #include <unistd.h>
 
 #include "litest.h"
@@ -394,6 +396,308 @@ START_TEST(udev_suspend_resume)
 }
 END_TEST
 
+struct async_counters {
+	int requested;
+	int completed; /* atomic */
+	int opened; /* atomic */
+	int closed;
+};
+
+struct async_open {
+	struct libinput_open_request *request;
+	struct async_counters *counters;
+	char *path;
+	int flags;
+};
+
+static void *
+open_async_thread(void *data)
+{
+	struct async_open *o = data;
+	int fd;
+
+	fd = open(o->path, o->flags);
+	if (fd >= 0)
+		__atomic_add_fetch(&o->counters->opened, 1, __ATOMIC_SEQ_CST);
+
+	libinput_open_request_complete(o->request, fd < 0 ? -errno : fd);
+	__atomic_add_fetch(&o->counters->completed, 1, __ATOMIC_SEQ_CST);
+
+	free(o->path);
+	free(o);
+
+	return NULL;
+}
+
+/* Stand-in for an asynchronous open, completes the request from a
+ * thread */
+static void
+open_async(struct libinput *li,
+	   struct libinput_open_request *request,
+	   const char *path,
+	   int flags,
+	   void *user_data)
+{
+	struct async_counters *counters = user_data;
+	struct async_open *o;
+	pthread_t thread;
+
+	o = zalloc(sizeof *o);
+	o->request = request;
+	o->counters = counters;
+	o->path = safe_strdup(path);
+	o->flags = flags;
+
+	counters->requested++;
+
+	ck_assert_int_eq(pthread_create(&thread, NULL, open_async_thread, o), 0);
+	pthread_detach(thread);
+}
+
+static int
+open_restricted_count(const char *path, int flags, void *data)
+{
+	struct async_counters *counters = data;
+	int fd;
+
+	fd = open(path, flags);
+	if (fd < 0)
+		return -errno;
+
+	__atomic_add_fetch(&counters->opened, 1, __ATOMIC_SEQ_CST);
+
+	return fd;
+}
+
+static void
+close_restricted_count(int fd, void *data)
+{
+	struct async_counters *counters = data;
+
+	counters->closed++;
+	close(fd);
+}
+
+static const struct libinput_interface counting_interface = {
+	.open_restricted = open_restricted_count,
+	.close_restricted = close_restricted_count,
+};
+
+static void
+wait_for_async_opens(struct libinput *li, struct async_counters *counters)
+{
+	struct pollfd fds = {
+		.fd = libinput_get_fd(li),
+		.events = POLLIN,
+	};
+	int timeout = 200;
+
+	while (__atomic_load_n(&counters->completed, __ATOMIC_SEQ_CST) <
+	       counters->requested) {
+		ck_assert_int_gt(timeout--, 0);
+		poll(&fds, 1, 10);
+	}
+
+	libinput_dispatch(li);
+}
+
+/**
+ * This test only works if there's at least one device in the system that is
+ * assigned the default seat. Should cover the 99% case.
+ */
+START_TEST(udev_open_async)
+{
+	struct libinput *li;
+	struct udev *udev;
+	struct async_counters counters = {0};
+	int num_devices = 0;
+
+	udev = udev_new();
+	ck_assert(udev != NULL);
+
+	li = libinput_udev_create_context(&counting_interface, &counters, udev);
+	ck_assert(li != NULL);
+	ck_assert_int_eq(libinput_set_open_async(li, open_async), 0);
+	ck_assert_int_eq(libinput_udev_assign_seat(li, "seat0"), 0);
+	ck_assert_int_gt(counters.requested, 0);
+
+	wait_for_async_opens(li, &counters);
+	process_events_count_devices(li, &num_devices);
+	ck_assert_int_gt(num_devices, 0);
+
+	/* Check that after a suspend, no devices are left. */
+	libinput_suspend(li);
+	ck_assert_int_ge(libinput_dispatch(li), 0);
+	process_events_count_devices(li, &num_devices);
+	ck_assert_int_eq(num_devices, 0);
+
+	/* Check that after a resume, at least one device is discovered. */
+	libinput_resume(li);
+	wait_for_async_opens(li, &counters);
+	process_events_count_devices(li, &num_devices);
+	ck_assert_int_gt(num_devices, 0);
+
+	libinput_unref(li);
+	udev_unref(udev);
+
+	ck_assert_int_eq(counters.closed, counters.opened);
+}
+END_TEST
+
+START_TEST(udev_open_async_suspend)
+{
+	struct libinput *li;
+	struct udev *udev;
+	struct async_counters counters = {0};
+	int num_devices = 0;
+
+	udev = udev_new();
+	ck_assert(udev != NULL);
+
+	li = libinput_udev_create_context(&counting_interface, &counters, udev);
+	ck_assert(li != NULL);
+	ck_assert_int_eq(libinput_set_open_async(li, open_async), 0);
+	ck_assert_int_eq(libinput_udev_assign_seat(li, "seat0"), 0);
+
+	/* Suspend before the opens are processed, no devices must be
+	 * added and every fd must be closed again */
+	libinput_suspend(li);
+
+	wait_for_async_opens(li, &counters);
+	process_events_count_devices(li, &num_devices);
+	ck_assert_int_eq(num_devices, 0);
+	ck_assert_int_eq(counters.closed, counters.opened);
+
+	libinput_unref(li);
+	udev_unref(udev);
+}
+END_TEST
+
+/* Opens held until complete_held_opens(), the fd is opened right away
+ * so we can check it gets closed */
+struct held_open {
+	struct libinput_open_request *request;
+	char *path;
+	int fd;
+};
+
+static struct held_open held_opens[256];
+static size_t nheld_opens;
+
+static void
+open_async_held(struct libinput *li,
+		struct libinput_open_request *request,
+		const char *path,
+		int flags,
+		void *user_data)
+{
+	struct async_counters *counters = user_data;
+	struct held_open *o;
+
+	ck_assert_int_lt(nheld_opens, ARRAY_LENGTH(held_opens));
+
+	o = &held_opens[nheld_opens++];
+	o->request = request;
+	o->path = safe_strdup(path);
+	o->fd = open_restricted_count(path, flags, counters);
+
+	counters->requested++;
+}
+
+static size_t
+wait_for_held_open(struct libinput *li, const char *path, size_t first)
+{
+	struct pollfd fds = {
+		.fd = libinput_get_fd(li),
+		.events = POLLIN,
+	};
+	int timeout = 200;
+
+	while (true) {
+		for (size_t i = first; i < nheld_opens; i++) {
+			if (streq(held_opens[i].path, path))
+				return i;
+		}
+
+		ck_assert_int_gt(timeout--, 0);
+		poll(&fds, 1, 10);
+		libinput_dispatch(li);
+	}
+}
+
+static void
+complete_held_opens(struct libinput *li)
+{
+	for (size_t i = 0; i < nheld_opens; i++) {
+		libinput_open_request_complete(held_opens[i].request,
+					       held_opens[i].fd);
+		free(held_opens[i].path);
+	}
+	nheld_opens = 0;
+
+	libinput_dispatch(li);
+}
+
+START_TEST(udev_open_async_device_removed)
+{
+	struct libinput *li;
+	struct libinput_event *event;
+	struct udev *udev;
+	struct litest_device *dev;
+	struct async_counters counters = {0};
+	char *devname;
+	size_t idx;
+	int nadded = 0;
+
+	udev = udev_new();
+	ck_assert(udev != NULL);
+
+	li = libinput_udev_create_context(&counting_interface, &counters, udev);
+	ck_assert(li != NULL);
+	ck_assert_int_eq(libinput_set_open_async(li, open_async_held), 0);
+	ck_assert_int_eq(libinput_udev_assign_seat(li, "seat0"), 0);
+
+	/* Unplug the device before its open completes, then replug it.
+	 * The replugged device may get the same device node */
+	dev = litest_create(LITEST_MOUSE, NULL, NULL, NULL, NULL);
+	devname = safe_strdup(libevdev_get_name(dev->evdev));
+	idx = wait_for_held_open(li,
+				 libevdev_uinput_get_devnode(dev->uinput),
+				 0);
+	litest_delete_device(dev);
+
+	dev = litest_create(LITEST_MOUSE, NULL, NULL, NULL, NULL);
+	wait_for_held_open(li,
+			   libevdev_uinput_get_devnode(dev->uinput),
+			   idx + 1);
+
+	/* Only the unplugged device's fd is closed, and only the
+	 * replugged device is added */
+	complete_held_opens(li);
+	ck_assert_int_eq(counters.closed, 1);
+
+	while ((event = libinput_get_event(li))) {
+		struct libinput_device *device;
+
+		device = libinput_event_get_device(event);
+		if (libinput_event_get_type(event) ==
+		    LIBINPUT_EVENT_DEVICE_ADDED &&
+		    streq(libinput_device_get_name(device), devname))
+			nadded++;
+		libinput_event_destroy(event);
+	}
+	ck_assert_int_eq(nadded, 1);
+
+	libinput_unref(li);
+	udev_unref(udev);
+
+	ck_assert_int_eq(counters.closed, counters.opened);
+
+	litest_delete_device(dev);
+	free(devname);
+}
+END_TEST
+
 START_TEST(udev_resume_before_seat)
 {
 	struct libinput *li;
@@ -660,6 +964,9 @@ TEST_COLLECTION(udev)
 	litest_add_for_device("udev:suspend", udev_double_resume, LITEST_SYNAPTICS_CLICKPAD_X220);
 	litest_add_for_device("udev:suspend", udev_suspend_resume, LITEST_SYNAPTICS_CLICKPAD_X220);
 	litest_add_for_device("udev:suspend", udev_resume_before_seat, LITEST_SYNAPTICS_CLICKPAD_X220);
+	litest_add_no_device("udev:open-async", udev_open_async);
+	litest_add_no_device("udev:open-async", udev_open_async_suspend);
+	litest_add_no_device("udev:open-async", udev_open_async_device_removed);
 	litest_add_for_device("udev:suspend", udev_suspend_resume_before_seat, LITEST_SYNAPTICS_CLICKPAD_X220);
 	litest_add_for_device("udev:device events", udev_device_sysname, LITEST_SYNAPTICS_CLICKPAD_X220);
 	litest_add_for_device("udev:seat", udev_seat_recycle, LITEST_SYNAPTICS_CLICKPAD_X220);
@@ -142,7 +142,15 @@ usage(void)
 	       "\n",
 	       program_invocation_short_name);
 	printf("  %s [--data-dir /path/to/data/dir] --validate-only\n"
-	       "	Validate the database\n",
+	       "	Validate the database\n"
+	       "\n",
+	       program_invocation_short_name);
+	printf("  %s [--data-dir /path/to/data/dir] --update-cache\n"
+	       "	Compile the database into a cache in the data directory\n"
+	       "\n",
+	       program_invocation_short_name);
+	printf("  %s [--data-dir /path/to/data/dir] --verify-cache\n"
+	       "	Check whether the cache matches the database\n",
 	       program_invocation_short_name);
 }
 
@@ -157,6 +165,11 @@ main(int argc, char **argv)
 	int rc = 1;
 	struct quirks_context *quirks;
 	bool validate = false;
+	enum {
+		CACHE_NONE,
+		CACHE_UPDATE,
+		CACHE_VERIFY,
+	} cache_mode = CACHE_NONE;
 
 	while (1) {
 		int c;
@@ -165,12 +178,16 @@ main(int argc, char **argv)
 			OPT_VERBOSE,
 			OPT_DATADIR,
 			OPT_VALIDATE,
+			OPT_UPDATE_CACHE,
+			OPT_VERIFY_CACHE,
 		};
 		static struct option opts[] = {
 			{ "help",     no_argument,       0, 'h' },
 			{ "verbose",  no_argument,       0, OPT_VERBOSE },
 			{ "data-dir", required_argument, 0, OPT_DATADIR },
 			{ "validate-only", no_argument,  0, OPT_VALIDATE },
+			{ "update-cache", no_argument,   0, OPT_UPDATE_CACHE },
+			{ "verify-cache", no_argument,   0, OPT_VERIFY_CACHE },
 			{ 0, 0, 0, 0}
 		};
 
@@ -195,13 +212,19 @@ main(int argc, char **argv)
 		case OPT_VALIDATE:
 			validate = true;
 			break;
+		case OPT_UPDATE_CACHE:
+			cache_mode = CACHE_UPDATE;
+			break;
+		case OPT_VERIFY_CACHE:
+			cache_mode = CACHE_VERIFY;
+			break;
 		default:
 			usage();
 			return 1;
 		}
 	}
 
-	if (optind >= argc && !validate) {
+	if (optind >= argc && !validate && cache_mode == CACHE_NONE) {
 		usage();
 		return 1;
 	}
@@ -212,6 +235,46 @@ main(int argc, char **argv)
 		override_file = LIBINPUT_DATA_OVERRIDE_FILE;
 	}
 
+	switch (cache_mode) {
+	case CACHE_NONE:
+		break;
+	case CACHE_UPDATE:
+		if (!quirks_cache_update(data_path,
+					 override_file,
+					 log_handler,
+					 QLOG_CUSTOM_LOG_PRIORITIES)) {
+			fprintf(stderr,
+				"Failed to update the quirks cache. "
+				"Please see the above errors "
+				"and/or re-run with --verbose for more details\n");
+			return 1;
+		}
+		return 0;
+	case CACHE_VERIFY:
+		switch (quirks_cache_verify(data_path,
+					    override_file,
+					    log_handler,
+					    QLOG_CUSTOM_LOG_PRIORITIES)) {
+		case QUIRKS_CACHE_UP_TO_DATE:
+			printf("The quirks cache is up-to-date\n");
+			return 0;
+		case QUIRKS_CACHE_MISSING:
+			printf("The quirks cache does not exist\n");
+			return 1;
+		case QUIRKS_CACHE_OUTDATED:
+			printf("The quirks cache is outdated, "
+			       "run with --update-cache\n");
+			return 1;
+		case QUIRKS_CACHE_ERROR:
+			fprintf(stderr,
+				"Failed to parse the device quirks. "
+				"Please see the above errors "
+				"and/or re-run with --verbose for more details\n");
+			return 1;
+		}
+		break;
+	}
+
 	quirks = quirks_init_subsystem(data_path,
 				      override_file,
 				      log_handler,
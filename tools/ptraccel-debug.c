@@ -34,6 +34,7 @@
 
 #include "filter.h"
 #include "libinput-util.h"
+#include "filter-private.h"
 
 static void
 print_ptraccel_deltas(struct motion_filter *filter, double step)
@@ -169,6 +170,34 @@ print_accel_func(struct motion_filter *filter,
 	}
 }
 
+static void
+print_accel_table(struct motion_filter *filter,
+		  accel_profile_func_t profile,
+		  int dpi)
+{
+	double mmps;
+
+	printf("# gnuplot:\n");
+	printf("# set xlabel \"speed (mm/s)\"\n");
+	printf("# set ylabel \"raw accel factor\"\n");
+	printf("# set style data lines\n");
+	printf("# plot \"gnuplot.data\" using 1:2 title 'profile', \\\n");
+	printf("#      \"gnuplot.data\" using 1:3 title 'lookup table'\n");
+	printf("#\n");
+	printf("# table: %zu samples up to %.8f units/us\n",
+	       filter->table.nsamples,
+	       filter->table.max_velocity);
+	printf("# data: velocity(mm/s) factor table-factor error velocity(units/us)\n");
+	for (mmps = 0.0; mmps < 1000.0; mmps += 1) {
+		double units_per_us = mmps_to_upus(mmps, dpi);
+		double result = profile(filter, NULL, units_per_us, 0 /* time */);
+		double table = accel_profile_table_lookup(&filter->table,
+							  units_per_us);
+		printf("%.8f\t%.4f\t%.4f\t%.6f\t%.8f\n",
+		       mmps, result, table, table - result, units_per_us);
+	}
+}
+
 static void
 print_accel_func_trackpoint(struct motion_filter *filter,
 			    int max)
@@ -193,8 +222,9 @@ usage(void)
 	printf("Usage: %s [options] [dx1] [dx2] [...] > gnuplot.data\n", program_invocation_short_name);
 	printf("\n"
 	       "Options:\n"
-	       "--mode=<accel|motion|delta|sequence> \n"
+	       "--mode=<accel|table|motion|delta|sequence> \n"
 	       "	accel    ... print accel factor (default)\n"
+	       "	table    ... print accel factor and the lookup table's factor\n"
 	       "	motion   ... print motion to accelerated motion\n"
 	       "	delta    ... print delta to accelerated delta\n"
 	       "	sequence ... print motion for custom delta sequence\n"
@@ -224,6 +254,7 @@ usage(void)
 
 enum mode {
 	ACCEL,
+	TABLE,
 	MOTION,
 	DELTA,
 	SEQUENCE,
@@ -285,6 +316,8 @@ main(int argc, char **argv)
 		case OPT_MODE:
 			if (streq(optarg, "accel"))
 				mode = ACCEL;
+			else if (streq(optarg, "table"))
+				mode = TABLE;
 			else if (streq(optarg, "motion"))
 				mode = MOTION;
 			else if (streq(optarg, "delta"))
@@ -386,6 +419,16 @@ main(int argc, char **argv)
 		else
 			print_accel_func(filter, profile, dpi);
 		break;
+	case TABLE:
+		if (!filter->table.factors) {
+			fprintf(stderr,
+				"Filter %s does not use a lookup table\n",
+				filter_type);
+			filter_destroy(filter);
+			return 1;
+		}
+		print_accel_table(filter, profile, dpi);
+		break;
 	case DELTA:
 		print_ptraccel_deltas(filter, step);
 		break;